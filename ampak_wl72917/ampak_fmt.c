@@ -0,0 +1,126 @@
+/*
+ * ampak_fmt.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#include "ampak_wl72917/ampak_fmt.h"
+#include "string.h"
+
+static const char fmt_hex_digits[] = "0123456789abcdef";
+
+/**
+ * Function implementation
+ */
+
+ampak_fmt_t *ampak_fmt_init(ampak_fmt_t *fmt, char *buffer, uint32_t size)
+{
+  fmt->buffer    = buffer;
+  fmt->size      = size;
+  fmt->length    = 0;
+  fmt->truncated = (size == 0);
+  if(size != 0)
+  { buffer[0] = '\0'; }
+  return fmt;
+}
+
+ampak_fmt_t *ampak_fmt_mem(ampak_fmt_t *fmt, const void *data, uint32_t length)
+{
+  if(fmt->size == 0)
+  { return fmt; }
+
+  uint32_t room = fmt->size - 1U - fmt->length;
+  if(length > room)
+  {
+    length = room;
+    fmt->truncated = true;
+  }
+  memcpy(&fmt->buffer[fmt->length], data, length);
+  fmt->length += length;
+  fmt->buffer[fmt->length] = '\0';
+  return fmt;
+}
+
+ampak_fmt_t *ampak_fmt_str(ampak_fmt_t *fmt, const char *text)
+{
+  return ampak_fmt_mem(fmt, text, (uint32_t)strlen(text));
+}
+
+ampak_fmt_t *ampak_fmt_char(ampak_fmt_t *fmt, char c)
+{
+  return ampak_fmt_mem(fmt, &c, 1U);
+}
+
+ampak_fmt_t *ampak_fmt_u32(ampak_fmt_t *fmt, uint32_t value)
+{
+  char digits[10];
+  uint32_t count = 0;
+
+  do
+  {
+    digits[sizeof(digits) - 1U - count] = (char)('0' + value % 10U);
+    value /= 10U;
+    count++;
+  } while(value != 0);
+
+  return ampak_fmt_mem(fmt, &digits[sizeof(digits) - count], count);
+}
+
+ampak_fmt_t *ampak_fmt_i32(ampak_fmt_t *fmt, int32_t value)
+{
+  if(value >= 0)
+  { return ampak_fmt_u32(fmt, (uint32_t)value); }
+
+  ampak_fmt_char(fmt, '-');
+  return ampak_fmt_u32(fmt, (uint32_t)(-(value + 1)) + 1U);
+}
+
+ampak_fmt_t *ampak_fmt_hex(ampak_fmt_t *fmt, uint32_t value, uint8_t digits)
+{
+  char text[8];
+
+  digits = (digits == 0) ? 1U : ((digits > 8U) ? 8U : digits);
+  for(uint8_t i = 0; i < digits; i++)
+  {
+    text[digits - 1U - i] = fmt_hex_digits[(value >> (4U * i)) & 0xFU];
+  }
+  return ampak_fmt_mem(fmt, text, digits);
+}
+
+ampak_fmt_t *ampak_fmt_mac(ampak_fmt_t *fmt, const uint8_t *mac, char separator)
+{
+  for(uint8_t i = 0; i < 6U; i++)
+  {
+    if(i != 0 && separator != 0)
+    { ampak_fmt_char(fmt, separator); }
+    ampak_fmt_hex(fmt, mac[i], 2U);
+  }
+  return fmt;
+}
+
+ampak_fmt_t *ampak_fmt_fixed(ampak_fmt_t *fmt, int32_t value, uint8_t decimals)
+{
+  uint32_t magnitude = (value >= 0) ? (uint32_t)value : (uint32_t)(-(value + 1)) + 1U;
+  uint32_t scale     = 1U;
+
+  decimals = (decimals > 9U) ? 9U : decimals;
+  for(uint8_t i = 0; i < decimals; i++)
+  { scale *= 10U; }
+
+  if(value < 0)
+  { ampak_fmt_char(fmt, '-'); }
+  ampak_fmt_u32(fmt, magnitude / scale);
+  if(decimals == 0)
+  { return fmt; }
+
+  char text[9];
+  uint32_t fraction = magnitude % scale;
+  for(uint8_t i = 0; i < decimals; i++)
+  {
+    text[decimals - 1U - i] = (char)('0' + fraction % 10U);
+    fraction /= 10U;
+  }
+  ampak_fmt_char(fmt, '.');
+  return ampak_fmt_mem(fmt, text, decimals);
+}
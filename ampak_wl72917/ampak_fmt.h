@@ -0,0 +1,57 @@
+/*
+ * ampak_fmt.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_AMPAK_FMT_H_
+#define AMPAK_WL72917_AMPAK_FMT_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+/**
+ * Bounded text builder for hot paths, no printf engine and no allocation.
+ *
+ * Every append is typed, so arguments are checked by the compiler instead of
+ * against a format string. Output never exceeds the buffer and is always
+ * terminated; an append that does not fit writes what fits and marks the
+ * builder truncated. Appends return the builder so they can be chained:
+ *
+ *   ampak_fmt_t fmt;
+ *   ampak_fmt_u32(ampak_fmt_lit(ampak_fmt_init(&fmt, buf, sizeof(buf)), "rssi "), value);
+ */
+typedef struct {
+  char *buffer;
+  uint32_t size;      /* including the terminator */
+  uint32_t length;    /* excluding the terminator */
+  bool truncated;
+} ampak_fmt_t;
+
+/** MAC address text without separators, terminator included **/
+#define AMPAK_FMT_MAC_SIZE 13U
+
+/** string literal append, length taken at compile time; a non-literal does not compile **/
+#define ampak_fmt_lit(fmt, literal) ampak_fmt_mem((fmt), "" literal, sizeof(literal) - 1U)
+
+ampak_fmt_t *ampak_fmt_init(ampak_fmt_t *fmt, char *buffer, uint32_t size);
+ampak_fmt_t *ampak_fmt_str(ampak_fmt_t *fmt, const char *text);
+ampak_fmt_t *ampak_fmt_mem(ampak_fmt_t *fmt, const void *data, uint32_t length);
+ampak_fmt_t *ampak_fmt_char(ampak_fmt_t *fmt, char c);
+ampak_fmt_t *ampak_fmt_u32(ampak_fmt_t *fmt, uint32_t value);
+ampak_fmt_t *ampak_fmt_i32(ampak_fmt_t *fmt, int32_t value);
+/** lower case, zero padded to digits (1..8) **/
+ampak_fmt_t *ampak_fmt_hex(ampak_fmt_t *fmt, uint32_t value, uint8_t digits);
+/** six zero padded octets, separator 0 for none **/
+ampak_fmt_t *ampak_fmt_mac(ampak_fmt_t *fmt, const uint8_t *mac, char separator);
+/** value scaled by 10^decimals, e.g. (2155, 2) -> "21.55" **/
+ampak_fmt_t *ampak_fmt_fixed(ampak_fmt_t *fmt, int32_t value, uint8_t decimals);
+
+static inline uint32_t ampak_fmt_length(const ampak_fmt_t *fmt)
+{ return fmt->length; }
+
+static inline bool ampak_fmt_ok(const ampak_fmt_t *fmt)
+{ return !fmt->truncated; }
+
+#endif /* AMPAK_WL72917_AMPAK_FMT_H_ */
@@ -12,6 +12,11 @@
 #define UNUSED_PARAMETER(x) (void)(x)
 #endif // UNUSED_PARAMETER
 
+#include "stdbool.h"
+#include "stdint.h"
+
 void ampak_m4_sleep_wakeup(void);
+bool ampak_power_save_is_active(void);
+uint32_t ampak_m4_wake_count(void);
 
 #endif /* AMPAK_WL72917_AMPAK_UTIL_H_ */
@@ -0,0 +1,262 @@
+/*
+ * app_metrics.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#include "ampak_wl72917/app_metrics.h"
+#include "cmsis_os2.h"
+#include "string.h"
+#include "stdio.h"
+
+/** CBOR major types, RFC 8949 **/
+#define CBOR_UNSIGNED   0U
+#define CBOR_NEGATIVE   1U
+#define CBOR_TEXT       3U
+#define CBOR_ARRAY      4U
+#define CBOR_MAP_INDEFINITE 0xBFU
+#define CBOR_BREAK          0xFFU
+
+typedef struct {
+  const char *name;
+  app_metrics_read_t read;
+  uint8_t kind;               /* appMetricsKind_t */
+  union {
+    uint32_t counter;
+    int32_t gauge;
+    uint32_t buckets[APP_METRICS_HISTOGRAM_BUCKETS];
+  } value;
+} app_metric_t;
+
+typedef struct {
+  uint8_t *buffer;
+  uint32_t size;
+  uint32_t length;
+  bool overflow;
+} app_metrics_writer_t;
+
+static app_metric_t metrics[APP_METRICS_MAX];
+static uint32_t metrics_count;
+static uint32_t metrics_seq;
+
+/**
+ *  Local functions
+ */
+
+static void app_metrics_put(app_metrics_writer_t *writer, const uint8_t *data, uint32_t length)
+{
+  if(writer->overflow || writer->length + length > writer->size)
+  {
+    writer->overflow = true;
+    return;
+  }
+  memcpy(writer->buffer + writer->length, data, length);
+  writer->length += length;
+}
+
+static void app_metrics_put_byte(app_metrics_writer_t *writer, uint8_t byte)
+{
+  app_metrics_put(writer, &byte, 1);
+}
+
+/** shortest head for the value, as CBOR deterministic encoding wants **/
+static void app_metrics_put_head(app_metrics_writer_t *writer, uint32_t major, uint32_t value)
+{
+  uint8_t head[5];
+  uint32_t length;
+
+  if(value < 24U)
+  {
+    head[0] = (uint8_t)((major << 5) | value);
+    length = 1;
+  }
+  else if(value <= 0xFFU)
+  {
+    head[0] = (uint8_t)((major << 5) | 24U);
+    head[1] = (uint8_t)value;
+    length = 2;
+  }
+  else if(value <= 0xFFFFU)
+  {
+    head[0] = (uint8_t)((major << 5) | 25U);
+    head[1] = (uint8_t)(value >> 8);
+    head[2] = (uint8_t)value;
+    length = 3;
+  }
+  else
+  {
+    head[0] = (uint8_t)((major << 5) | 26U);
+    head[1] = (uint8_t)(value >> 24);
+    head[2] = (uint8_t)(value >> 16);
+    head[3] = (uint8_t)(value >> 8);
+    head[4] = (uint8_t)value;
+    length = 5;
+  }
+  app_metrics_put(writer, head, length);
+}
+
+static void app_metrics_put_int(app_metrics_writer_t *writer, int32_t value)
+{
+  if(value >= 0)
+  { app_metrics_put_head(writer, CBOR_UNSIGNED, (uint32_t)value); }
+  else
+  { app_metrics_put_head(writer, CBOR_NEGATIVE, (uint32_t)(-1 - value)); }
+}
+
+static void app_metrics_put_value(app_metrics_writer_t *writer, app_metric_t *metric)
+{
+  if(metric->kind == app_metrics_histogram)
+  {
+    uint32_t used = APP_METRICS_HISTOGRAM_BUCKETS;
+    while(used > 0 && __atomic_load_n(&metric->value.buckets[used - 1U], __ATOMIC_RELAXED) == 0)
+    { used--; }
+
+    app_metrics_put_head(writer, CBOR_ARRAY, used);
+    for(uint32_t i = 0; i < used; i++)
+    { app_metrics_put_head(writer, CBOR_UNSIGNED, __atomic_load_n(&metric->value.buckets[i], __ATOMIC_RELAXED)); }
+  }
+  else if(metric->kind == app_metrics_counter)
+  {
+    uint32_t value = (metric->read != NULL) ? (uint32_t)metric->read() : __atomic_load_n(&metric->value.counter, __ATOMIC_RELAXED);
+    app_metrics_put_head(writer, CBOR_UNSIGNED, value);
+  }
+  else
+  {
+    int32_t value = (metric->read != NULL) ? metric->read() : __atomic_load_n(&metric->value.gauge, __ATOMIC_RELAXED);
+    app_metrics_put_int(writer, value);
+  }
+}
+
+static void app_metrics_put_schema(app_metrics_writer_t *writer, app_metric_t *metric)
+{
+  uint32_t name_length = (uint32_t)strlen(metric->name);
+
+  app_metrics_put_head(writer, CBOR_ARRAY, 2);
+  app_metrics_put_head(writer, CBOR_UNSIGNED, metric->kind);
+  app_metrics_put_head(writer, CBOR_TEXT, name_length);
+  app_metrics_put(writer, (const uint8_t *)metric->name, name_length);
+}
+
+/**
+ * Fill an indefinite map {_ id: entry} from *first on, one whole entry at a
+ * time; the byte for the break is held back so a part always closes.
+ */
+static uint32_t app_metrics_put_map(app_metrics_writer_t *writer, uint32_t *first,
+                                    void (*put_entry)(app_metrics_writer_t *, app_metric_t *))
+{
+  uint32_t entries = 0;
+
+  if(writer->overflow || writer->size - writer->length < 2U)
+  {
+    writer->overflow = true;
+    return 0;
+  }
+  app_metrics_put_byte(writer, CBOR_MAP_INDEFINITE);
+  writer->size--;
+
+  while(*first < metrics_count)
+  {
+    uint32_t mark = writer->length;
+
+    app_metrics_put_head(writer, CBOR_UNSIGNED, *first);
+    put_entry(writer, &metrics[*first]);
+    if(writer->overflow)
+    {
+      writer->length = mark;
+      writer->overflow = false;
+      break;
+    }
+    (*first)++;
+    entries++;
+  }
+
+  writer->size++;
+  app_metrics_put_byte(writer, CBOR_BREAK);
+  return entries;
+}
+
+/**
+ * Function implementation
+ */
+
+sl_status_t app_metrics_register(const char *name, appMetricsKind_t kind, app_metrics_read_t read, app_metric_id_t *id)
+{
+  if(id != NULL)
+  { *id = APP_METRICS_INVALID; }
+
+  if(name == NULL)
+  { return SL_STATUS_NULL_POINTER; }
+  if(kind > app_metrics_histogram || (kind == app_metrics_histogram && read != NULL) || strlen(name) > APP_METRICS_NAME_MAX)
+  { return SL_STATUS_INVALID_PARAMETER; }
+  if(metrics_count >= APP_METRICS_MAX)
+  {
+    printf("metrics full, %s not registered\r\n", name);
+    return SL_STATUS_FULL;
+  }
+
+  metrics[metrics_count].name = name;
+  metrics[metrics_count].read = read;
+  metrics[metrics_count].kind = (uint8_t)kind;
+  memset(&metrics[metrics_count].value, 0, sizeof(metrics[metrics_count].value));
+  if(id != NULL)
+  { *id = (app_metric_id_t)metrics_count; }
+  metrics_count++;
+  return SL_STATUS_OK;
+}
+
+void app_metrics_add(app_metric_id_t id, uint32_t amount)
+{
+  if(id < metrics_count && metrics[id].kind == app_metrics_counter)
+  { __atomic_fetch_add(&metrics[id].value.counter, amount, __ATOMIC_RELAXED); }
+}
+
+void app_metrics_set(app_metric_id_t id, int32_t value)
+{
+  if(id < metrics_count && metrics[id].kind == app_metrics_gauge)
+  { __atomic_store_n(&metrics[id].value.gauge, value, __ATOMIC_RELAXED); }
+}
+
+void app_metrics_observe(app_metric_id_t id, uint32_t value)
+{
+  if(id >= metrics_count || metrics[id].kind != app_metrics_histogram)
+  { return; }
+
+  uint32_t bucket = (value == 0) ? 0 : 32U - (uint32_t)__builtin_clz(value);
+  if(bucket >= APP_METRICS_HISTOGRAM_BUCKETS)
+  { bucket = APP_METRICS_HISTOGRAM_BUCKETS - 1U; }
+  __atomic_fetch_add(&metrics[id].value.buckets[bucket], 1U, __ATOMIC_RELAXED);
+}
+
+uint32_t app_metrics_count(void)
+{
+  return metrics_count;
+}
+
+uint32_t app_metrics_encode(uint8_t *buffer, uint32_t size, uint32_t *first)
+{
+  app_metrics_writer_t writer = { buffer, size, 0, false };
+
+  if(*first == 0)
+  { metrics_seq++; }
+
+  app_metrics_put_head(&writer, CBOR_ARRAY, 4);
+  app_metrics_put_head(&writer, CBOR_UNSIGNED, metrics_seq);
+  app_metrics_put_head(&writer, CBOR_UNSIGNED, (uint32_t)((uint64_t)osKernelGetTickCount() / osKernelGetTickFreq()));
+  app_metrics_put_head(&writer, CBOR_UNSIGNED, *first);
+  if(writer.overflow)
+  { return 0; }
+
+  if(app_metrics_put_map(&writer, first, app_metrics_put_value) == 0 && *first < metrics_count)
+  { return 0; }
+  return writer.length;
+}
+
+uint32_t app_metrics_encode_schema(uint8_t *buffer, uint32_t size, uint32_t *first)
+{
+  app_metrics_writer_t writer = { buffer, size, 0, false };
+
+  if(app_metrics_put_map(&writer, first, app_metrics_put_schema) == 0 && *first < metrics_count)
+  { return 0; }
+  return writer.length;
+}
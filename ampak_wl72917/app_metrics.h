@@ -0,0 +1,64 @@
+/*
+ * app_metrics.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_APP_METRICS_H_
+#define AMPAK_WL72917_APP_METRICS_H_
+
+#include "sl_status.h"
+#include "stdint.h"
+#include "stdbool.h"
+
+#define APP_METRICS_MAX      32U
+#define APP_METRICS_NAME_MAX 12U
+/** bucket 0 is 0, bucket n is 2^(n-1) .. 2^n - 1, the last one open ended **/
+#define APP_METRICS_HISTOGRAM_BUCKETS 12U
+
+/** id of a metric that failed to register, updates to it are ignored **/
+#define APP_METRICS_INVALID 0xFFU
+
+typedef uint8_t app_metric_id_t;
+
+typedef enum {
+  app_metrics_counter = 0,    /* monotonic uint32, app_metrics_add() */
+  app_metrics_gauge,          /* int32 level, app_metrics_set() */
+  app_metrics_histogram,      /* log2 buckets, app_metrics_observe() */
+} appMetricsKind_t;
+
+/** sampled at snapshot time instead of being pushed, for counters and gauges **/
+typedef int32_t (*app_metrics_read_t)(void);
+
+/**
+ * Fixed memory metrics registry.
+ *
+ * Subsystems register their metrics once at init and keep the id; updates are
+ * lock free (atomic adds on the counter or bucket) and safe from any task or
+ * ISR, and an update with APP_METRICS_INVALID does nothing, so a full registry
+ * costs visibility, not correctness. name must stay valid; id may be NULL
+ * for a metric that only has a read function.
+ *
+ * A snapshot is CBOR: [seq, uptime s, first id, {_ id: value, ...}], where a
+ * histogram value is the array of its bucket counts without trailing zeros.
+ * When the metrics do not fit one buffer, app_metrics_encode() stops at a
+ * metric boundary and sets *first for the next part; each part is a complete
+ * CBOR item. The schema, {_ id: [kind, name], ...}, is encoded the same way
+ * and only changes when something registers.
+ */
+sl_status_t app_metrics_register(const char *name, appMetricsKind_t kind, app_metrics_read_t read, app_metric_id_t *id);
+void app_metrics_add(app_metric_id_t id, uint32_t amount);
+void app_metrics_set(app_metric_id_t id, int32_t value);
+void app_metrics_observe(app_metric_id_t id, uint32_t value);
+
+uint32_t app_metrics_count(void);
+/**
+ * @param first  in: first metric id of this part, 0 starts a new snapshot; out: first id of the next part,
+ *               app_metrics_count() when this was the last one
+ * @return bytes written, 0 when not even one metric fits
+ */
+uint32_t app_metrics_encode(uint8_t *buffer, uint32_t size, uint32_t *first);
+uint32_t app_metrics_encode_schema(uint8_t *buffer, uint32_t size, uint32_t *first);
+
+#endif /* AMPAK_WL72917_APP_METRICS_H_ */
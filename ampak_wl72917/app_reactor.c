@@ -0,0 +1,123 @@
+/*
+ * app_reactor.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#include "ampak_wl72917/app_reactor.h"
+#include "ampak_wl72917/app_metrics.h"
+#include "stdio.h"
+
+typedef struct {
+  app_reactor_handler_t handler;
+  void *context;
+} app_reactor_entry_t;
+
+static osEventFlagsId_t reactor_flags = NULL;
+static app_reactor_entry_t reactor_entries[APP_REACTOR_MAX_EVENTS];
+static uint32_t reactor_registered;
+
+static app_reactor_deadline_t reactor_next_deadline;
+static app_reactor_handler_t reactor_on_deadline;
+static void *reactor_deadline_context;
+
+static app_reactor_stats_t reactor_stats;
+/** handler run time in ms, event and deadline handlers alike **/
+static app_metric_id_t reactor_latency_metric = APP_METRICS_INVALID;
+
+/**
+ *  Local functions
+ */
+
+static void app_reactor_call(app_reactor_handler_t handler, void *context)
+{
+  uint32_t start = osKernelGetTickCount();
+
+  handler(context);
+  app_metrics_observe(reactor_latency_metric, (uint32_t)((uint64_t)(osKernelGetTickCount() - start) * 1000U / osKernelGetTickFreq()));
+}
+
+/**
+ * Function implementation
+ */
+
+sl_status_t app_reactor_init(void)
+{
+  if(reactor_flags != NULL)
+  { return SL_STATUS_OK; }
+
+  reactor_flags = osEventFlagsNew(NULL);
+  if(reactor_flags == NULL)
+  {
+    printf("Failed to new reactor event flags\r\n");
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  app_metrics_register("evt.ms", app_metrics_histogram, NULL, &reactor_latency_metric);
+  return SL_STATUS_OK;
+}
+
+sl_status_t app_reactor_register(uint32_t event_flag, app_reactor_handler_t handler, void *context)
+{
+  /* exactly one bit, inside the usable range */
+  if(event_flag == 0 || (event_flag & (event_flag - 1U)) != 0 || event_flag >= (1UL << APP_REACTOR_MAX_EVENTS))
+  { return SL_STATUS_INVALID_PARAMETER; }
+  if(handler == NULL)
+  { return SL_STATUS_NULL_POINTER; }
+
+  uint32_t index = (uint32_t)__builtin_ctz(event_flag);
+  reactor_entries[index].handler = handler;
+  reactor_entries[index].context = context;
+  reactor_registered |= event_flag;
+  return SL_STATUS_OK;
+}
+
+void app_reactor_post(uint32_t event_flags)
+{
+  if(reactor_flags != NULL)
+  { osEventFlagsSet(reactor_flags, event_flags); }
+}
+
+void app_reactor_set_deadline(app_reactor_deadline_t next_deadline, app_reactor_handler_t on_deadline, void *context)
+{
+  reactor_next_deadline    = next_deadline;
+  reactor_on_deadline      = on_deadline;
+  reactor_deadline_context = context;
+}
+
+void app_reactor_run(void)
+{
+  while(1)
+  {
+    uint32_t timeout = (reactor_next_deadline != NULL) ? reactor_next_deadline() : osWaitForever;
+    uint32_t flags   = osWaitForever;
+
+    if(timeout != 0)
+    { flags = osEventFlagsWait(reactor_flags, reactor_registered, osFlagsWaitAny, timeout); }
+    reactor_stats.wakeups++;
+
+    /* osFlagsErrorTimeout and other errors have the top bit set */
+    if((flags & osFlagsError) == 0)
+    {
+      flags &= reactor_registered;
+      while(flags != 0)
+      {
+        uint32_t index = (uint32_t)__builtin_ctz(flags);
+        flags &= flags - 1U;
+        reactor_stats.dispatched++;
+        app_reactor_call(reactor_entries[index].handler, reactor_entries[index].context);
+      }
+    }
+
+    if(reactor_on_deadline != NULL && reactor_next_deadline != NULL && reactor_next_deadline() == 0)
+    {
+      reactor_stats.deadlines++;
+      app_reactor_call(reactor_on_deadline, reactor_deadline_context);
+    }
+  }
+}
+
+void app_reactor_get_stats(app_reactor_stats_t *stats)
+{
+  *stats = reactor_stats;
+}
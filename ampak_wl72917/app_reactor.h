@@ -0,0 +1,43 @@
+/*
+ * app_reactor.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_APP_REACTOR_H_
+#define AMPAK_WL72917_APP_REACTOR_H_
+
+#include "cmsis_os2.h"
+#include "sl_status.h"
+#include "stdint.h"
+
+/** FreeRTOS event groups carry 24 usable bits **/
+#define APP_REACTOR_MAX_EVENTS 24U
+
+typedef void (*app_reactor_handler_t)(void *context);
+/** ticks until the next deadline, osWaitForever when there is none **/
+typedef uint32_t (*app_reactor_deadline_t)(void);
+
+typedef struct {
+  uint32_t wakeups;       /* returns from the wait, events or deadline */
+  uint32_t dispatched;    /* handler calls */
+  uint32_t deadlines;     /* deadline handler calls */
+} app_reactor_stats_t;
+
+/**
+ * Single-thread event loop on one osEventFlags object.
+ *
+ * Each event is one flag bit with one handler. app_reactor_post() is safe from
+ * tasks and ISRs; handlers run on the thread that called app_reactor_run(),
+ * one at a time, lowest bit first. With nothing posted and no deadline due the
+ * thread blocks, so the idle task and tickless sleep get the CPU.
+ */
+sl_status_t app_reactor_init(void);
+sl_status_t app_reactor_register(uint32_t event_flag, app_reactor_handler_t handler, void *context);
+void app_reactor_post(uint32_t event_flags);
+void app_reactor_set_deadline(app_reactor_deadline_t next_deadline, app_reactor_handler_t on_deadline, void *context);
+void app_reactor_run(void);
+void app_reactor_get_stats(app_reactor_stats_t *stats);
+
+#endif /* AMPAK_WL72917_APP_REACTOR_H_ */
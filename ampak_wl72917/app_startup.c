@@ -0,0 +1,245 @@
+/*
+ * app_startup.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#include "ampak_wl72917/app_startup.h"
+#include "ampak_wl72917/ampak_util.h"
+#include "cmsis_os2.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+
+#define STARTUP_FLAG_CHANGED 0x0001U
+#define STARTUP_FLAG_LANE    0x0002U
+
+static const app_startup_step_t *startup_steps;
+static uint32_t startup_count;
+static uint32_t startup_all;
+static uint32_t startup_started;
+static uint32_t startup_done;
+static sl_status_t startup_status;
+static uint32_t startup_failed_step;
+static uint32_t startup_lanes_finished;  /* helper lanes done, counted as event flags coalesce */
+static uint32_t startup_begin_tick[APP_STARTUP_MAX_STEPS];
+static uint32_t startup_end_tick[APP_STARTUP_MAX_STEPS];
+
+static osMutexId_t startup_lock       = NULL;
+static osEventFlagsId_t startup_flags = NULL;
+
+static const osThreadAttr_t startup_lane_attributes = {
+  .name       = "startup_lane",
+  .attr_bits  = 0,
+  .cb_mem     = 0,
+  .cb_size    = 0,
+  .stack_mem  = 0,
+  .stack_size = APP_STARTUP_STACK,
+  .priority   = osPriorityLow,
+  .tz_module  = 0,
+  .reserved   = 0,
+};
+
+/**
+ *  Local functions
+ */
+
+static void app_startup_lane(void);
+static void app_startup_helper(void *argument);
+static void app_startup_report(app_startup_report_t *report);
+static uint32_t app_startup_ms(uint32_t begin_tick, uint32_t end_tick);
+
+/**
+ * Function implementation
+ */
+
+sl_status_t app_startup_run(const app_startup_step_t *steps, uint32_t count, app_startup_report_t *report)
+{
+  if(steps == NULL || report == NULL)
+  { return SL_STATUS_NULL_POINTER; }
+  if(count == 0 || count > APP_STARTUP_MAX_STEPS)
+  { return SL_STATUS_INVALID_PARAMETER; }
+  for(uint32_t i = 0; i < count; i++)
+  {
+    /* only earlier steps, so the graph can not hold a cycle */
+    if(steps[i].run == NULL || (steps[i].depends & ~(APP_STARTUP_STEP(i) - 1U)) != 0)
+    { return SL_STATUS_INVALID_PARAMETER; }
+  }
+
+  startup_lock  = osMutexNew(NULL);
+  startup_flags = osEventFlagsNew(NULL);
+  if(startup_lock == NULL || startup_flags == NULL)
+  {
+    printf("Failed to new startup sync objects\r\n");
+    if(startup_lock != NULL)
+    { osMutexDelete(startup_lock); }
+    if(startup_flags != NULL)
+    { osEventFlagsDelete(startup_flags); }
+    startup_lock  = NULL;
+    startup_flags = NULL;
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+
+  startup_steps          = steps;
+  startup_count          = count;
+  startup_all            = APP_STARTUP_STEP(count) - 1U;
+  startup_started        = 0;
+  startup_done           = 0;
+  startup_status         = SL_STATUS_OK;
+  startup_failed_step    = 0;
+  startup_lanes_finished = 0;
+
+  uint32_t helpers = 0;
+  for(uint32_t i = 1; i < APP_STARTUP_LANES; i++)
+  {
+    if(osThreadNew(app_startup_helper, NULL, &startup_lane_attributes) != NULL)
+    { helpers++; }
+    else
+    { printf("Failed to new startup lane, running with fewer\r\n"); }
+  }
+
+  app_startup_lane();
+
+  while(1)
+  {
+    osMutexAcquire(startup_lock, osWaitForever);
+    bool finished = (startup_lanes_finished == helpers);
+    osMutexRelease(startup_lock);
+    if(finished)
+    { break; }
+    osEventFlagsWait(startup_flags, STARTUP_FLAG_LANE, osFlagsWaitAny, osWaitForever);
+  }
+
+  osEventFlagsDelete(startup_flags);
+  osMutexDelete(startup_lock);
+  startup_flags = NULL;
+  startup_lock  = NULL;
+
+  app_startup_report(report);
+  return startup_status;
+}
+
+static void app_startup_lane(void)
+{
+  while(1)
+  {
+    osMutexAcquire(startup_lock, osWaitForever);
+    if(startup_status != SL_STATUS_OK || startup_done == startup_all)
+    {
+      osMutexRelease(startup_lock);
+      break;
+    }
+
+    uint32_t index = startup_count;
+    for(uint32_t i = 0; i < startup_count; i++)
+    {
+      if((startup_started & APP_STARTUP_STEP(i)) == 0 && (startup_steps[i].depends & ~startup_done) == 0)
+      {
+        index = i;
+        startup_started |= APP_STARTUP_STEP(i);
+        break;
+      }
+    }
+    osMutexRelease(startup_lock);
+
+    if(index == startup_count)
+    {
+      /* nothing ready, wait for a step to finish */
+      osEventFlagsWait(startup_flags, STARTUP_FLAG_CHANGED, osFlagsWaitAny, osWaitForever);
+      continue;
+    }
+
+    startup_begin_tick[index] = osKernelGetTickCount();
+    sl_status_t status        = startup_steps[index].run();
+    startup_end_tick[index]   = osKernelGetTickCount();
+
+    osMutexAcquire(startup_lock, osWaitForever);
+    if(status == SL_STATUS_OK)
+    { startup_done |= APP_STARTUP_STEP(index); }
+    else if(startup_status == SL_STATUS_OK)
+    {
+      startup_status      = status;
+      startup_failed_step = index;
+      printf("Startup step %s failed: 0x%lx\r\n", startup_steps[index].name, status);
+    }
+    osMutexRelease(startup_lock);
+    osEventFlagsSet(startup_flags, STARTUP_FLAG_CHANGED);
+  }
+
+  /* pass the wake on, another lane may be waiting for a step that will never come */
+  osEventFlagsSet(startup_flags, STARTUP_FLAG_CHANGED);
+}
+
+static void app_startup_helper(void *argument)
+{
+  UNUSED_PARAMETER(argument);
+  app_startup_lane();
+
+  /* under the lock, so the boot task can not delete the sync objects before the flag is set */
+  osMutexAcquire(startup_lock, osWaitForever);
+  startup_lanes_finished++;
+  osEventFlagsSet(startup_flags, STARTUP_FLAG_LANE);
+  osMutexRelease(startup_lock);
+  osThreadExit();
+}
+
+static void app_startup_report(app_startup_report_t *report)
+{
+  uint32_t first = 0;
+  uint32_t last  = 0;
+  bool any       = false;
+
+  memset(report, 0, sizeof(*report));
+  report->failed_step = startup_failed_step;
+
+  for(uint32_t i = 0; i < startup_count; i++)
+  {
+    if((startup_started & APP_STARTUP_STEP(i)) == 0)
+    { continue; }
+    report->serial_ms += app_startup_ms(startup_begin_tick[i], startup_end_tick[i]);
+    if(!any || (int32_t)(startup_begin_tick[i] - startup_begin_tick[first]) < 0)
+    { first = i; }
+    if(!any || (int32_t)(startup_end_tick[i] - startup_end_tick[last]) > 0)
+    { last = i; }
+    any = true;
+  }
+  if(!any)
+  { return; }
+  report->total_ms = app_startup_ms(startup_begin_tick[first], startup_end_tick[last]);
+
+  /* walk back from the last step to finish through the dependency that finished last */
+  uint32_t path[APP_STARTUP_MAX_STEPS];
+  uint32_t length = 0;
+  uint32_t step   = last;
+  while(1)
+  {
+    path[length++]          = step;
+    report->critical_path  |= APP_STARTUP_STEP(step);
+    uint32_t depends        = startup_steps[step].depends & startup_started;
+    if(depends == 0)
+    { break; }
+
+    uint32_t latest = (uint32_t)__builtin_ctz(depends);
+    for(uint32_t i = latest + 1U; i < startup_count; i++)
+    {
+      if((depends & APP_STARTUP_STEP(i)) != 0 && (int32_t)(startup_end_tick[i] - startup_end_tick[latest]) > 0)
+      { latest = i; }
+    }
+    step = latest;
+  }
+
+  printf("Startup %lu ms, %lu ms run one by one, critical path:", report->total_ms, report->serial_ms);
+  while(length != 0)
+  {
+    step = path[--length];
+    printf(" %s %lu ms%s", startup_steps[step].name,
+           app_startup_ms(startup_begin_tick[step], startup_end_tick[step]), (length != 0) ? " ->" : "");
+  }
+  printf("\r\n");
+}
+
+static uint32_t app_startup_ms(uint32_t begin_tick, uint32_t end_tick)
+{
+  return (uint32_t)(((uint64_t)(end_tick - begin_tick) * 1000U) / osKernelGetTickFreq());
+}
@@ -0,0 +1,50 @@
+/*
+ * app_startup.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_APP_STARTUP_H_
+#define AMPAK_WL72917_APP_STARTUP_H_
+
+#include "sl_status.h"
+#include "stdint.h"
+
+#define APP_STARTUP_MAX_STEPS 16U
+/** threads running steps, the caller plus helpers **/
+#define APP_STARTUP_LANES     2U
+#define APP_STARTUP_STACK     2048U
+
+/** dependency mask bit for the step at this index **/
+#define APP_STARTUP_STEP(index) (1UL << (index))
+
+typedef sl_status_t (*app_startup_fn_t)(void);
+
+typedef struct {
+  const char *name;
+  app_startup_fn_t run;
+  uint32_t depends;           /* APP_STARTUP_STEP() of steps that must finish first */
+} app_startup_step_t;
+
+typedef struct {
+  uint32_t total_ms;          /* first start to last finish */
+  uint32_t serial_ms;         /* sum of step times, the cost run one by one */
+  uint32_t critical_path;     /* APP_STARTUP_STEP() mask of the chain that set total_ms */
+  uint32_t failed_step;       /* index, valid when the run failed */
+} app_startup_report_t;
+
+/**
+ * Dependency graph start up.
+ *
+ * Each step starts as soon as all its dependencies finished, on whichever lane
+ * is free, so steps that do not need each other overlap, e.g. credential set
+ * up while Wi-Fi is still associating. The first failing step stops the run:
+ * steps already running finish, nothing new starts, and its status is returned.
+ * Steps must be listed so that every dependency has a lower index.
+ *
+ * Blocks the caller until all lanes are done and prints the critical path.
+ */
+sl_status_t app_startup_run(const app_startup_step_t *steps, uint32_t count, app_startup_report_t *report);
+
+#endif /* AMPAK_WL72917_APP_STARTUP_H_ */
@@ -0,0 +1,334 @@
+/*
+ * app_timer_wheel.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+/**
+ * Level l slot s holds jobs whose expiry agrees with the wheel time above bit
+ * 6 * (l + 1) and has s in bits 6 * l .. 6 * l + 5; it comes due at the tick
+ * where the wheel time enters that slot. Level 0 slots hold exact ticks; a
+ * higher slot coming due moves its jobs one or more levels down (cascade).
+ * Since every occupied slot lies ahead of the wheel time, the wheel can jump
+ * straight to the next occupied slot instead of stepping tick by tick, which
+ * keeps a long sleep cheap to catch up on.
+ */
+
+#include "ampak_wl72917/app_timer_wheel.h"
+#include "ampak_wl72917/ampak_util.h"
+#include "cmsis_os2.h"
+#include "stdio.h"
+#include "string.h"
+
+#define WHEEL_SLOT_MASK (APP_TIMER_WHEEL_SLOTS - 1U)
+
+static app_timer_job_t *wheel_slots[APP_TIMER_WHEEL_LEVELS][APP_TIMER_WHEEL_SLOTS];
+static uint64_t wheel_occupied[APP_TIMER_WHEEL_LEVELS];
+static uint32_t wheel_now;              /* last processed wheel tick */
+static uint32_t wheel_kernel_tick;      /* kernel tick matching wheel_now */
+static uint32_t wheel_tick_ticks = 1U;  /* kernel ticks per wheel tick */
+static uint32_t wheel_random = 0x9E3779B9U;
+static app_timer_wheel_stats_t wheel_stats;
+
+/**
+ *  Local functions
+ */
+
+static uint32_t app_timer_wheel_ms_to_ticks(uint32_t ms);
+static uint32_t app_timer_wheel_target(uint32_t *kernel_tick);
+static bool app_timer_wheel_next_event(uint32_t *event_tick);
+static void app_timer_wheel_sync(void);
+static void app_timer_wheel_insert(app_timer_job_t *job);
+static void app_timer_wheel_remove(app_timer_job_t *job);
+static app_timer_job_t *app_timer_wheel_take_slot(uint32_t level, uint32_t slot);
+static void app_timer_wheel_process(uint32_t tick, uint32_t target);
+static void app_timer_wheel_arm(app_timer_job_t *job, uint32_t nominal);
+
+/**
+ * Function implementation
+ */
+
+void app_timer_wheel_init(void)
+{
+  memset(wheel_slots, 0, sizeof(wheel_slots));
+  memset(wheel_occupied, 0, sizeof(wheel_occupied));
+  memset(&wheel_stats, 0, sizeof(wheel_stats));
+
+  wheel_tick_ticks = (APP_TIMER_WHEEL_RESOLUTION_MS * osKernelGetTickFreq()) / 1000U;
+  if(wheel_tick_ticks == 0)
+  { wheel_tick_ticks = 1U; }
+  wheel_now         = 0;
+  wheel_kernel_tick = osKernelGetTickCount();
+  wheel_random     ^= wheel_kernel_tick;
+  if(wheel_random == 0)
+  { wheel_random = 0x9E3779B9U; }
+}
+
+void app_timer_job_init(app_timer_job_t *job, const char *name, app_timer_callback_t callback, void *context)
+{
+  memset(job, 0, sizeof(*job));
+  job->name     = name;
+  job->callback = callback;
+  job->context  = context;
+}
+
+sl_status_t app_timer_job_start(app_timer_job_t *job, uint32_t period_ms, uint32_t phase_ms, uint32_t jitter_ms)
+{
+  if(job == NULL || job->callback == NULL)
+  { return SL_STATUS_NULL_POINTER; }
+
+  uint32_t period = app_timer_wheel_ms_to_ticks(period_ms);
+  uint32_t phase  = app_timer_wheel_ms_to_ticks(phase_ms) % period;
+  uint32_t jitter = jitter_ms / APP_TIMER_WHEEL_RESOLUTION_MS;
+
+  if(period + jitter > APP_TIMER_WHEEL_MAX_TICKS || jitter >= period)
+  { return SL_STATUS_INVALID_PARAMETER; }
+
+  app_timer_job_stop(job);
+  app_timer_wheel_sync();
+
+  /* first multiple of period past now, shifted by phase, counted from the wheel epoch */
+  uint32_t now     = app_timer_wheel_target(NULL);
+  uint32_t nominal = (now >= phase) ? phase + ((now - phase) / period + 1U) * period : phase;
+
+  job->period = period;
+  job->jitter = jitter;
+  app_timer_wheel_arm(job, nominal);
+  return SL_STATUS_OK;
+}
+
+sl_status_t app_timer_job_start_once(app_timer_job_t *job, uint32_t delay_ms)
+{
+  if(job == NULL || job->callback == NULL)
+  { return SL_STATUS_NULL_POINTER; }
+
+  uint32_t delay = app_timer_wheel_ms_to_ticks(delay_ms);
+  if(delay > APP_TIMER_WHEEL_MAX_TICKS)
+  { return SL_STATUS_INVALID_PARAMETER; }
+
+  app_timer_job_stop(job);
+  app_timer_wheel_sync();
+
+  job->period = 0;
+  job->jitter = 0;
+  app_timer_wheel_arm(job, app_timer_wheel_target(NULL) + delay);
+  return SL_STATUS_OK;
+}
+
+void app_timer_job_stop(app_timer_job_t *job)
+{
+  if(job->link != NULL)
+  { app_timer_wheel_remove(job); }
+}
+
+bool app_timer_job_is_armed(const app_timer_job_t *job)
+{
+  return (job->link != NULL);
+}
+
+uint32_t app_timer_wheel_next_wait(void)
+{
+  uint32_t event_tick;
+
+  if(!app_timer_wheel_next_event(&event_tick))
+  { return osWaitForever; }
+
+  uint32_t due     = (event_tick - wheel_now) * wheel_tick_ticks;
+  uint32_t elapsed = osKernelGetTickCount() - wheel_kernel_tick;
+  return (due > elapsed) ? due - elapsed : 0;
+}
+
+void app_timer_wheel_run(void *context)
+{
+  UNUSED_PARAMETER(context);
+  uint32_t kernel_tick;
+  uint32_t target = app_timer_wheel_target(&kernel_tick);
+  uint32_t event_tick;
+
+  while(app_timer_wheel_next_event(&event_tick) && (int32_t)(event_tick - target) <= 0)
+  {
+    /* keep both clocks together, a callback that (re)starts a job reads them through target() */
+    wheel_kernel_tick += (event_tick - wheel_now) * wheel_tick_ticks;
+    wheel_now          = event_tick;
+    app_timer_wheel_process(event_tick, target);
+  }
+  /* a callback may have synced the wheel past target already, never step back */
+  if((int32_t)(target - wheel_now) > 0)
+  {
+    wheel_now         = target;
+    wheel_kernel_tick = kernel_tick;
+  }
+}
+
+void app_timer_wheel_get_stats(app_timer_wheel_stats_t *stats)
+{
+  *stats     = wheel_stats;
+  stats->now = wheel_now;
+}
+
+static uint32_t app_timer_wheel_ms_to_ticks(uint32_t ms)
+{
+  uint32_t ticks = (ms + APP_TIMER_WHEEL_RESOLUTION_MS - 1U) / APP_TIMER_WHEEL_RESOLUTION_MS;
+  return (ticks == 0) ? 1U : ticks;
+}
+
+/* wheel tick for the current kernel tick; commits the kernel side when asked */
+static uint32_t app_timer_wheel_target(uint32_t *kernel_tick)
+{
+  uint32_t steps = (osKernelGetTickCount() - wheel_kernel_tick) / wheel_tick_ticks;
+
+  if(kernel_tick != NULL)
+  { *kernel_tick = wheel_kernel_tick + steps * wheel_tick_ticks; }
+  return wheel_now + steps;
+}
+
+/* first occupied slot at the lowest non-empty level; lower levels always come due first */
+static bool app_timer_wheel_next_event(uint32_t *event_tick)
+{
+  for(uint32_t level = 0; level < APP_TIMER_WHEEL_LEVELS; level++)
+  {
+    if(wheel_occupied[level] == 0)
+    { continue; }
+
+    uint32_t shift   = APP_TIMER_WHEEL_SLOT_BITS * level;
+    uint32_t current = (wheel_now >> shift) & WHEEL_SLOT_MASK;
+    /* rotate so bit 0 is the slot after current */
+    uint32_t rotate  = (current + 1U) & WHEEL_SLOT_MASK;
+    uint64_t ahead   = (wheel_occupied[level] >> rotate)
+                       | ((rotate != 0) ? (wheel_occupied[level] << (APP_TIMER_WHEEL_SLOTS - rotate)) : 0);
+    uint32_t slot    = (rotate + (uint32_t)__builtin_ctzll(ahead)) & WHEEL_SLOT_MASK;
+    uint32_t span    = shift + APP_TIMER_WHEEL_SLOT_BITS;
+    uint32_t base    = (span < 32U) ? (wheel_now >> span) << span : 0;
+
+    *event_tick = base + (slot << shift);
+    /* only the top level can hold slots of the next rotation */
+    if(slot <= current && span < 32U)
+    { *event_tick += 1UL << span; }
+    return true;
+  }
+  return false;
+}
+
+/* move an idle wheel up to the kernel time, allowed only with nothing due in between */
+static void app_timer_wheel_sync(void)
+{
+  uint32_t kernel_tick;
+  uint32_t target = app_timer_wheel_target(&kernel_tick);
+  uint32_t event_tick;
+
+  if(app_timer_wheel_next_event(&event_tick) && (int32_t)(event_tick - target) <= 0)
+  { return; }
+  wheel_now         = target;
+  wheel_kernel_tick = kernel_tick;
+}
+
+static void app_timer_wheel_insert(app_timer_job_t *job)
+{
+  uint32_t level = 0;
+
+  while(level < APP_TIMER_WHEEL_LEVELS - 1U
+        && ((job->expiry ^ wheel_now) >> (APP_TIMER_WHEEL_SLOT_BITS * (level + 1U))) != 0)
+  { level++; }
+
+  uint32_t slot        = (job->expiry >> (APP_TIMER_WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+  app_timer_job_t **head = &wheel_slots[level][slot];
+
+  job->level = (uint8_t)level;
+  job->slot  = (uint8_t)slot;
+  job->next  = *head;
+  if(job->next != NULL)
+  { job->next->link = &job->next; }
+  job->link = head;
+  *head     = job;
+  wheel_occupied[level] |= 1ULL << slot;
+}
+
+static void app_timer_wheel_remove(app_timer_job_t *job)
+{
+  *job->link = job->next;
+  if(job->next != NULL)
+  { job->next->link = job->link; }
+  if(wheel_slots[job->level][job->slot] == NULL)
+  { wheel_occupied[job->level] &= ~(1ULL << job->slot); }
+  job->next = NULL;
+  job->link = NULL;
+  wheel_stats.armed--;
+}
+
+static app_timer_job_t *app_timer_wheel_take_slot(uint32_t level, uint32_t slot)
+{
+  app_timer_job_t *list = wheel_slots[level][slot];
+
+  wheel_slots[level][slot] = NULL;
+  wheel_occupied[level]   &= ~(1ULL << slot);
+  return list;
+}
+
+static void app_timer_wheel_process(uint32_t tick, uint32_t target)
+{
+  /* cascade from the top so a job can fall through several levels in one go */
+  for(uint32_t level = APP_TIMER_WHEEL_LEVELS - 1U; level > 0; level--)
+  {
+    uint32_t shift = APP_TIMER_WHEEL_SLOT_BITS * level;
+    if((tick & ((1UL << shift) - 1U)) != 0)
+    { continue; }
+
+    app_timer_job_t *job = app_timer_wheel_take_slot(level, (tick >> shift) & WHEEL_SLOT_MASK);
+    while(job != NULL)
+    {
+      app_timer_job_t *next = job->next;
+      app_timer_wheel_insert(job);
+      wheel_stats.cascades++;
+      job = next;
+    }
+  }
+
+  app_timer_job_t *job = app_timer_wheel_take_slot(0, tick & WHEEL_SLOT_MASK);
+  while(job != NULL)
+  {
+    app_timer_job_t *next = job->next;
+    uint32_t late_ms      = (target - job->expiry) * APP_TIMER_WHEEL_RESOLUTION_MS;
+
+    job->next = NULL;
+    job->link = NULL;
+    wheel_stats.armed--;
+    wheel_stats.runs++;
+    job->runs++;
+    if(late_ms > job->max_late_ms)
+    { job->max_late_ms = late_ms; }
+
+    /* rearm before the call so the callback may stop or restart its own job */
+    if(job->period != 0)
+    {
+      uint32_t nominal = job->nominal + job->period;
+      if((int32_t)(nominal - target) <= 0)
+      {
+        uint32_t skipped = (target - nominal) / job->period + 1U;
+        nominal     += skipped * job->period;
+        job->missed += skipped;
+      }
+      app_timer_wheel_arm(job, nominal);
+    }
+    job->callback(job->context);
+    job = next;
+  }
+}
+
+static void app_timer_wheel_arm(app_timer_job_t *job, uint32_t nominal)
+{
+  job->nominal = nominal;
+  job->expiry  = nominal;
+  if(job->jitter != 0)
+  {
+    /* xorshift32, spreads jobs that share a period over jitter ticks */
+    wheel_random ^= wheel_random << 13;
+    wheel_random ^= wheel_random >> 17;
+    wheel_random ^= wheel_random << 5;
+    job->expiry += wheel_random % (job->jitter + 1U);
+  }
+  if((int32_t)(job->expiry - wheel_now) <= 0)
+  { job->expiry = wheel_now + 1U; }
+  app_timer_wheel_insert(job);
+  wheel_stats.armed++;
+}
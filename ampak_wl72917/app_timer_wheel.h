@@ -0,0 +1,72 @@
+/*
+ * app_timer_wheel.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_APP_TIMER_WHEEL_H_
+#define AMPAK_WL72917_APP_TIMER_WHEEL_H_
+
+#include "sl_status.h"
+#include "stdint.h"
+#include "stdbool.h"
+
+/** one wheel tick, in ms **/
+#define APP_TIMER_WHEEL_RESOLUTION_MS 10U
+/** 4 levels of 64 slots **/
+#define APP_TIMER_WHEEL_LEVELS     4U
+#define APP_TIMER_WHEEL_SLOT_BITS  6U
+#define APP_TIMER_WHEEL_SLOTS      (1UL << APP_TIMER_WHEEL_SLOT_BITS)
+/** longest period + phase + jitter, in wheel ticks (about 46 hours at 10 ms) **/
+#define APP_TIMER_WHEEL_MAX_TICKS  ((APP_TIMER_WHEEL_SLOTS - 1U) << (APP_TIMER_WHEEL_SLOT_BITS * (APP_TIMER_WHEEL_LEVELS - 1U)))
+
+typedef void (*app_timer_callback_t)(void *context);
+
+typedef struct app_timer_job_s {
+  struct app_timer_job_s *next;
+  struct app_timer_job_s **link;    /* slot or predecessor pointing at this job, NULL when idle */
+  const char *name;
+  app_timer_callback_t callback;
+  void *context;
+  uint32_t period;                  /* wheel ticks, 0 for one shot */
+  uint32_t jitter;                  /* wheel ticks of random delay added per run */
+  uint32_t nominal;                 /* tick the job is due without jitter */
+  uint32_t expiry;                  /* tick the job actually runs */
+  uint32_t runs;
+  uint32_t missed;                  /* periods skipped because the wheel ran late */
+  uint32_t max_late_ms;
+  uint8_t level;
+  uint8_t slot;
+} app_timer_job_t;
+
+typedef struct {
+  uint32_t now;                     /* wheel ticks since init */
+  uint32_t armed;
+  uint32_t runs;
+  uint32_t cascades;                /* jobs moved down a level */
+} app_timer_wheel_stats_t;
+
+/**
+ * Hierarchical timer wheel for periodic application jobs.
+ *
+ * Start, stop and expiry are O(1); the next deadline is found from per level
+ * occupancy bitmaps, O(levels). Periods are aligned to the wheel epoch plus a
+ * phase, so jobs with related periods come due in the same tick and share one
+ * wake up. Jitter delays single runs without drifting the schedule.
+ *
+ * Job storage belongs to the caller. All functions must run on one thread,
+ * the reactor thread; app_timer_wheel_next_wait() and app_timer_wheel_run()
+ * plug straight into app_reactor_set_deadline().
+ */
+void app_timer_wheel_init(void);
+void app_timer_job_init(app_timer_job_t *job, const char *name, app_timer_callback_t callback, void *context);
+sl_status_t app_timer_job_start(app_timer_job_t *job, uint32_t period_ms, uint32_t phase_ms, uint32_t jitter_ms);
+sl_status_t app_timer_job_start_once(app_timer_job_t *job, uint32_t delay_ms);
+void app_timer_job_stop(app_timer_job_t *job);
+bool app_timer_job_is_armed(const app_timer_job_t *job);
+uint32_t app_timer_wheel_next_wait(void);
+void app_timer_wheel_run(void *context);
+void app_timer_wheel_get_stats(app_timer_wheel_stats_t *stats);
+
+#endif /* AMPAK_WL72917_APP_TIMER_WHEEL_H_ */
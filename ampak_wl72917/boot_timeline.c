@@ -0,0 +1,157 @@
+/*
+ * boot_timeline.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#include "ampak_wl72917/boot_timeline.h"
+#include "ampak_wl72917/ampak_fmt.h"
+#include "si91x_device.h"
+#include "cmsis_os2.h"
+
+typedef struct {
+  uint32_t offset_us[boot_timeline_points];
+  uint32_t marked;            /* bit per point */
+  uint32_t last_cycles;
+  uint32_t last_tick;
+  uint32_t last_offset_us;
+} boot_timeline_record_t;
+
+static const char *const timeline_kind_names[boot_timeline_kind_count] = { "boot", "wake" };
+static const char *const timeline_point_names[boot_timeline_points] = {
+  "main", "sys", "app", "neti", "netu", "mac", "cred", "conn", "ack", "sub", "pub",
+};
+
+/* .bss, so zero after reset and kept over sleep with retention */
+static boot_timeline_record_t timeline_records[boot_timeline_kind_count];
+static volatile bootTimelineKind_t timeline_active;
+
+/**
+ *  Local functions
+ */
+
+static void boot_timeline_begin(bootTimelineKind_t kind);
+static void boot_timeline_restart_counter(void);
+static uint32_t boot_timeline_elapsed_us(boot_timeline_record_t *record);
+
+/**
+ * Function implementation
+ */
+
+void boot_timeline_start(void)
+{
+  boot_timeline_begin(boot_timeline_kind_cold);
+  timeline_records[boot_timeline_kind_wake].marked = 0;
+  boot_timeline_mark(boot_timeline_main);
+}
+
+void boot_timeline_wake(void)
+{
+  /* the first subscribe and publish can come after the first sleep, keep the cold record until it completes */
+  if(!boot_timeline_is_complete(boot_timeline_kind_cold))
+  {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    boot_timeline_record_t *record = &timeline_records[boot_timeline_kind_cold];
+    uint32_t tick = osKernelGetTickCount();
+
+    /* the cycle counter was stopped during sleep, the kernel tick covers the gap */
+    record->last_offset_us += (uint32_t)(((uint64_t)(tick - record->last_tick) * 1000000U) / osKernelGetTickFreq());
+    record->last_tick       = tick;
+    record->last_cycles     = 0;
+    boot_timeline_restart_counter();
+
+    __set_PRIMASK(primask);
+    return;
+  }
+  boot_timeline_begin(boot_timeline_kind_wake);
+}
+
+bool boot_timeline_mark(bootTimelinePoint_t point)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  boot_timeline_record_t *record = &timeline_records[timeline_active];
+  bool completed = false;
+
+  if((record->marked & (1UL << point)) == 0)
+  {
+    record->last_offset_us  += boot_timeline_elapsed_us(record);
+    record->offset_us[point] = record->last_offset_us;
+    record->marked          |= 1UL << point;
+    completed = (point == boot_timeline_publish);
+  }
+
+  __set_PRIMASK(primask);
+  return completed;
+}
+
+bool boot_timeline_is_complete(bootTimelineKind_t kind)
+{
+  return (timeline_records[kind].marked & (1UL << boot_timeline_publish)) != 0;
+}
+
+bootTimelineKind_t boot_timeline_active(void)
+{
+  return timeline_active;
+}
+
+uint32_t boot_timeline_format(bootTimelineKind_t kind, char *buffer, uint32_t size)
+{
+  const boot_timeline_record_t *record = &timeline_records[kind];
+  ampak_fmt_t fmt;
+
+  ampak_fmt_str(ampak_fmt_init(&fmt, buffer, size), timeline_kind_names[kind]);
+  for(uint32_t point = 0; point < boot_timeline_points; point++)
+  {
+    if((record->marked & (1UL << point)) == 0)
+    { continue; }
+    ampak_fmt_char(ampak_fmt_str(ampak_fmt_char(&fmt, ' '), timeline_point_names[point]), ':');
+    ampak_fmt_u32(&fmt, record->offset_us[point]);
+  }
+  return ampak_fmt_length(&fmt);
+}
+
+static void boot_timeline_begin(bootTimelineKind_t kind)
+{
+  boot_timeline_record_t *record = &timeline_records[kind];
+
+  boot_timeline_restart_counter();
+
+  record->marked         = 0;
+  record->last_cycles    = 0;
+  record->last_tick      = osKernelGetTickCount();
+  record->last_offset_us = 0;
+  timeline_active        = kind;
+}
+
+/* the counter stops with the core, so enable it again after every wake */
+static void boot_timeline_restart_counter(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT       = 0;
+  DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/* time since the last mark: cycles when they cannot have wrapped, kernel ticks otherwise */
+static uint32_t boot_timeline_elapsed_us(boot_timeline_record_t *record)
+{
+  uint32_t cycles      = DWT->CYCCNT;
+  uint32_t tick        = osKernelGetTickCount();
+  uint32_t cycles_us   = SystemCoreClock / 1000000U;
+  uint32_t tick_ms     = ((tick - record->last_tick) * 1000U) / osKernelGetTickFreq();
+  uint32_t elapsed_us;
+
+  /* half the wrap period, 11 s at 180 MHz */
+  if(cycles_us != 0 && tick_ms < (0x80000000U / cycles_us) / 1000U)
+  { elapsed_us = (cycles - record->last_cycles) / cycles_us; }
+  else
+  { elapsed_us = tick_ms * 1000U; }
+
+  record->last_cycles = cycles;
+  record->last_tick   = tick;
+  return elapsed_us;
+}
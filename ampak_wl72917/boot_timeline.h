@@ -0,0 +1,59 @@
+/*
+ * boot_timeline.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_BOOT_TIMELINE_H_
+#define AMPAK_WL72917_BOOT_TIMELINE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+/** compact record, e.g. "boot main:0 sys:1520 ... pub:4210331" (us) **/
+#define BOOT_TIMELINE_TEXT_SIZE 200U
+
+typedef enum {
+  boot_timeline_main = 0,
+  boot_timeline_system_init,
+  boot_timeline_mqtt_init,
+  boot_timeline_net_init,
+  boot_timeline_net_up,
+  boot_timeline_mac,
+  boot_timeline_credentials,
+  boot_timeline_connect,
+  boot_timeline_connack,
+  boot_timeline_suback,
+  boot_timeline_publish,
+  boot_timeline_points,
+} bootTimelinePoint_t;
+
+typedef enum {
+  boot_timeline_kind_cold = 0,  /* main() to first publish */
+  boot_timeline_kind_wake,      /* M4 wake to next publish */
+  boot_timeline_kind_count,
+} bootTimelineKind_t;
+
+/**
+ * Startup latency breakdown.
+ *
+ * Each point is stamped once per timeline, in us from its start. The DWT cycle
+ * counter gives sub-us steps before the kernel runs; gaps longer than the
+ * counter can cover are taken from the kernel tick. Timelines live in RAM
+ * kept over M4 sleep with retention, so the cold boot record is still there
+ * when a wake record is taken. A wake before the cold record completed
+ * does not start a wake record; the cold one keeps collecting its marks.
+ *
+ * boot_timeline_start() must be the first call in main(). Marks may come from
+ * any thread; a point already stamped is left as it is. boot_timeline_mark()
+ * returns true for the mark that completed the active timeline.
+ */
+void boot_timeline_start(void);
+void boot_timeline_wake(void);
+bool boot_timeline_mark(bootTimelinePoint_t point);
+bool boot_timeline_is_complete(bootTimelineKind_t kind);
+bootTimelineKind_t boot_timeline_active(void);
+uint32_t boot_timeline_format(bootTimelineKind_t kind, char *buffer, uint32_t size);
+
+#endif /* AMPAK_WL72917_BOOT_TIMELINE_H_ */
@@ -0,0 +1,239 @@
+/*
+ * mqtt_broker_list.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#include "ampak_wl72917/mqtt_broker_list.h"
+#include "sl_net.h"
+#include "cmsis_os2.h"
+#include "stdio.h"
+#include "string.h"
+
+/** smoothed latency weight, srtt = srtt * 7/8 + sample / 8 **/
+#define MQTT_BROKER_LIST_RTT_SHIFT 3U
+
+typedef struct {
+  sl_ip_address_t ip;
+  bool literal;               /* address given in the list, never expires */
+  bool resolved;
+  uint32_t resolved_ms;
+  uint32_t srtt_ms;
+  uint32_t failures;          /* consecutive, drives the backoff */
+  uint32_t total_failures;
+  uint32_t connects;
+  uint32_t resolves;
+  uint32_t retry_ms;          /* backing off until then while failures != 0 */
+} mqtt_broker_state_t;
+
+static const mqtt_broker_endpoint_t *broker_endpoints = NULL;
+static uint32_t broker_count;
+static uint32_t broker_selected;
+static mqtt_broker_state_t broker_states[MQTT_BROKER_LIST_MAX_ENDPOINTS];
+
+/**
+ *  Local functions
+ */
+
+static uint32_t mqtt_broker_list_now_ms(void);
+static bool mqtt_broker_list_backing_off(const mqtt_broker_state_t *state, uint32_t now);
+static uint32_t mqtt_broker_list_pick(uint32_t tried, uint32_t now);
+static sl_status_t mqtt_broker_list_resolve(uint32_t index, uint32_t now);
+static void mqtt_broker_list_fail(uint32_t index, uint32_t now);
+
+/**
+ * Function implementation
+ */
+
+sl_status_t mqtt_broker_list_init(const mqtt_broker_endpoint_t *endpoints, uint32_t count)
+{
+  if(endpoints == NULL)
+  { return SL_STATUS_NULL_POINTER; }
+  if(count == 0 || count > MQTT_BROKER_LIST_MAX_ENDPOINTS)
+  { return SL_STATUS_INVALID_PARAMETER; }
+
+  broker_endpoints = endpoints;
+  broker_count     = count;
+  broker_selected  = 0;
+  memset(broker_states, 0, sizeof(broker_states));
+
+  for(uint32_t i = 0; i < count; i++)
+  {
+    mqtt_broker_state_t *state = &broker_states[i];
+    if(sl_net_inet_addr(endpoints[i].host, &state->ip.ip.v4.value) == SL_STATUS_OK)
+    {
+      state->ip.type  = SL_IPV4;
+      state->literal  = true;
+      state->resolved = true;
+    }
+  }
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_broker_list_select(sl_mqtt_broker_t *broker)
+{
+  uint32_t now        = mqtt_broker_list_now_ms();
+  uint32_t tried      = 0;
+  sl_status_t status  = SL_STATUS_NOT_INITIALIZED;
+
+  if(broker_endpoints == NULL)
+  { return status; }
+
+  for(uint32_t attempt = 0; attempt < broker_count; attempt++)
+  {
+    uint32_t index = mqtt_broker_list_pick(tried, now);
+
+    tried |= 1UL << index;
+    status = mqtt_broker_list_resolve(index, now);
+    if(status != SL_STATUS_OK)
+    {
+      printf("Broker %s not resolved: 0x%lx\r\n", broker_endpoints[index].host, status);
+      mqtt_broker_list_fail(index, now);
+      continue;
+    }
+
+    broker_selected = index;
+    broker->ip      = broker_states[index].ip;
+    broker->port    = broker_endpoints[index].port;
+    return SL_STATUS_OK;
+  }
+  return status;
+}
+
+void mqtt_broker_list_on_connected(uint32_t connect_ms)
+{
+  mqtt_broker_state_t *state = &broker_states[broker_selected];
+
+  if(broker_endpoints == NULL)
+  { return; }
+
+  if(state->srtt_ms == 0)
+  { state->srtt_ms = (connect_ms != 0) ? connect_ms : 1U; }
+  else
+  { state->srtt_ms = (state->srtt_ms * ((1U << MQTT_BROKER_LIST_RTT_SHIFT) - 1U) + connect_ms) >> MQTT_BROKER_LIST_RTT_SHIFT; }
+  state->failures = 0;
+  state->connects++;
+}
+
+void mqtt_broker_list_on_connect_failed(void)
+{
+  if(broker_endpoints == NULL)
+  { return; }
+  mqtt_broker_list_fail(broker_selected, mqtt_broker_list_now_ms());
+}
+
+uint32_t mqtt_broker_list_retry_delay_ms(void)
+{
+  uint32_t now   = mqtt_broker_list_now_ms();
+  uint32_t delay = MQTT_BROKER_LIST_BACKOFF_MAX_MS;
+
+  for(uint32_t i = 0; i < broker_count; i++)
+  {
+    if(!mqtt_broker_list_backing_off(&broker_states[i], now))
+    { return 0; }
+    if(broker_states[i].retry_ms - now < delay)
+    { delay = broker_states[i].retry_ms - now; }
+  }
+  return delay;
+}
+
+uint32_t mqtt_broker_list_get_status(mqtt_broker_status_t *status, uint32_t max_status)
+{
+  uint32_t count = (broker_count < max_status) ? broker_count : max_status;
+
+  for(uint32_t i = 0; i < count; i++)
+  {
+    const mqtt_broker_state_t *state = &broker_states[i];
+    status[i].host     = broker_endpoints[i].host;
+    status[i].address  = state->resolved ? state->ip.ip.v4.value : 0;
+    status[i].srtt_ms  = state->srtt_ms;
+    status[i].connects = state->connects;
+    status[i].failures = state->total_failures;
+    status[i].resolves = state->resolves;
+    status[i].selected = (i == broker_selected);
+  }
+  return count;
+}
+
+static uint32_t mqtt_broker_list_now_ms(void)
+{
+  return (uint32_t)(((uint64_t)osKernelGetTickCount() * 1000U) / osKernelGetTickFreq());
+}
+
+static bool mqtt_broker_list_backing_off(const mqtt_broker_state_t *state, uint32_t now)
+{
+  return state->failures != 0 && (int32_t)(now - state->retry_ms) < 0;
+}
+
+/* fastest untried endpoint not backing off, or the one out of backoff first when all are */
+static uint32_t mqtt_broker_list_pick(uint32_t tried, uint32_t now)
+{
+  uint32_t best       = broker_count;
+  uint32_t best_rank  = 0;
+  bool best_available = false;
+
+  for(uint32_t i = 0; i < broker_count; i++)
+  {
+    const mqtt_broker_state_t *state = &broker_states[i];
+    if((tried & (1UL << i)) != 0)
+    { continue; }
+
+    bool available = !mqtt_broker_list_backing_off(state, now);
+    uint32_t rank;
+    if(available)
+    { rank = (state->srtt_ms != 0) ? state->srtt_ms : MQTT_BROKER_LIST_UNMEASURED_MS; }
+    else
+    { rank = state->retry_ms - now; }
+
+    if(best == broker_count || (available && !best_available) || (available == best_available && rank < best_rank))
+    {
+      best           = i;
+      best_rank      = rank;
+      best_available = available;
+    }
+  }
+  return best;
+}
+
+static sl_status_t mqtt_broker_list_resolve(uint32_t index, uint32_t now)
+{
+  mqtt_broker_state_t *state = &broker_states[index];
+  sl_ip_address_t ip;
+
+  if(state->literal || (state->resolved && (now - state->resolved_ms) < MQTT_BROKER_LIST_DNS_TTL_MS))
+  { return SL_STATUS_OK; }
+
+  state->resolved = false;
+  state->resolves++;
+  memset(&ip, 0, sizeof(ip));
+  sl_status_t status = sl_net_host_get_by_name(broker_endpoints[index].host,
+                                               MQTT_BROKER_LIST_DNS_TIMEOUT_MS,
+                                               SL_NET_DNS_TYPE_IPV4,
+                                               &ip);
+  if(status != SL_STATUS_OK)
+  { return status; }
+
+  state->ip          = ip;
+  state->resolved    = true;
+  state->resolved_ms = mqtt_broker_list_now_ms();
+  return SL_STATUS_OK;
+}
+
+static void mqtt_broker_list_fail(uint32_t index, uint32_t now)
+{
+  mqtt_broker_state_t *state = &broker_states[index];
+  uint32_t backoff           = MQTT_BROKER_LIST_BACKOFF_MS;
+
+  state->failures++;
+  state->total_failures++;
+  for(uint32_t i = 1; i < state->failures && backoff < MQTT_BROKER_LIST_BACKOFF_MAX_MS; i++)
+  { backoff *= 2U; }
+  if(backoff > MQTT_BROKER_LIST_BACKOFF_MAX_MS)
+  { backoff = MQTT_BROKER_LIST_BACKOFF_MAX_MS; }
+  state->retry_ms = now + backoff;
+
+  /* the name may point somewhere else by now */
+  if(!state->literal)
+  { state->resolved = false; }
+}
@@ -0,0 +1,66 @@
+/*
+ * mqtt_broker_list.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_MQTT_BROKER_LIST_H_
+#define AMPAK_WL72917_MQTT_BROKER_LIST_H_
+
+#include "sl_mqtt_client.h"
+#include "sl_status.h"
+#include "stdint.h"
+#include "stdbool.h"
+
+#define MQTT_BROKER_LIST_MAX_ENDPOINTS 4U
+
+/** the 3.1.4 resolver does not return the record TTL, so answers are kept this long **/
+#ifndef MQTT_BROKER_LIST_DNS_TTL_MS
+#define MQTT_BROKER_LIST_DNS_TTL_MS 300000UL
+#endif
+#define MQTT_BROKER_LIST_DNS_TIMEOUT_MS 5000U
+/** rank of an endpoint never connected to, so a measured one below this is preferred over exploring **/
+#define MQTT_BROKER_LIST_UNMEASURED_MS 1000U
+/** failed endpoint sits out this long, doubled per consecutive failure **/
+#define MQTT_BROKER_LIST_BACKOFF_MS     5000U
+#define MQTT_BROKER_LIST_BACKOFF_MAX_MS 300000U
+
+typedef struct {
+  const char *host;           /* host name, or dotted IPv4 literal which skips DNS */
+  uint16_t port;
+} mqtt_broker_endpoint_t;
+
+typedef struct {
+  const char *host;
+  uint32_t address;           /* IPv4 network order, 0 when not resolved */
+  uint32_t srtt_ms;           /* smoothed TCP/TLS+CONNACK latency, 0 until measured */
+  uint32_t connects;
+  uint32_t failures;
+  uint32_t resolves;          /* DNS queries sent, cache hits not counted */
+  bool selected;
+} mqtt_broker_status_t;
+
+/**
+ * Broker endpoint list.
+ *
+ * mqtt_broker_list_select() fills the broker address and port from the best
+ * endpoint: the lowest smoothed connect latency among those not backing off
+ * after a failure, list order breaking ties. Names are resolved through the
+ * NWP DNS client and cached for MQTT_BROKER_LIST_DNS_TTL_MS; an endpoint
+ * whose name does not resolve is skipped like a failed connect.
+ *
+ * Report the outcome of every connect to the selected endpoint, a failure
+ * also drops its cached address, so the next select fails over to the next
+ * endpoint. The endpoint array must stay valid, it is not copied.
+ * Not thread safe, call from the task that connects.
+ */
+sl_status_t mqtt_broker_list_init(const mqtt_broker_endpoint_t *endpoints, uint32_t count);
+sl_status_t mqtt_broker_list_select(sl_mqtt_broker_t *broker);
+void mqtt_broker_list_on_connected(uint32_t connect_ms);
+void mqtt_broker_list_on_connect_failed(void);
+/** ms until an endpoint is out of backoff, 0 if one is now **/
+uint32_t mqtt_broker_list_retry_delay_ms(void);
+uint32_t mqtt_broker_list_get_status(mqtt_broker_status_t *status, uint32_t max_status);
+
+#endif /* AMPAK_WL72917_MQTT_BROKER_LIST_H_ */
@@ -0,0 +1,224 @@
+/*
+ * mqtt_command.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+/**
+ * Command registry with a perfect hash.
+ *
+ * Slot = FNV-1a(seed, verb) folded onto MQTT_COMMAND_TABLE_SLOTS. The build
+ * tries seeds until no two registered verbs share a slot, so lookup is one hash
+ * over the verb bytes, one table read and one length + memcmp check. The verb
+ * is delimited by length inside the payload; nothing is copied or terminated.
+ *
+ * There is no code generator in this build, so the seed is searched once at
+ * start up. With the table at twice the command count this takes a handful of
+ * tries. Defining MQTT_COMMAND_HASH_SEED pins the seed; build then only checks it.
+ */
+
+#include "ampak_wl72917/mqtt_command.h"
+#include "ampak_wl72917/ampak_fmt.h"
+#include "stdio.h"
+#include "string.h"
+
+#if (MQTT_COMMAND_TABLE_SLOTS & (MQTT_COMMAND_TABLE_SLOTS - 1U)) != 0
+#error "MQTT_COMMAND_TABLE_SLOTS must be a power of two"
+#endif
+#if MQTT_COMMAND_MAX >= 0xFFU || MQTT_COMMAND_MAX > MQTT_COMMAND_TABLE_SLOTS
+#error "MQTT_COMMAND_MAX must fit the table and an uint8_t index"
+#endif
+
+#define MQTT_COMMAND_FNV_OFFSET 2166136261U
+#define MQTT_COMMAND_FNV_PRIME  16777619U
+#define MQTT_COMMAND_EMPTY      0xFFU
+
+static const mqtt_command_t *command_list[MQTT_COMMAND_MAX];
+static uint8_t command_name_length[MQTT_COMMAND_MAX];
+static uint32_t command_count;
+
+static uint8_t command_table[MQTT_COMMAND_TABLE_SLOTS];
+static uint32_t command_seed;
+static bool command_built;
+
+/**
+ *  Local functions
+ */
+
+static uint32_t mqtt_command_slot(uint32_t seed, const uint8_t *name, uint32_t length);
+static bool mqtt_command_try_seed(uint32_t seed);
+static bool mqtt_command_parse_args(const mqtt_command_t *command,
+                                    const uint8_t *text,
+                                    uint16_t text_length,
+                                    mqtt_command_args_t *args);
+
+/**
+ * Function implementation
+ */
+
+sl_status_t mqtt_command_register(const mqtt_command_t *command)
+{
+  if(command == NULL || command->name == NULL || command->handler == NULL)
+  { return SL_STATUS_NULL_POINTER; }
+  if(command_count >= MQTT_COMMAND_MAX)
+  { return SL_STATUS_FULL; }
+
+  size_t length = strlen(command->name);
+  if(length == 0 || length > MQTT_COMMAND_NAME_MAX || memchr(command->name, MQTT_COMMAND_DELIMITER, length) != NULL)
+  { return SL_STATUS_INVALID_PARAMETER; }
+
+  for(uint32_t i = 0; i < command_count; i++)
+  {
+    if(command_name_length[i] == length && memcmp(command_list[i]->name, command->name, length) == 0)
+    { return SL_STATUS_ALREADY_EXISTS; }
+  }
+
+  command_list[command_count]        = command;
+  command_name_length[command_count] = (uint8_t)length;
+  command_count++;
+  command_built = false;
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_command_build(void)
+{
+#ifdef MQTT_COMMAND_HASH_SEED
+  command_built = mqtt_command_try_seed(MQTT_COMMAND_HASH_SEED);
+  if(command_built)
+  { command_seed = MQTT_COMMAND_HASH_SEED; }
+#else
+  command_built = false;
+  for(uint32_t seed = 1; seed <= MQTT_COMMAND_SEED_TRIES && !command_built; seed++)
+  {
+    command_built = mqtt_command_try_seed(seed);
+    if(command_built)
+    { command_seed = seed; }
+  }
+#endif
+
+  if(!command_built)
+  {
+    printf("No perfect hash seed for %lu commands\r\n", command_count);
+    return SL_STATUS_FAIL;
+  }
+  printf("Command table: %lu commands, seed %lu\r\n", command_count, command_seed);
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_command_dispatch(const uint8_t *payload,
+                                  uint16_t payload_length,
+                                  char *reply,
+                                  uint32_t reply_size,
+                                  uint32_t *reply_length)
+{
+  *reply_length = 0;
+  if(reply_size == 0)
+  { return SL_STATUS_INVALID_PARAMETER; }
+  if(!command_built)
+  { return SL_STATUS_NOT_INITIALIZED; }
+
+  const uint8_t *delimiter = memchr(payload, MQTT_COMMAND_DELIMITER, payload_length);
+  uint16_t verb_length     = (delimiter != NULL) ? (uint16_t)(delimiter - payload) : payload_length;
+
+  if(verb_length == 0 || verb_length > MQTT_COMMAND_NAME_MAX)
+  { return SL_STATUS_NOT_FOUND; }
+
+  uint8_t index = command_table[mqtt_command_slot(command_seed, payload, verb_length)];
+  if(index == MQTT_COMMAND_EMPTY || command_name_length[index] != verb_length
+     || memcmp(command_list[index]->name, payload, verb_length) != 0)
+  { return SL_STATUS_NOT_FOUND; }
+
+  const mqtt_command_t *command = command_list[index];
+  mqtt_command_args_t args;
+  const uint8_t *text = (delimiter != NULL) ? delimiter + 1 : payload + payload_length;
+
+  if(!mqtt_command_parse_args(command, text, (uint16_t)(payload + payload_length - text), &args))
+  { return SL_STATUS_INVALID_PARAMETER; }
+
+  uint32_t written   = 0;
+  sl_status_t status = command->handler(&args, reply, reply_size, &written);
+  ampak_fmt_t fmt;
+
+  if(status != SL_STATUS_OK)
+  { return status; }
+
+  switch(command->reply)
+  {
+    case mqtt_command_reply_ack:
+      ampak_fmt_str(ampak_fmt_lit(ampak_fmt_init(&fmt, reply, reply_size), "Ack: "), command->name);
+      written = ampak_fmt_length(&fmt);
+      break;
+    case mqtt_command_reply_result:
+      break;
+    default:
+      written = 0;
+      break;
+  }
+
+  *reply_length = (written < reply_size) ? written : reply_size - 1U;
+  return SL_STATUS_OK;
+}
+
+static uint32_t mqtt_command_slot(uint32_t seed, const uint8_t *name, uint32_t length)
+{
+  uint32_t hash = MQTT_COMMAND_FNV_OFFSET ^ (seed * MQTT_COMMAND_FNV_PRIME);
+
+  for(uint32_t i = 0; i < length; i++)
+  {
+    hash ^= name[i];
+    hash *= MQTT_COMMAND_FNV_PRIME;
+  }
+  hash ^= hash >> 16;
+  return hash & (MQTT_COMMAND_TABLE_SLOTS - 1U);
+}
+
+static bool mqtt_command_try_seed(uint32_t seed)
+{
+  memset(command_table, MQTT_COMMAND_EMPTY, sizeof(command_table));
+
+  for(uint32_t i = 0; i < command_count; i++)
+  {
+    uint32_t slot = mqtt_command_slot(seed, (const uint8_t *)command_list[i]->name, command_name_length[i]);
+    if(command_table[slot] != MQTT_COMMAND_EMPTY)
+    { return false; }
+    command_table[slot] = (uint8_t)i;
+  }
+  return true;
+}
+
+static bool mqtt_command_parse_args(const mqtt_command_t *command,
+                                    const uint8_t *text,
+                                    uint16_t text_length,
+                                    mqtt_command_args_t *args)
+{
+  args->text        = text;
+  args->text_length = text_length;
+  args->value       = 0;
+
+  switch(command->args)
+  {
+    case mqtt_command_args_none:
+      return (text_length == 0);
+
+    case mqtt_command_args_text:
+      return (text_length <= command->max_arg_length);
+
+    case mqtt_command_args_u32:
+      if(text_length == 0 || text_length > command->max_arg_length || text_length > 10U)
+      { return false; }
+      for(uint16_t i = 0; i < text_length; i++)
+      {
+        if(text[i] < '0' || text[i] > '9')
+        { return false; }
+        uint64_t value = (uint64_t)args->value * 10U + (uint32_t)(text[i] - '0');
+        if(value > 0xFFFFFFFFU)
+        { return false; }
+        args->value = (uint32_t)value;
+      }
+      return true;
+
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,78 @@
+/*
+ * mqtt_command.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_MQTT_COMMAND_H_
+#define AMPAK_WL72917_MQTT_COMMAND_H_
+
+#include "sl_status.h"
+#include "stdint.h"
+#include "stdbool.h"
+
+#define MQTT_COMMAND_MAX 64U
+/** must be a power of two, at least twice MQTT_COMMAND_MAX keeps the seed search short **/
+#define MQTT_COMMAND_TABLE_SLOTS 128U
+#define MQTT_COMMAND_SEED_TRIES 4096U
+#define MQTT_COMMAND_NAME_MAX 32U
+
+/** separates the verb from its argument in a payload **/
+#define MQTT_COMMAND_DELIMITER ' '
+
+typedef enum {
+  mqtt_command_args_none = 0, /* verb only */
+  mqtt_command_args_text,     /* raw bytes, up to max_arg_length */
+  mqtt_command_args_u32,      /* decimal, at most max_arg_length digits */
+} mqttCommandArgs_t;
+
+typedef enum {
+  mqtt_command_reply_none = 0, /* nothing is published back */
+  mqtt_command_reply_ack,      /* "Ack: <verb>" once the handler succeeded */
+  mqtt_command_reply_result,   /* whatever the handler wrote */
+} mqttCommandReply_t;
+
+typedef struct {
+  const uint8_t *text;    /* points into the received payload, not terminated */
+  uint16_t text_length;
+  uint32_t value;         /* mqtt_command_args_u32 only */
+} mqtt_command_args_t;
+
+/**
+ * @param reply         buffer for mqtt_command_reply_result, always terminated by the caller
+ * @param reply_size    size of reply
+ * @param reply_length  length written to reply, 0 on entry
+ * @return SL_STATUS_OK when the command was carried out; anything else is
+ *         returned by mqtt_command_dispatch() as is and nothing is replied
+ */
+typedef sl_status_t (*mqtt_command_handler_t)(const mqtt_command_args_t *args,
+                                              char *reply,
+                                              uint32_t reply_size,
+                                              uint32_t *reply_length);
+
+typedef struct {
+  const char *name;
+  mqttCommandArgs_t args;
+  uint16_t max_arg_length;
+  mqttCommandReply_t reply;
+  mqtt_command_handler_t handler;
+} mqtt_command_t;
+
+/**
+ * Commands are registered at start up, then mqtt_command_build() finds a hash
+ * seed that puts every verb in its own slot. Dispatch hashes the verb once and
+ * compares one entry, whatever the number of commands.
+ *
+ * Register and build before the first dispatch; dispatch may then run from any
+ * single thread.
+ */
+sl_status_t mqtt_command_register(const mqtt_command_t *command);
+sl_status_t mqtt_command_build(void);
+sl_status_t mqtt_command_dispatch(const uint8_t *payload,
+                                  uint16_t payload_length,
+                                  char *reply,
+                                  uint32_t reply_size,
+                                  uint32_t *reply_length);
+
+#endif /* AMPAK_WL72917_MQTT_COMMAND_H_ */
@@ -0,0 +1,108 @@
+/*
+ * mqtt_dedup.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+/**
+ * The 3.1.4 receive frame does not hand the packet identifier to the host, so
+ * an entry is keyed by FNV-1a hashes of topic and payload plus the length.
+ * 16 entries x 20 bytes, no allocation.
+ */
+
+#include "ampak_wl72917/mqtt_dedup.h"
+#include "cmsis_os2.h"
+#include "string.h"
+
+#define MQTT_DEDUP_FNV_OFFSET 2166136261U
+#define MQTT_DEDUP_FNV_PRIME  16777619U
+
+typedef struct {
+  uint32_t topic_hash;
+  uint32_t content_hash;
+  uint32_t content_length;
+  uint32_t valid;
+  uint32_t tick;
+} mqtt_dedup_entry_t;
+
+static mqtt_dedup_entry_t dedup_entries[MQTT_DEDUP_SLOTS];
+static uint32_t dedup_next;
+static mqtt_dedup_stats_t dedup_stats;
+
+/**
+ *  Local functions
+ */
+
+static uint32_t mqtt_dedup_hash(const uint8_t *data, uint32_t length);
+
+/**
+ * Function implementation
+ */
+
+void mqtt_dedup_new_session(void)
+{
+  memset(dedup_entries, 0, sizeof(dedup_entries));
+  dedup_next = 0;
+}
+
+bool mqtt_dedup_is_duplicate(const uint8_t *topic, uint16_t topic_length,
+                             const uint8_t *content, uint32_t content_length,
+                             uint8_t qos, bool dup)
+{
+  if(qos == 0)
+  { return false; }
+
+  uint32_t topic_hash   = mqtt_dedup_hash(topic, topic_length);
+  uint32_t content_hash = mqtt_dedup_hash(content, content_length);
+  uint32_t now          = osKernelGetTickCount();
+  uint32_t window       = (uint32_t)(((uint64_t)MQTT_DEDUP_WINDOW_MS * osKernelGetTickFreq()) / 1000U);
+
+  dedup_stats.checked++;
+
+  for(uint32_t i = 0; i < MQTT_DEDUP_SLOTS; i++)
+  {
+    mqtt_dedup_entry_t *entry = &dedup_entries[i];
+    if(!entry->valid || (now - entry->tick) > window)
+    { continue; }
+    if(entry->topic_hash == topic_hash && entry->content_hash == content_hash
+       && entry->content_length == content_length)
+    {
+      if(!dup)
+      {
+        /* sent again without DUP: a real repeat, just refresh it */
+        entry->tick = now;
+        return false;
+      }
+      dedup_stats.dropped++;
+      return true;
+    }
+  }
+
+  mqtt_dedup_entry_t *entry = &dedup_entries[dedup_next];
+  dedup_next = (dedup_next + 1U) % MQTT_DEDUP_SLOTS;
+
+  entry->topic_hash     = topic_hash;
+  entry->content_hash   = content_hash;
+  entry->content_length = content_length;
+  entry->valid          = 1;
+  entry->tick           = now;
+  return false;
+}
+
+void mqtt_dedup_get_stats(mqtt_dedup_stats_t *stats)
+{
+  *stats = dedup_stats;
+}
+
+static uint32_t mqtt_dedup_hash(const uint8_t *data, uint32_t length)
+{
+  uint32_t hash = MQTT_DEDUP_FNV_OFFSET;
+
+  for(uint32_t i = 0; i < length; i++)
+  {
+    hash ^= data[i];
+    hash *= MQTT_DEDUP_FNV_PRIME;
+  }
+  return hash;
+}
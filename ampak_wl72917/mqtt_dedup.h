@@ -0,0 +1,39 @@
+/*
+ * mqtt_dedup.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_MQTT_DEDUP_H_
+#define AMPAK_WL72917_MQTT_DEDUP_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#define MQTT_DEDUP_SLOTS 16U
+/** a DUP redelivery older than this is treated as a new command **/
+#define MQTT_DEDUP_WINDOW_MS 120000U
+
+typedef struct {
+  uint32_t checked;
+  uint32_t dropped;
+} mqtt_dedup_stats_t;
+
+/**
+ * Inbound duplicate filter.
+ *
+ * A message is a duplicate only when it is a QoS 1/2 PUBLISH carrying the DUP
+ * flag and the same topic and payload arrived earlier in this session within
+ * MQTT_DEDUP_WINDOW_MS, i.e. the broker resent it because our PUBACK got lost.
+ * Everything else passes: QoS 0 is never resent, a repeat without DUP is a
+ * real command, and with a clean session nothing is redelivered across
+ * connections, so mqtt_dedup_new_session() forgets what was seen.
+ */
+void mqtt_dedup_new_session(void);
+bool mqtt_dedup_is_duplicate(const uint8_t *topic, uint16_t topic_length,
+                             const uint8_t *content, uint32_t content_length,
+                             uint8_t qos, bool dup);
+void mqtt_dedup_get_stats(mqtt_dedup_stats_t *stats);
+
+#endif /* AMPAK_WL72917_MQTT_DEDUP_H_ */
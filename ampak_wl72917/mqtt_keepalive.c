@@ -0,0 +1,258 @@
+/*
+ * mqtt_keepalive.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+/**
+ * Keep alive policy.
+ *
+ * The NWP sends PINGREQ on its own, so the host only sees application traffic.
+ * A drop noticed after the link sat idle for a whole interval means a ping
+ * failed, i.e. the broker or a NAT forgot us before the interval elapsed: that
+ * interval becomes the upper bound. A connection that stayed up for
+ * MQTT_KEEPALIVE_STABLE_INTERVALS intervals and actually idled for one proves
+ * the interval: it becomes the lower bound. The next connect uses the midpoint,
+ * never below RTT x MQTT_KEEPALIVE_RTT_FACTOR.
+ *
+ * State lives in plain static RAM, which is kept over M4 sleep with retention.
+ */
+
+#include "ampak_wl72917/mqtt_keepalive.h"
+#include "cmsis_os2.h"
+#include "stdio.h"
+#include "string.h"
+
+/** stop searching once the bounds are this close, in percent of lower **/
+#define MQTT_KEEPALIVE_CONVERGED_PERCENT 10U
+/** smoothed RTT weight, srtt = srtt * 7/8 + sample / 8 **/
+#define MQTT_KEEPALIVE_RTT_SHIFT 3U
+
+static uint16_t keepalive_lower;
+static uint16_t keepalive_upper;
+static uint16_t keepalive_interval;
+static uint16_t keepalive_retries;
+
+static uint32_t keepalive_srtt_ms;
+static uint32_t keepalive_rtt_start_ms;
+static bool keepalive_rtt_pending;
+
+static bool keepalive_connected;
+static uint32_t keepalive_connected_ms;
+static uint32_t keepalive_last_activity_ms;
+static uint32_t keepalive_max_idle_ms;
+
+static mqtt_keepalive_record_t keepalive_history[MQTT_KEEPALIVE_HISTORY_SLOTS];
+static uint32_t keepalive_history_count;
+
+/**
+ *  Local functions
+ */
+
+static uint32_t mqtt_keepalive_now_ms(void);
+static uint16_t mqtt_keepalive_clamp(uint32_t interval);
+static void mqtt_keepalive_update_idle(uint32_t now);
+static void mqtt_keepalive_record(mqttKeepaliveOutcome_t outcome, uint16_t tested, uint32_t uptime_ms);
+
+/**
+ * Function implementation
+ */
+
+void mqtt_keepalive_init(uint16_t initial_interval, uint16_t retries)
+{
+  keepalive_lower    = 0;
+  keepalive_upper    = 0;
+  keepalive_retries  = retries;
+  keepalive_interval = mqtt_keepalive_clamp(initial_interval);
+}
+
+uint16_t mqtt_keepalive_next_interval(void)
+{
+  return keepalive_interval;
+}
+
+uint16_t mqtt_keepalive_next_retries(void)
+{
+  return keepalive_retries;
+}
+
+void mqtt_keepalive_on_connect_start(void)
+{
+  keepalive_connected = false;
+  keepalive_rtt_pending = false;
+}
+
+void mqtt_keepalive_on_connected(void)
+{
+  uint32_t now = mqtt_keepalive_now_ms();
+
+  keepalive_connected        = true;
+  keepalive_connected_ms     = now;
+  keepalive_last_activity_ms = now;
+  keepalive_max_idle_ms      = 0;
+}
+
+void mqtt_keepalive_on_connect_failed(void)
+{
+  keepalive_connected = false;
+  mqtt_keepalive_record(mqtt_keepalive_outcome_connect_failed, keepalive_interval, 0);
+}
+
+void mqtt_keepalive_on_disconnected(bool requested)
+{
+  if(!keepalive_connected)
+  { return; }
+
+  uint32_t now          = mqtt_keepalive_now_ms();
+  uint32_t interval_ms  = (uint32_t)keepalive_interval * 1000U;
+  uint32_t uptime_ms    = now - keepalive_connected_ms;
+  uint32_t idle_at_drop = now - keepalive_last_activity_ms;
+  uint16_t tested       = keepalive_interval;
+  uint32_t next         = keepalive_interval;
+  mqttKeepaliveOutcome_t outcome;
+
+  keepalive_connected = false;
+  /* the gap before an unrequested drop may be what killed the link, it proves nothing */
+  if(requested)
+  { mqtt_keepalive_update_idle(now); }
+
+  if(!requested && idle_at_drop >= interval_ms)
+  {
+    /* a ping was due and went unanswered */
+    outcome = mqtt_keepalive_outcome_dropped;
+    keepalive_upper = tested;
+    if(keepalive_lower >= keepalive_upper)
+    { keepalive_lower = 0; }
+
+    next = (keepalive_lower != 0) ? ((uint32_t)keepalive_lower + keepalive_upper) / 2U
+                                  : (uint32_t)tested * MQTT_KEEPALIVE_NAT_MARGIN_PERCENT / 100U;
+  }
+  else if(uptime_ms >= interval_ms * MQTT_KEEPALIVE_STABLE_INTERVALS && keepalive_max_idle_ms >= interval_ms)
+  {
+    outcome = mqtt_keepalive_outcome_stable;
+    keepalive_lower = (tested > keepalive_lower) ? tested : keepalive_lower;
+    if(keepalive_upper != 0 && keepalive_upper <= keepalive_lower)
+    { keepalive_upper = 0; } /* network changed, forget the old ceiling */
+
+    if(keepalive_upper == 0)
+    { next = (uint32_t)tested * 2U; }
+    else if((uint32_t)(keepalive_upper - keepalive_lower) * 100U
+            > (uint32_t)keepalive_lower * MQTT_KEEPALIVE_CONVERGED_PERCENT)
+    { next = ((uint32_t)keepalive_lower + keepalive_upper) / 2U; }
+    else
+    { next = keepalive_lower; }
+  }
+  else
+  {
+    /* link loss or our own disconnect before the interval could be judged */
+    outcome = requested ? mqtt_keepalive_outcome_closed : mqtt_keepalive_outcome_dropped;
+  }
+
+  keepalive_interval = mqtt_keepalive_clamp(next);
+  mqtt_keepalive_record(outcome, tested, uptime_ms);
+}
+
+void mqtt_keepalive_on_activity(void)
+{
+  if(!keepalive_connected)
+  { return; }
+
+  uint32_t now = mqtt_keepalive_now_ms();
+  mqtt_keepalive_update_idle(now);
+  keepalive_last_activity_ms = now;
+}
+
+void mqtt_keepalive_on_publish_sent(uint8_t qos_level)
+{
+  mqtt_keepalive_on_activity();
+  if(qos_level == 0)
+  { return; } /* completes once the NWP took the frame, no broker round trip in it */
+  if(keepalive_rtt_pending)
+  { return; } /* one sample in flight at a time, acks are not matched by id */
+
+  keepalive_rtt_start_ms = mqtt_keepalive_now_ms();
+  keepalive_rtt_pending  = true;
+}
+
+void mqtt_keepalive_on_publish_acked(void)
+{
+  mqtt_keepalive_on_activity();
+  if(!keepalive_rtt_pending)
+  { return; }
+
+  uint32_t sample = mqtt_keepalive_now_ms() - keepalive_rtt_start_ms;
+  keepalive_rtt_pending = false;
+
+  if(keepalive_srtt_ms == 0)
+  { keepalive_srtt_ms = sample; }
+  else
+  { keepalive_srtt_ms = keepalive_srtt_ms - (keepalive_srtt_ms >> MQTT_KEEPALIVE_RTT_SHIFT) + (sample >> MQTT_KEEPALIVE_RTT_SHIFT); }
+}
+
+uint32_t mqtt_keepalive_rtt_ms(void)
+{
+  return keepalive_srtt_ms;
+}
+
+uint32_t mqtt_keepalive_history(mqtt_keepalive_record_t *records, uint32_t max_records)
+{
+  uint32_t count = (keepalive_history_count < MQTT_KEEPALIVE_HISTORY_SLOTS) ? keepalive_history_count
+                                                                            : MQTT_KEEPALIVE_HISTORY_SLOTS;
+  count = (count < max_records) ? count : max_records;
+
+  /* newest first */
+  for(uint32_t i = 0; i < count; i++)
+  {
+    records[i] = keepalive_history[(keepalive_history_count - 1U - i) % MQTT_KEEPALIVE_HISTORY_SLOTS];
+  }
+  return count;
+}
+
+static uint32_t mqtt_keepalive_now_ms(void)
+{
+  return (uint32_t)(((uint64_t)osKernelGetTickCount() * 1000U) / osKernelGetTickFreq());
+}
+
+static uint16_t mqtt_keepalive_clamp(uint32_t interval)
+{
+  uint32_t floor = (keepalive_srtt_ms * MQTT_KEEPALIVE_RTT_FACTOR + 999U) / 1000U;
+
+  floor = (floor > MQTT_KEEPALIVE_MIN_INTERVAL) ? floor : MQTT_KEEPALIVE_MIN_INTERVAL;
+  if(interval < floor)
+  { interval = floor; }
+  if(interval > MQTT_KEEPALIVE_MAX_INTERVAL)
+  { interval = MQTT_KEEPALIVE_MAX_INTERVAL; }
+  return (uint16_t)interval;
+}
+
+static void mqtt_keepalive_update_idle(uint32_t now)
+{
+  uint32_t idle = now - keepalive_last_activity_ms;
+  if(idle > keepalive_max_idle_ms)
+  { keepalive_max_idle_ms = idle; }
+}
+
+/** tested is the interval the session ran with, keepalive_interval may already hold the next one **/
+static void mqtt_keepalive_record(mqttKeepaliveOutcome_t outcome, uint16_t tested, uint32_t uptime_ms)
+{
+  mqtt_keepalive_record_t *record = &keepalive_history[keepalive_history_count % MQTT_KEEPALIVE_HISTORY_SLOTS];
+
+  memset(record, 0, sizeof(*record));
+  record->interval   = tested;
+  record->retries    = keepalive_retries;
+  record->rtt_ms     = keepalive_srtt_ms;
+  record->uptime_s   = uptime_ms / 1000U;
+  record->max_idle_s = keepalive_max_idle_ms / 1000U;
+  record->outcome    = (uint8_t)outcome;
+  keepalive_history_count++;
+
+  printf("Keep alive: outcome %d, up %lus, idle %lus, rtt %lums, next %us [%u..%u]\r\n",
+         outcome,
+         record->uptime_s,
+         record->max_idle_s,
+         record->rtt_ms,
+         keepalive_interval,
+         keepalive_lower,
+         keepalive_upper);
+}
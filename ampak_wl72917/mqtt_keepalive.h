@@ -0,0 +1,60 @@
+/*
+ * mqtt_keepalive.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_MQTT_KEEPALIVE_H_
+#define AMPAK_WL72917_MQTT_KEEPALIVE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+/** keep alive interval search bounds, in seconds **/
+#define MQTT_KEEPALIVE_MIN_INTERVAL 30U
+#define MQTT_KEEPALIVE_MAX_INTERVAL 2000U
+
+/** interval is never shorter than RTT x factor **/
+#define MQTT_KEEPALIVE_RTT_FACTOR 4U
+/** back off below a suspected NAT timeout by this percentage **/
+#define MQTT_KEEPALIVE_NAT_MARGIN_PERCENT 75U
+/** a link that stayed up this many intervals proves the interval **/
+#define MQTT_KEEPALIVE_STABLE_INTERVALS 3U
+
+#define MQTT_KEEPALIVE_HISTORY_SLOTS 8U
+
+typedef enum {
+  mqtt_keepalive_outcome_none = 0,
+  mqtt_keepalive_outcome_stable,      /* survived MQTT_KEEPALIVE_STABLE_INTERVALS intervals */
+  mqtt_keepalive_outcome_dropped,     /* broker/NAT dropped the link unexpectedly */
+  mqtt_keepalive_outcome_closed,      /* closed by us before it could be judged */
+  mqtt_keepalive_outcome_connect_failed,
+} mqttKeepaliveOutcome_t;
+
+typedef struct {
+  uint16_t interval;     /* seconds, as sent in CONNECT */
+  uint16_t retries;
+  uint32_t rtt_ms;       /* smoothed publish -> PUBACK time */
+  uint32_t uptime_s;     /* how long the connection lasted */
+  uint32_t max_idle_s;   /* longest observed gap without traffic */
+  uint8_t  outcome;      /* mqttKeepaliveOutcome_t */
+} mqtt_keepalive_record_t;
+
+void mqtt_keepalive_init(uint16_t initial_interval, uint16_t retries);
+uint16_t mqtt_keepalive_next_interval(void);
+uint16_t mqtt_keepalive_next_retries(void);
+
+void mqtt_keepalive_on_connect_start(void);
+void mqtt_keepalive_on_connected(void);
+void mqtt_keepalive_on_connect_failed(void);
+void mqtt_keepalive_on_disconnected(bool requested);
+void mqtt_keepalive_on_activity(void);
+/** only QoS 1/2 publishes sample the round trip; report a QoS 0 completion with mqtt_keepalive_on_activity() **/
+void mqtt_keepalive_on_publish_sent(uint8_t qos_level);
+void mqtt_keepalive_on_publish_acked(void);
+
+uint32_t mqtt_keepalive_rtt_ms(void);
+uint32_t mqtt_keepalive_history(mqtt_keepalive_record_t *records, uint32_t max_records);
+
+#endif /* AMPAK_WL72917_MQTT_KEEPALIVE_H_ */
@@ -0,0 +1,175 @@
+/*
+ * mqtt_link_policy.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+/**
+ * Link quality policy.
+ *
+ * Two signals: RSSI from the NWP and the share of QoS 1/2 publishes that failed
+ * instead of being acked, both smoothed (new = old * 3/4 + sample / 4). QoS 0
+ * has no ack to lose, so it does not count. The link is
+ * good, fair or poor; every state has separate enter and leave thresholds so a
+ * link sitting on a boundary does not flap. Each state maps to a profile: the
+ * QoS cap for non-critical publishes and how many publishes are batched before
+ * the I/O thread wakes the radio for them. At the cell edge every QoS 1 retry
+ * costs airtime, so non-critical data goes QoS 0 in larger, rarer bursts.
+ */
+
+#include "ampak_wl72917/mqtt_link_policy.h"
+#include "cmsis_os2.h"
+#include "sl_mqtt_client.h"
+#include "sl_wifi.h"
+#include "stdatomic.h"
+#include "stdio.h"
+
+static const mqtt_link_profile_t link_profiles[] = {
+  [mqtt_link_good] = { .max_qos = SL_MQTT_QOS_LEVEL_1, .batch_size = 1, .flush_interval_ms = 0 },
+  [mqtt_link_fair] = { .max_qos = SL_MQTT_QOS_LEVEL_1, .batch_size = 2, .flush_interval_ms = 2000 },
+  [mqtt_link_poor] = { .max_qos = SL_MQTT_QOS_LEVEL_0, .batch_size = 4, .flush_interval_ms = 10000 },
+};
+
+static const char *const link_names[] = { "good", "fair", "poor" };
+
+static mqttLinkQuality_t link_quality;
+static int32_t link_rssi;
+static bool link_rssi_valid;
+static uint32_t link_loss_percent;
+static uint32_t link_transitions;
+static uint32_t link_last_sample_tick;
+static bool link_sampled;
+
+static atomic_uint link_acked;
+static atomic_uint link_failed;
+
+/**
+ *  Local functions
+ */
+
+static mqttLinkQuality_t mqtt_link_policy_classify(void);
+
+/**
+ * Function implementation
+ */
+
+void mqtt_link_policy_init(void)
+{
+  link_quality      = mqtt_link_good;
+  link_rssi_valid   = false;
+  link_loss_percent = 0;
+  link_sampled      = false;
+  atomic_store(&link_acked, 0U);
+  atomic_store(&link_failed, 0U);
+}
+
+void mqtt_link_policy_sample(void)
+{
+  uint32_t now = osKernelGetTickCount();
+
+  if(link_sampled && (now - link_last_sample_tick) < (MQTT_LINK_POLICY_SAMPLE_MS * osKernelGetTickFreq()) / 1000U)
+  { return; }
+  link_sampled          = true;
+  link_last_sample_tick = now;
+
+  int32_t rssi = 0;
+  if(sl_wifi_get_signal_strength(SL_WIFI_CLIENT_INTERFACE, &rssi) == SL_STATUS_OK)
+  {
+    link_rssi       = link_rssi_valid ? (link_rssi * 3 + rssi) / 4 : rssi;
+    link_rssi_valid = true;
+  }
+
+  /* keep counting until the window holds enough outcomes to mean something */
+  uint32_t acked  = atomic_load(&link_acked);
+  uint32_t failed = atomic_load(&link_failed);
+  if(acked + failed >= MQTT_LINK_POLICY_MIN_OUTCOMES)
+  {
+    atomic_fetch_sub(&link_acked, acked);
+    atomic_fetch_sub(&link_failed, failed);
+    link_loss_percent = (link_loss_percent * 3U + (failed * 100U) / (acked + failed)) / 4U;
+  }
+  else if(acked + failed == 0)
+  { /* nothing acked either way, e.g. poor caps everything non-critical at QoS 0: let the old loss age out */
+    link_loss_percent = (link_loss_percent * 3U) / 4U;
+  }
+
+  mqttLinkQuality_t quality = mqtt_link_policy_classify();
+  if(quality != link_quality)
+  {
+    link_quality = quality;
+    link_transitions++;
+    printf("Link %s: rssi %ld dBm, loss %lu%%, qos <= %u, batch %u / %lu ms\r\n",
+           link_names[quality],
+           link_rssi,
+           link_loss_percent,
+           link_profiles[quality].max_qos,
+           link_profiles[quality].batch_size,
+           link_profiles[quality].flush_interval_ms);
+  }
+}
+
+void mqtt_link_policy_on_publish_result(bool acked)
+{
+  atomic_fetch_add(acked ? &link_acked : &link_failed, 1U);
+}
+
+uint8_t mqtt_link_policy_qos(uint8_t requested_qos, bool is_critical)
+{
+  uint8_t max_qos = link_profiles[link_quality].max_qos;
+
+  if(is_critical || requested_qos <= max_qos)
+  { return requested_qos; }
+  return max_qos;
+}
+
+bool mqtt_link_policy_flush_due(uint32_t depth, uint32_t oldest_tick, uint32_t *wait_ticks)
+{
+  const mqtt_link_profile_t *profile = &link_profiles[link_quality];
+
+  *wait_ticks = osWaitForever;
+  if(depth == 0)
+  { return false; }
+  if(depth >= profile->batch_size || profile->flush_interval_ms == 0)
+  { return true; }
+
+  uint32_t interval = (profile->flush_interval_ms * osKernelGetTickFreq()) / 1000U;
+  uint32_t age      = osKernelGetTickCount() - oldest_tick;
+  if(age >= interval)
+  { return true; }
+
+  *wait_ticks = interval - age;
+  return false;
+}
+
+void mqtt_link_policy_get_status(mqtt_link_status_t *status)
+{
+  status->quality      = link_quality;
+  status->rssi         = link_rssi;
+  status->loss_percent = link_loss_percent;
+  status->transitions  = link_transitions;
+}
+
+static mqttLinkQuality_t mqtt_link_policy_classify(void)
+{
+  mqttLinkQuality_t next = link_quality;
+  int32_t rssi           = link_rssi_valid ? link_rssi : 0;
+
+  if(link_quality == mqtt_link_good
+     && (rssi < MQTT_LINK_POLICY_GOOD_LEAVE_RSSI || link_loss_percent >= MQTT_LINK_POLICY_GOOD_LEAVE_LOSS))
+  { next = mqtt_link_fair; }
+  else if(link_quality == mqtt_link_poor
+          && rssi >= MQTT_LINK_POLICY_POOR_LEAVE_RSSI && link_loss_percent < MQTT_LINK_POLICY_POOR_LEAVE_LOSS)
+  { next = mqtt_link_fair; }
+
+  if(next != mqtt_link_fair)
+  { return next; }
+
+  /* fair, or just became fair: it may need to go on to poor, or back up to good */
+  if(rssi < MQTT_LINK_POLICY_POOR_ENTER_RSSI || link_loss_percent >= MQTT_LINK_POLICY_POOR_ENTER_LOSS)
+  { return mqtt_link_poor; }
+  if(link_quality == mqtt_link_fair
+     && rssi >= MQTT_LINK_POLICY_GOOD_ENTER_RSSI && link_loss_percent < MQTT_LINK_POLICY_GOOD_ENTER_LOSS)
+  { return mqtt_link_good; }
+  return mqtt_link_fair;
+}
@@ -0,0 +1,65 @@
+/*
+ * mqtt_link_policy.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_MQTT_LINK_POLICY_H_
+#define AMPAK_WL72917_MQTT_LINK_POLICY_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+/** RSSI is read at most this often, in ms **/
+#define MQTT_LINK_POLICY_SAMPLE_MS 5000U
+/** QoS 1/2 publish outcomes needed before the failure ratio is trusted **/
+#define MQTT_LINK_POLICY_MIN_OUTCOMES 4U
+
+/** thresholds, dBm and percent of failed publishes; leaving a state needs a better link than entering it **/
+#define MQTT_LINK_POLICY_POOR_ENTER_RSSI -78
+#define MQTT_LINK_POLICY_POOR_LEAVE_RSSI -72
+#define MQTT_LINK_POLICY_GOOD_ENTER_RSSI -62
+#define MQTT_LINK_POLICY_GOOD_LEAVE_RSSI -68
+#define MQTT_LINK_POLICY_POOR_ENTER_LOSS 20U
+#define MQTT_LINK_POLICY_POOR_LEAVE_LOSS 10U
+#define MQTT_LINK_POLICY_GOOD_ENTER_LOSS 5U
+#define MQTT_LINK_POLICY_GOOD_LEAVE_LOSS 10U
+
+typedef enum {
+  mqtt_link_good = 0,
+  mqtt_link_fair,
+  mqtt_link_poor,
+} mqttLinkQuality_t;
+
+typedef struct {
+  uint8_t max_qos;            /* cap for non-critical publishes */
+  uint8_t batch_size;         /* flush once this many are queued ... */
+  uint32_t flush_interval_ms; /* ... or the oldest waited this long */
+} mqtt_link_profile_t;
+
+typedef struct {
+  mqttLinkQuality_t quality;
+  int32_t rssi;               /* smoothed, dBm */
+  uint32_t loss_percent;      /* smoothed failed QoS 1/2 publish ratio */
+  uint32_t transitions;
+} mqtt_link_status_t;
+
+/**
+ * Publish behaviour adapted to the Wi-Fi link.
+ *
+ * Only the publish I/O thread may call mqtt_link_policy_sample(),
+ * mqtt_link_policy_qos() and mqtt_link_policy_flush_due(); the result
+ * callbacks may come from the MQTT event handler. Only QoS 1/2 outcomes are
+ * reported, a QoS 0 publish completes without the broker and would dilute
+ * the ratio. The 3.1.4 host API does not expose Wi-Fi retry counts, so this
+ * ratio stands in for the link loss signal.
+ */
+void mqtt_link_policy_init(void);
+void mqtt_link_policy_sample(void);
+void mqtt_link_policy_on_publish_result(bool acked);
+uint8_t mqtt_link_policy_qos(uint8_t requested_qos, bool is_critical);
+bool mqtt_link_policy_flush_due(uint32_t depth, uint32_t oldest_tick, uint32_t *wait_ticks);
+void mqtt_link_policy_get_status(mqtt_link_status_t *status);
+
+#endif /* AMPAK_WL72917_MQTT_LINK_POLICY_H_ */
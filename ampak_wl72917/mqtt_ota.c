@@ -0,0 +1,522 @@
+/*
+ * mqtt_ota.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#include "ampak_wl72917/mqtt_ota.h"
+#include "ampak_wl72917/mqtt_publish_queue.h"
+#include "ampak_wl72917/ampak_fmt.h"
+#include "ampak_wl72917/ampak_util.h"
+#include "firmware_upgradation.h"
+#include "cmsis_os2.h"
+#include "stdio.h"
+#include "string.h"
+
+#if MQTT_OTA_WINDOW_CHUNKS > 32U
+#error "the ack bitmap holds 32 chunks"
+#endif
+#if (MQTT_OTA_SECTOR_SIZE % MQTT_OTA_CHUNK_SIZE) != 0
+#error "MQTT_OTA_SECTOR_SIZE must be a multiple of MQTT_OTA_CHUNK_SIZE"
+#endif
+
+#define MQTT_OTA_FLAG_BEGIN  0x0001U
+#define MQTT_OTA_FLAG_SECTOR 0x0002U
+#define MQTT_OTA_FLAG_ACK    0x0004U
+#define MQTT_OTA_FLAGS       (MQTT_OTA_FLAG_BEGIN | MQTT_OTA_FLAG_SECTOR | MQTT_OTA_FLAG_ACK)
+
+#define MQTT_OTA_FNV_OFFSET 0xCBF29CE484222325ULL
+#define MQTT_OTA_FNV_PRIME  0x00000100000001B3ULL
+
+/** sl_si91x_fwup_start() takes the RPS header alone, sl_si91x_fwup_load() at most this much **/
+#define MQTT_OTA_FWUP_HEADER_SIZE 64U
+#define MQTT_OTA_FWUP_PIECE_SIZE  1024U
+
+typedef enum {
+  mqtt_ota_buffer_filling = 0,
+  mqtt_ota_buffer_full,
+  mqtt_ota_buffer_writing,
+} mqttOtaBufferState_t;
+
+typedef struct {
+  uint32_t sector;            /* image sector this buffer collects */
+  uint32_t received;          /* chunk bitmap within the sector */
+  uint8_t state;              /* mqttOtaBufferState_t */
+  uint8_t data[MQTT_OTA_SECTOR_SIZE];
+} mqtt_ota_buffer_t;
+
+static mqtt_ota_buffer_t ota_buffers[MQTT_OTA_BUFFERS];
+static const mqtt_ota_flash_t *ota_flash = NULL;
+static const char *ota_status_topic      = NULL;
+static uint8_t ota_qos_level;
+static osMutexId_t ota_lock       = NULL;
+static osThreadId_t ota_writer_id = NULL;
+
+static mqtt_ota_status_t ota_status;
+static uint64_t ota_expected_hash;
+static uint64_t ota_hash;           /* over the committed bytes */
+static uint32_t ota_base;           /* first sector not in flash */
+static uint32_t ota_generation;     /* bumped per begin / abort, stale writes are dropped */
+static uint32_t ota_progress_tick;
+static sl_status_t ota_fail_status;
+
+static bool fwup_done;
+
+static const osThreadAttr_t ota_writer_attributes = {
+  .name       = "ota_writer",
+  .attr_bits  = 0,
+  .cb_mem     = 0,
+  .cb_size    = 0,
+  .stack_mem  = 0,
+  .stack_size = MQTT_OTA_WRITER_STACK,
+  .priority   = osPriorityBelowNormal,
+  .tz_module  = 0,
+  .reserved   = 0,
+};
+
+/**
+ *  Local functions
+ */
+
+static void mqtt_ota_writer(void *argument);
+static bool mqtt_ota_commit_next(void);
+static void mqtt_ota_begin(uint32_t image_id, uint32_t image_size, uint64_t hash);
+static void mqtt_ota_chunk(uint32_t image_id, uint32_t index, const uint8_t *data, uint32_t length);
+static void mqtt_ota_fail(uint32_t generation, sl_status_t status);
+static void mqtt_ota_send_ack(void);
+static uint32_t mqtt_ota_sector_mask(uint32_t sector);
+static uint32_t mqtt_ota_get_u32(const uint8_t *data);
+static uint64_t mqtt_ota_hash(uint64_t hash, const uint8_t *data, uint32_t length);
+static sl_status_t mqtt_ota_fwup_begin(uint32_t image_size);
+static sl_status_t mqtt_ota_fwup_erase(uint32_t offset, uint32_t length);
+static sl_status_t mqtt_ota_fwup_write(uint32_t offset, const uint8_t *data, uint32_t length);
+static sl_status_t mqtt_ota_fwup_finish(void);
+
+const mqtt_ota_flash_t mqtt_ota_fwup_flash = {
+  .begin  = mqtt_ota_fwup_begin,
+  .erase  = mqtt_ota_fwup_erase,
+  .write  = mqtt_ota_fwup_write,
+  .finish = mqtt_ota_fwup_finish,
+};
+
+/**
+ * Function implementation
+ */
+
+sl_status_t mqtt_ota_init(const mqtt_ota_flash_t *flash, const char *status_topic, uint8_t qos_level)
+{
+  if(flash == NULL || status_topic == NULL)
+  { return SL_STATUS_NULL_POINTER; }
+  if(ota_lock != NULL)
+  { return SL_STATUS_ALREADY_INITIALIZED; }
+
+  ota_lock = osMutexNew(NULL);
+  if(ota_lock == NULL)
+  { return SL_STATUS_ALLOCATION_FAILED; }
+
+  ota_flash        = flash;
+  ota_status_topic = status_topic;
+  ota_qos_level    = qos_level;
+  ota_writer_id    = osThreadNew(mqtt_ota_writer, NULL, &ota_writer_attributes);
+  if(ota_writer_id == NULL)
+  {
+    printf("Failed to new ota writer\r\n");
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  return SL_STATUS_OK;
+}
+
+void mqtt_ota_on_message(const uint8_t *payload, uint32_t payload_length)
+{
+  if(ota_writer_id == NULL || payload_length < 8U)
+  { return; }
+
+  uint32_t image_id = mqtt_ota_get_u32(&payload[4]);
+
+  switch(payload[0])
+  {
+    case MQTT_OTA_FRAME_BEGIN:
+      if(payload_length == MQTT_OTA_HEADER_SIZE + 8U)
+      {
+        uint64_t hash = (uint64_t)mqtt_ota_get_u32(&payload[12]) | ((uint64_t)mqtt_ota_get_u32(&payload[16]) << 32);
+        mqtt_ota_begin(image_id, mqtt_ota_get_u32(&payload[8]), hash);
+      }
+      break;
+
+    case MQTT_OTA_FRAME_CHUNK: {
+      uint32_t length = (uint32_t)payload[2] | ((uint32_t)payload[3] << 8);
+      if(payload_length >= MQTT_OTA_HEADER_SIZE && payload_length - MQTT_OTA_HEADER_SIZE == length)
+      { mqtt_ota_chunk(image_id, mqtt_ota_get_u32(&payload[8]), &payload[MQTT_OTA_HEADER_SIZE], length); }
+      break;
+    }
+
+    case MQTT_OTA_FRAME_ABORT:
+      osMutexAcquire(ota_lock, osWaitForever);
+      if(image_id == ota_status.image_id && ota_status.state == mqtt_ota_state_receiving)
+      {
+        ota_status.state = mqtt_ota_state_idle;
+        ota_generation++;
+        printf("OTA %08lx aborted\r\n", image_id);
+      }
+      osMutexRelease(ota_lock);
+      break;
+
+    default:
+      break;
+  }
+}
+
+void mqtt_ota_on_connected(void)
+{
+  /* tell the backend where to pick up */
+  if(ota_writer_id != NULL && ota_status.state != mqtt_ota_state_idle)
+  { osThreadFlagsSet(ota_writer_id, MQTT_OTA_FLAG_ACK); }
+}
+
+void mqtt_ota_get_status(mqtt_ota_status_t *status)
+{
+  if(ota_lock == NULL)
+  {
+    memset(status, 0, sizeof(*status));
+    return;
+  }
+  osMutexAcquire(ota_lock, osWaitForever);
+  *status = ota_status;
+  osMutexRelease(ota_lock);
+}
+
+static void mqtt_ota_begin(uint32_t image_id, uint32_t image_size, uint64_t hash)
+{
+  uint32_t flags = MQTT_OTA_FLAG_ACK;
+
+  if(image_size == 0)
+  { return; }
+
+  osMutexAcquire(ota_lock, osWaitForever);
+  if(image_id == ota_status.image_id
+     && (ota_status.state == mqtt_ota_state_receiving || ota_status.state == mqtt_ota_state_done) && ota_expected_hash == hash
+     && image_size == ota_status.image_size)
+  {
+    /* same image, carry on where it stopped */
+    ota_status.resumes++;
+  }
+  else
+  {
+    ota_status.image_id   = image_id;
+    ota_status.image_size = image_size;
+    ota_status.committed  = 0;
+    ota_status.state      = mqtt_ota_state_receiving;
+    ota_expected_hash     = hash;
+    ota_hash              = MQTT_OTA_FNV_OFFSET;
+    ota_base              = 0;
+    ota_generation++;
+    for(uint32_t i = 0; i < MQTT_OTA_BUFFERS; i++)
+    {
+      ota_buffers[i].sector   = i;
+      ota_buffers[i].received = 0;
+      ota_buffers[i].state    = mqtt_ota_buffer_filling;
+    }
+    flags |= MQTT_OTA_FLAG_BEGIN;
+    printf("OTA %08lx: %lu bytes\r\n", image_id, image_size);
+  }
+  ota_progress_tick = osKernelGetTickCount();
+  osMutexRelease(ota_lock);
+
+  osThreadFlagsSet(ota_writer_id, flags);
+}
+
+static void mqtt_ota_chunk(uint32_t image_id, uint32_t index, const uint8_t *data, uint32_t length)
+{
+  bool sector_full = false;
+
+  osMutexAcquire(ota_lock, osWaitForever);
+  uint32_t chunks = (ota_status.image_size + MQTT_OTA_CHUNK_SIZE - 1U) / MQTT_OTA_CHUNK_SIZE;
+  uint32_t offset = index * MQTT_OTA_CHUNK_SIZE;
+
+  if(ota_status.state != mqtt_ota_state_receiving || image_id != ota_status.image_id || index >= chunks
+     || length != ((ota_status.image_size - offset < MQTT_OTA_CHUNK_SIZE) ? ota_status.image_size - offset
+                                                                          : MQTT_OTA_CHUNK_SIZE))
+  {
+    osMutexRelease(ota_lock);
+    return;
+  }
+
+  uint32_t sector            = index / MQTT_OTA_SECTOR_CHUNKS;
+  uint32_t bit               = 1UL << (index % MQTT_OTA_SECTOR_CHUNKS);
+  mqtt_ota_buffer_t *buffer  = &ota_buffers[sector % MQTT_OTA_BUFFERS];
+
+  if(sector < ota_base || (buffer->sector == sector && (buffer->received & bit) != 0))
+  { ota_status.duplicates++; }
+  else if(buffer->sector != sector || buffer->state != mqtt_ota_buffer_filling)
+  { ota_status.out_of_window++; }   /* ahead of the window, or its buffer is still being written */
+  else
+  {
+    memcpy(&buffer->data[(index % MQTT_OTA_SECTOR_CHUNKS) * MQTT_OTA_CHUNK_SIZE], data, length);
+    buffer->received |= bit;
+    ota_status.chunks++;
+    ota_progress_tick = osKernelGetTickCount();
+    if(buffer->received == mqtt_ota_sector_mask(sector))
+    {
+      buffer->state = mqtt_ota_buffer_full;
+      sector_full   = true;
+    }
+  }
+  osMutexRelease(ota_lock);
+
+  if(sector_full)
+  { osThreadFlagsSet(ota_writer_id, MQTT_OTA_FLAG_SECTOR); }
+}
+
+/* flash calls block on the NWP, so they run here and not in the client callback */
+static void mqtt_ota_writer(void *argument)
+{
+  UNUSED_PARAMETER(argument);
+
+  while(1)
+  {
+    uint32_t flags = osThreadFlagsWait(MQTT_OTA_FLAGS, osFlagsWaitAny, MQTT_OTA_NACK_MS);
+
+    if((flags & osFlagsError) != 0)
+    {
+      /* quiet for a while, repeat the window so lost chunks get resent */
+      osMutexAcquire(ota_lock, osWaitForever);
+      bool stalled = (ota_status.state == mqtt_ota_state_receiving
+                      && (osKernelGetTickCount() - ota_progress_tick) >= MQTT_OTA_NACK_MS);
+      osMutexRelease(ota_lock);
+      if(stalled)
+      { mqtt_ota_send_ack(); }
+      continue;
+    }
+
+    if((flags & MQTT_OTA_FLAG_BEGIN) != 0)
+    {
+      osMutexAcquire(ota_lock, osWaitForever);
+      uint32_t generation = ota_generation;
+      uint32_t image_size = ota_status.image_size;
+      osMutexRelease(ota_lock);
+
+      sl_status_t status = ota_flash->begin(image_size);
+      if(status != SL_STATUS_OK)
+      {
+        mqtt_ota_fail(generation, status);
+        continue;
+      }
+    }
+
+    if((flags & (MQTT_OTA_FLAG_BEGIN | MQTT_OTA_FLAG_SECTOR)) != 0)
+    {
+      while(mqtt_ota_commit_next())
+      { }
+    }
+
+    if((flags & MQTT_OTA_FLAG_ACK) != 0)
+    { mqtt_ota_send_ack(); }
+  }
+}
+
+/* write the sector at the window base if it is complete, false when there is nothing to do */
+static bool mqtt_ota_commit_next(void)
+{
+  osMutexAcquire(ota_lock, osWaitForever);
+  mqtt_ota_buffer_t *buffer = &ota_buffers[ota_base % MQTT_OTA_BUFFERS];
+  if(ota_status.state != mqtt_ota_state_receiving || buffer->sector != ota_base
+     || buffer->state != mqtt_ota_buffer_full)
+  {
+    osMutexRelease(ota_lock);
+    return false;
+  }
+  uint32_t generation = ota_generation;
+  uint32_t offset     = ota_base * MQTT_OTA_SECTOR_SIZE;
+  uint32_t length     = ota_status.image_size - offset;
+  if(length > MQTT_OTA_SECTOR_SIZE)
+  { length = MQTT_OTA_SECTOR_SIZE; }
+  bool last     = (offset + length == ota_status.image_size);
+  uint64_t hash = ota_hash;
+  buffer->state = mqtt_ota_buffer_writing;
+  osMutexRelease(ota_lock);
+
+  hash = mqtt_ota_hash(hash, buffer->data, length);
+  if(last && hash != ota_expected_hash)
+  {
+    /* the image is never completed, so it can not be activated */
+    mqtt_ota_fail(generation, SL_STATUS_INVALID_SIGNATURE);
+    return false;
+  }
+
+  uint32_t start_tick = osKernelGetTickCount();
+  sl_status_t status  = ota_flash->erase(offset, MQTT_OTA_SECTOR_SIZE);
+  if(status == SL_STATUS_OK)
+  { status = ota_flash->write(offset, buffer->data, length); }
+  if(status == SL_STATUS_OK && last)
+  { status = ota_flash->finish(); }
+  uint32_t elapsed = osKernelGetTickCount() - start_tick;
+
+  if(status != SL_STATUS_OK)
+  {
+    mqtt_ota_fail(generation, status);
+    return false;
+  }
+
+  osMutexAcquire(ota_lock, osWaitForever);
+  ota_status.flash_ms += (uint32_t)(((uint64_t)elapsed * 1000U) / osKernelGetTickFreq());
+  if(generation != ota_generation)
+  {
+    /* a new begin or an abort came in meanwhile, the buffers belong to it now */
+    osMutexRelease(ota_lock);
+    return false;
+  }
+  ota_hash              = hash;
+  ota_status.committed += length;
+  ota_base++;
+  buffer->sector   += MQTT_OTA_BUFFERS;
+  buffer->received  = 0;
+  buffer->state     = mqtt_ota_buffer_filling;
+  if(last)
+  { ota_status.state = mqtt_ota_state_done; }
+  ota_progress_tick = osKernelGetTickCount();
+  osMutexRelease(ota_lock);
+
+  if(last)
+  { printf("OTA %08lx written and verified, reset to apply\r\n", ota_status.image_id); }
+  mqtt_ota_send_ack();
+  return !last;
+}
+
+static void mqtt_ota_fail(uint32_t generation, sl_status_t status)
+{
+  osMutexAcquire(ota_lock, osWaitForever);
+  if(generation == ota_generation && ota_status.state == mqtt_ota_state_receiving)
+  {
+    ota_status.state = mqtt_ota_state_failed;
+    ota_fail_status  = status;
+    printf("OTA %08lx failed: 0x%lx\r\n", ota_status.image_id, status);
+  }
+  osMutexRelease(ota_lock);
+  mqtt_ota_send_ack();
+}
+
+static void mqtt_ota_send_ack(void)
+{
+  char text[64];
+  ampak_fmt_t fmt;
+  uint32_t bitmap = 0;
+
+  ampak_fmt_init(&fmt, text, sizeof(text));
+  osMutexAcquire(ota_lock, osWaitForever);
+  switch(ota_status.state)
+  {
+    case mqtt_ota_state_receiving:
+      for(uint32_t i = 0; i < MQTT_OTA_BUFFERS; i++)
+      {
+        const mqtt_ota_buffer_t *buffer = &ota_buffers[(ota_base + i) % MQTT_OTA_BUFFERS];
+        uint32_t mask                   = mqtt_ota_sector_mask(ota_base + i);
+        uint32_t held = (buffer->sector != ota_base + i) ? 0
+                        : (buffer->state == mqtt_ota_buffer_filling) ? buffer->received : mask;
+        /* chunks past the image end are not wanted either */
+        held |= ~mask & ((MQTT_OTA_SECTOR_CHUNKS < 32U) ? ((1UL << MQTT_OTA_SECTOR_CHUNKS) - 1U) : 0xFFFFFFFFUL);
+        bitmap |= held << (i * MQTT_OTA_SECTOR_CHUNKS);
+      }
+      ampak_fmt_hex(ampak_fmt_lit(&fmt, "ack "), ota_status.image_id, 8);
+      ampak_fmt_u32(ampak_fmt_char(&fmt, ' '), ota_base * MQTT_OTA_SECTOR_CHUNKS);
+      ampak_fmt_hex(ampak_fmt_char(&fmt, ' '), bitmap, 8);
+      break;
+    case mqtt_ota_state_done:
+      ampak_fmt_hex(ampak_fmt_lit(&fmt, "done "), ota_status.image_id, 8);
+      break;
+    case mqtt_ota_state_failed:
+      ampak_fmt_hex(ampak_fmt_lit(&fmt, "fail "), ota_status.image_id, 8);
+      ampak_fmt_hex(ampak_fmt_lit(&fmt, " 0x"), ota_fail_status, 8);
+      break;
+    default:
+      osMutexRelease(ota_lock);
+      return;
+  }
+  ota_status.acks++;
+  ota_progress_tick = osKernelGetTickCount();
+  osMutexRelease(ota_lock);
+
+  /* an ack not sent before the next one is stale, keep them short lived */
+  if(mqtt_publish_queue_push(ota_status_topic,
+                             (const uint8_t *)text,
+                             (uint16_t)ampak_fmt_length(&fmt),
+                             ota_qos_level,
+                             0,
+                             0,
+                             MQTT_OTA_NACK_MS) != SL_STATUS_OK)
+  { printf("Failed to queue ota ack\r\n"); }
+}
+
+/* chunks the sector holds, all bits set except for the last, shorter sector */
+static uint32_t mqtt_ota_sector_mask(uint32_t sector)
+{
+  uint32_t chunks = (ota_status.image_size + MQTT_OTA_CHUNK_SIZE - 1U) / MQTT_OTA_CHUNK_SIZE;
+  uint32_t first  = sector * MQTT_OTA_SECTOR_CHUNKS;
+  uint32_t count  = (chunks > first) ? chunks - first : 0;
+
+  if(count >= MQTT_OTA_SECTOR_CHUNKS)
+  { count = MQTT_OTA_SECTOR_CHUNKS; }
+  return (count >= 32U) ? 0xFFFFFFFFUL : (1UL << count) - 1U;
+}
+
+static uint32_t mqtt_ota_get_u32(const uint8_t *data)
+{
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static uint64_t mqtt_ota_hash(uint64_t hash, const uint8_t *data, uint32_t length)
+{
+  for(uint32_t i = 0; i < length; i++)
+  {
+    hash ^= data[i];
+    hash *= MQTT_OTA_FNV_PRIME;
+  }
+  return hash;
+}
+
+static sl_status_t mqtt_ota_fwup_begin(uint32_t image_size)
+{
+  fwup_done = false;
+  return (image_size > MQTT_OTA_FWUP_HEADER_SIZE) ? SL_STATUS_OK : SL_STATUS_INVALID_PARAMETER;
+}
+
+static sl_status_t mqtt_ota_fwup_erase(uint32_t offset, uint32_t length)
+{
+  /* the NWP erases its update slot itself */
+  UNUSED_PARAMETER(offset);
+  UNUSED_PARAMETER(length);
+  return SL_STATUS_OK;
+}
+
+static sl_status_t mqtt_ota_fwup_write(uint32_t offset, const uint8_t *data, uint32_t length)
+{
+  sl_status_t status;
+  uint32_t position = 0;
+
+  if(offset == 0)
+  {
+    status = sl_si91x_fwup_start((uint8_t *)data);
+    if(status != SL_STATUS_OK)
+    { return status; }
+    position = MQTT_OTA_FWUP_HEADER_SIZE;
+  }
+
+  while(position < length)
+  {
+    uint32_t piece = length - position;
+    if(piece > MQTT_OTA_FWUP_PIECE_SIZE)
+    { piece = MQTT_OTA_FWUP_PIECE_SIZE; }
+    status = sl_si91x_fwup_load((uint8_t *)&data[position], (uint16_t)piece);
+    if(status == SL_STATUS_SI91X_FW_UPDATE_DONE)
+    { fwup_done = true; }
+    else if(status != SL_STATUS_OK)
+    { return status; }
+    position += piece;
+  }
+  return SL_STATUS_OK;
+}
+
+static sl_status_t mqtt_ota_fwup_finish(void)
+{
+  return fwup_done ? SL_STATUS_OK : SL_STATUS_FAIL;
+}
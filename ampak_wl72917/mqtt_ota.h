@@ -0,0 +1,95 @@
+/*
+ * mqtt_ota.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_MQTT_OTA_H_
+#define AMPAK_WL72917_MQTT_OTA_H_
+
+#include "sl_status.h"
+#include "stdint.h"
+#include "stdbool.h"
+
+/** image bytes per chunk message, small enough for one firmware receive chunk **/
+#define MQTT_OTA_CHUNK_SIZE   512U
+/** flash erase / write unit, one receive buffer each **/
+#define MQTT_OTA_SECTOR_SIZE  4096U
+#define MQTT_OTA_SECTOR_CHUNKS (MQTT_OTA_SECTOR_SIZE / MQTT_OTA_CHUNK_SIZE)
+/** two buffers: one written to flash while the next one fills, their chunks make the ack window **/
+#define MQTT_OTA_BUFFERS       2U
+#define MQTT_OTA_WINDOW_CHUNKS (MQTT_OTA_BUFFERS * MQTT_OTA_SECTOR_CHUNKS)
+#define MQTT_OTA_WRITER_STACK  1536U
+/** without a chunk for this long the current window is acked again, asking for what is missing **/
+#define MQTT_OTA_NACK_MS       3000U
+
+/**
+ * Frames on the chunk topic, little endian:
+ *   begin  'B' 0 0 0 | image id u32 | image size u32 | FNV-1a 64 of the image u64
+ *   chunk  'C' 0 | length u16 | image id u32 | chunk index u32 | data
+ *   abort  'A' 0 0 0 | image id u32
+ */
+#define MQTT_OTA_FRAME_BEGIN  'B'
+#define MQTT_OTA_FRAME_CHUNK  'C'
+#define MQTT_OTA_FRAME_ABORT  'A'
+#define MQTT_OTA_HEADER_SIZE  12U
+
+typedef enum {
+  mqtt_ota_state_idle = 0,
+  mqtt_ota_state_receiving,
+  mqtt_ota_state_done,          /* written and verified, reset to run it */
+  mqtt_ota_state_failed,
+} mqttOtaState_t;
+
+/**
+ * Flash behind the receiver. Writes come in image order, one sector at a
+ * time and never for a sector that was not erased first; a host test can
+ * back this with a file.
+ */
+typedef struct {
+  sl_status_t (*begin)(uint32_t image_size);
+  sl_status_t (*erase)(uint32_t offset, uint32_t length);
+  sl_status_t (*write)(uint32_t offset, const uint8_t *data, uint32_t length);
+  sl_status_t (*finish)(void);  /* whole image written and its hash matched */
+} mqtt_ota_flash_t;
+
+typedef struct {
+  uint32_t image_id;
+  uint32_t image_size;
+  uint32_t committed;       /* bytes in flash */
+  uint8_t state;            /* mqttOtaState_t */
+  uint32_t chunks;          /* accepted */
+  uint32_t duplicates;      /* already held or written */
+  uint32_t out_of_window;   /* dropped, ahead of both buffers */
+  uint32_t acks;
+  uint32_t resumes;         /* begin for the image already in progress */
+  uint32_t flash_ms;        /* time spent in erase and write */
+} mqtt_ota_status_t;
+
+/**
+ * OTA image download over MQTT.
+ *
+ * The backend sends begin, then chunks. mqtt_ota_on_message() runs in the
+ * client callback and only copies a chunk into the buffer of its sector;
+ * a writer thread erases and writes complete sectors in order while the
+ * network keeps filling the other buffer, and folds each one into a rolling
+ * FNV-1a 64 hash. The last sector is only written once the hash of the whole
+ * image matches the one from begin, so a corrupt image never completes.
+ *
+ * Every written sector, and every MQTT_OTA_NACK_MS without progress, is
+ * answered on status_topic with "ack <id> <base chunk> <window bitmap hex>";
+ * the backend resends the clear bits and moves on past the window base.
+ * State is kept over disconnects: a begin for the same image, or
+ * mqtt_ota_on_connected(), resumes at the first chunk not written.
+ * Completion is "done <id>", a failure "fail <id> 0x<status>".
+ */
+sl_status_t mqtt_ota_init(const mqtt_ota_flash_t *flash, const char *status_topic, uint8_t qos_level);
+void mqtt_ota_on_message(const uint8_t *payload, uint32_t payload_length);
+void mqtt_ota_on_connected(void);
+void mqtt_ota_get_status(mqtt_ota_status_t *status);
+
+/** NWP firmware update, image streamed through sl_si91x_fwup_start() / sl_si91x_fwup_load() **/
+extern const mqtt_ota_flash_t mqtt_ota_fwup_flash;
+
+#endif /* AMPAK_WL72917_MQTT_OTA_H_ */
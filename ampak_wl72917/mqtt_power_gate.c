@@ -0,0 +1,145 @@
+/*
+ * mqtt_power_gate.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+/**
+ * The M4 cannot see the beacon schedule, so windows are estimated: the radio
+ * was awake at the last traffic seen (a received message, an ack), and in
+ * power save it wakes again every DTIM period after that. The estimate drifts
+ * with the AP clock and the TIM, which only costs a wasted wake now and then;
+ * the hold limit bounds the delay when no traffic was seen at all.
+ */
+
+#include "ampak_wl72917/mqtt_power_gate.h"
+#include "ampak_wl72917/ampak_util.h"
+#include "cmsis_os2.h"
+#include "string.h"
+
+typedef enum {
+  mqtt_power_gate_open = 0,     /* not in power save, not counted */
+  mqtt_power_gate_bypass,
+  mqtt_power_gate_piggyback,
+  mqtt_power_gate_window,
+} mqttPowerGateReason_t;
+
+static volatile uint32_t gate_activity_tick;
+static volatile bool gate_activity_seen;
+static mqttPowerGateReason_t gate_reason;
+static mqtt_power_gate_stats_t gate_stats;
+
+/**
+ *  Local functions
+ */
+
+static uint32_t mqtt_power_gate_ms_to_ticks(uint32_t ms);
+
+/**
+ * Function implementation
+ */
+
+void mqtt_power_gate_init(void)
+{
+  gate_activity_seen = false;
+  gate_reason        = mqtt_power_gate_open;
+  memset(&gate_stats, 0, sizeof(gate_stats));
+}
+
+void mqtt_power_gate_on_radio_activity(void)
+{
+  gate_activity_tick = osKernelGetTickCount();
+  gate_activity_seen = true;
+}
+
+bool mqtt_power_gate_flush_due(uint32_t depth,
+                               uint32_t oldest_tick,
+                               bool has_critical,
+                               const uint32_t *deadline_tick,
+                               uint32_t *wait_ticks)
+{
+  uint32_t now = osKernelGetTickCount();
+
+  *wait_ticks = osWaitForever;
+  gate_reason = mqtt_power_gate_open;
+  if(depth == 0)
+  { return false; }
+  if(!ampak_power_save_is_active())
+  { return true; }
+
+  if(has_critical)
+  {
+    gate_reason = mqtt_power_gate_bypass;
+    return true;
+  }
+
+  uint32_t window = oldest_tick + mqtt_power_gate_ms_to_ticks(MQTT_POWER_GATE_MAX_HOLD_MS);
+  if(gate_activity_seen)
+  {
+    uint32_t period  = mqtt_power_gate_ms_to_ticks(MQTT_POWER_GATE_BEACON_MS * MQTT_POWER_GATE_DTIM_BEACONS);
+    uint32_t elapsed = now - gate_activity_tick;
+
+    if(elapsed < mqtt_power_gate_ms_to_ticks(MQTT_POWER_GATE_AWAKE_MS))
+    {
+      gate_reason = mqtt_power_gate_piggyback;
+      return true;
+    }
+    /* first estimated DTIM wake at or after now */
+    uint32_t dtim = gate_activity_tick + ((elapsed + period - 1U) / period) * period;
+    if((int32_t)(dtim - window) < 0)
+    { window = dtim; }
+  }
+
+  int32_t remaining = (int32_t)(window - now);
+  if(deadline_tick != NULL && (int32_t)(*deadline_tick - now) <= remaining)
+  {
+    /* would expire while held */
+    gate_reason = mqtt_power_gate_bypass;
+    return true;
+  }
+  if(remaining <= 0)
+  {
+    gate_reason = mqtt_power_gate_window;
+    return true;
+  }
+
+  *wait_ticks = (uint32_t)remaining;
+  return false;
+}
+
+void mqtt_power_gate_on_flushed(uint32_t sent)
+{
+  if(gate_reason == mqtt_power_gate_open || sent == 0)
+  { return; }
+
+  /* without the gate each publish wakes the radio; a flush costs one wake, none when piggybacked */
+  uint32_t saved = sent - 1U;
+  switch(gate_reason)
+  {
+    case mqtt_power_gate_bypass:
+      gate_stats.bypassed++;
+      break;
+    case mqtt_power_gate_piggyback:
+      gate_stats.piggybacked++;
+      saved = sent;
+      break;
+    default:
+      gate_stats.windows++;
+      break;
+  }
+  gate_stats.held            += sent;
+  gate_stats.wakeups_saved   += saved;
+  gate_stats.energy_saved_uj += saved * MQTT_POWER_GATE_WAKE_COST_UJ;
+  gate_reason = mqtt_power_gate_open;
+}
+
+void mqtt_power_gate_get_stats(mqtt_power_gate_stats_t *stats)
+{
+  *stats = gate_stats;
+}
+
+static uint32_t mqtt_power_gate_ms_to_ticks(uint32_t ms)
+{
+  return (ms * osKernelGetTickFreq()) / 1000U;
+}
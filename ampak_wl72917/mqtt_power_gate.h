@@ -0,0 +1,58 @@
+/*
+ * mqtt_power_gate.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_MQTT_POWER_GATE_H_
+#define AMPAK_WL72917_MQTT_POWER_GATE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+/** AP beacon interval, 100 TU **/
+#define MQTT_POWER_GATE_BEACON_MS 102U
+/** beacons between the wakes the NWP keeps in power save, the "DTIM 10" set up at boot **/
+#define MQTT_POWER_GATE_DTIM_BEACONS 10U
+/** the radio stays up this long after traffic, sends in that time ride along for free **/
+#define MQTT_POWER_GATE_AWAKE_MS 50U
+/** never hold a publish longer than this, even if no window was seen **/
+#define MQTT_POWER_GATE_MAX_HOLD_MS 5000U
+/** energy model: cost of one extra radio wake (rf up, tx, ack, back to sleep), uJ **/
+#define MQTT_POWER_GATE_WAKE_COST_UJ 3000U
+
+typedef struct {
+  uint32_t held;              /* publishes sent through the gate in power save */
+  uint32_t bypassed;          /* flushes forced by a critical or deadline bound publish */
+  uint32_t piggybacked;       /* flushes done while the radio was awake for other traffic */
+  uint32_t windows;           /* flushes at a DTIM window or the hold limit */
+  uint32_t wakeups_saved;     /* publishes that did not need a wake of their own */
+  uint32_t energy_saved_uj;   /* wakeups_saved * MQTT_POWER_GATE_WAKE_COST_UJ */
+} mqtt_power_gate_stats_t;
+
+/**
+ * Publish gate for associated power save.
+ *
+ * While the NWP sleeps between DTIM beacons, every lone publish wakes the
+ * radio on its own. The gate holds non-urgent publishes until the next window
+ * the radio is awake anyway: the next DTIM estimated from the last seen radio
+ * activity, or right away when traffic was just seen. A critical publish, or
+ * one that would expire before the window, opens the gate for everything
+ * queued. The flush is one burst, so N publishes cost one wake instead of N.
+ *
+ * Off power save the gate is always open. Only the publish I/O thread may
+ * call mqtt_power_gate_flush_due() and mqtt_power_gate_on_flushed();
+ * mqtt_power_gate_on_radio_activity() may come from the MQTT event handler.
+ */
+void mqtt_power_gate_init(void);
+void mqtt_power_gate_on_radio_activity(void);
+bool mqtt_power_gate_flush_due(uint32_t depth,
+                               uint32_t oldest_tick,
+                               bool has_critical,
+                               const uint32_t *deadline_tick,
+                               uint32_t *wait_ticks);
+void mqtt_power_gate_on_flushed(uint32_t sent);
+void mqtt_power_gate_get_stats(mqtt_power_gate_stats_t *stats);
+
+#endif /* AMPAK_WL72917_MQTT_POWER_GATE_H_ */
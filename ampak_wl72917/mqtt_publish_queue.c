@@ -0,0 +1,302 @@
+/*
+ * mqtt_publish_queue.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+/**
+ * Bounded MPSC ring, per-slot sequence numbers (D. Vyukov).
+ *
+ * A producer claims a position with one CAS on enqueue_pos, fills the slot and
+ * publishes it by storing sequence = pos + 1. The consumer owns dequeue_pos and
+ * hands the slot back by storing sequence = pos + SLOTS. No locks, so an ISR
+ * preempting a producer never waits on it; LDREX/STREX keep the CAS ISR safe.
+ *
+ * Only the consumer frees slots. front() drops expired items at the head;
+ * purge_expired() also frees the ones behind a live head by sliding the
+ * live items over them towards the tail of the filled range, which keeps
+ * push order. Producers never write a filled slot, so this needs no lock.
+ * A push that finds the ring full kicks the consumer to purge.
+ */
+
+#include "ampak_wl72917/mqtt_publish_queue.h"
+#include "stdatomic.h"
+#include "string.h"
+
+#if (MQTT_PUBLISH_QUEUE_SLOTS & (MQTT_PUBLISH_QUEUE_SLOTS - 1U)) != 0
+#error "MQTT_PUBLISH_QUEUE_SLOTS must be a power of two"
+#endif
+
+#define MQTT_PUBLISH_QUEUE_MASK (MQTT_PUBLISH_QUEUE_SLOTS - 1U)
+
+typedef struct {
+  atomic_uint sequence;
+  mqtt_publish_item_t item;
+} mqtt_publish_slot_t;
+
+static mqtt_publish_slot_t publish_slots[MQTT_PUBLISH_QUEUE_SLOTS];
+static atomic_uint enqueue_pos;
+static uint32_t dequeue_pos;
+static osThreadId_t publish_consumer = NULL;
+
+static atomic_uint publish_queued;
+static atomic_uint publish_full_drops;
+static atomic_uint publish_oversize_drops;
+static uint32_t publish_expired;
+
+/**
+ *  Local functions
+ */
+
+static sl_status_t mqtt_publish_queue_enqueue(const mqtt_publish_item_t *item, const uint8_t *content);
+static bool mqtt_publish_queue_is_expired(const mqtt_publish_item_t *item, uint32_t now);
+static mqtt_publish_slot_t *mqtt_publish_queue_ready_slot(uint32_t pos);
+static void mqtt_publish_queue_move(mqtt_publish_item_t *to, const mqtt_publish_item_t *from);
+
+/**
+ * Function implementation
+ */
+
+void mqtt_publish_queue_init(osThreadId_t consumer)
+{
+  for(uint32_t i = 0; i < MQTT_PUBLISH_QUEUE_SLOTS; i++)
+  {
+    atomic_init(&publish_slots[i].sequence, i);
+  }
+  atomic_init(&enqueue_pos, 0U);
+  dequeue_pos = 0;
+  publish_consumer = consumer;
+}
+
+sl_status_t mqtt_publish_queue_push(const char *topic,
+                                    const uint8_t *content,
+                                    uint16_t content_length,
+                                    uint8_t qos_level,
+                                    uint8_t is_retained,
+                                    uint8_t is_critical,
+                                    uint32_t ttl_ms)
+{
+  if(content_length > MQTT_PUBLISH_PAYLOAD_SIZE)
+  {
+    atomic_fetch_add_explicit(&publish_oversize_drops, 1U, memory_order_relaxed);
+    return SL_STATUS_WOULD_OVERFLOW;
+  }
+
+  mqtt_publish_item_t header = {
+    .topic          = topic,
+    .topic_length   = (uint16_t)strlen(topic),
+    .qos_level      = qos_level,
+    .is_retained    = is_retained,
+    .is_critical    = is_critical,
+    .content_length = content_length,
+    .queued_tick    = osKernelGetTickCount(),
+    .expiry_tick    = 0,
+  };
+  if(ttl_ms != MQTT_PUBLISH_NO_EXPIRY)
+  {
+    uint32_t expiry = osKernelGetTickCount() + (uint32_t)(((uint64_t)ttl_ms * osKernelGetTickFreq()) / 1000U);
+    header.expiry_tick = (expiry == 0) ? 1U : expiry;
+  }
+
+  sl_status_t status = mqtt_publish_queue_enqueue(&header, content);
+  if(status == SL_STATUS_FULL && publish_consumer != NULL)
+  {
+    /* expired items may hold the slots, only the consumer can free them */
+    osThreadFlagsSet(publish_consumer, MQTT_PUBLISH_QUEUE_FLAG);
+  }
+  if(status != SL_STATUS_OK)
+  { return status; }
+
+  atomic_fetch_add_explicit(&publish_queued, 1U, memory_order_relaxed);
+  if(publish_consumer != NULL)
+  { osThreadFlagsSet(publish_consumer, MQTT_PUBLISH_QUEUE_FLAG); }
+
+  return SL_STATUS_OK;
+}
+
+static sl_status_t mqtt_publish_queue_enqueue(const mqtt_publish_item_t *item, const uint8_t *content)
+{
+  mqtt_publish_slot_t *slot;
+  unsigned int pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+
+  while(1)
+  {
+    slot = &publish_slots[pos & MQTT_PUBLISH_QUEUE_MASK];
+    unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    int diff = (int)(sequence - pos);
+
+    if(diff == 0)
+    {
+      if(atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos, pos + 1U,
+                                               memory_order_relaxed, memory_order_relaxed))
+      { break; }
+      /* pos was reloaded by the failed CAS */
+    }
+    else if(diff < 0)
+    {
+      /* consumer has not released this slot yet */
+      atomic_fetch_add_explicit(&publish_full_drops, 1U, memory_order_relaxed);
+      return SL_STATUS_FULL;
+    }
+    else
+    {
+      pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+    }
+  }
+
+  mqtt_publish_queue_move(&slot->item, item);
+  memcpy(slot->item.content, content, item->content_length);
+
+  atomic_store_explicit(&slot->sequence, pos + 1U, memory_order_release);
+  return SL_STATUS_OK;
+}
+
+mqtt_publish_item_t *mqtt_publish_queue_front(void)
+{
+  uint32_t now = osKernelGetTickCount();
+  mqtt_publish_slot_t *slot;
+
+  while((slot = mqtt_publish_queue_ready_slot(dequeue_pos)) != NULL)
+  {
+    if(!mqtt_publish_queue_is_expired(&slot->item, now))
+    { return &slot->item; }
+    publish_expired++;
+    mqtt_publish_queue_pop();
+  }
+  return NULL;
+}
+
+void mqtt_publish_queue_pop(void)
+{
+  mqtt_publish_slot_t *slot = &publish_slots[dequeue_pos & MQTT_PUBLISH_QUEUE_MASK];
+
+  atomic_store_explicit(&slot->sequence, dequeue_pos + MQTT_PUBLISH_QUEUE_SLOTS, memory_order_release);
+  dequeue_pos++;
+}
+
+uint32_t mqtt_publish_queue_purge_expired(void)
+{
+  uint32_t now = osKernelGetTickCount();
+  uint32_t expired = 0;
+  uint32_t filled = 0;
+
+  while(filled < MQTT_PUBLISH_QUEUE_SLOTS && mqtt_publish_queue_ready_slot(dequeue_pos + filled) != NULL)
+  { filled++; }
+
+  /* newest first, each live item slides up over the expired ones behind it */
+  uint32_t keep = dequeue_pos + filled;
+  for(uint32_t pos = dequeue_pos + filled; pos != dequeue_pos; pos--)
+  {
+    mqtt_publish_item_t *item = &publish_slots[(pos - 1U) & MQTT_PUBLISH_QUEUE_MASK].item;
+    if(mqtt_publish_queue_is_expired(item, now))
+    {
+      expired++;
+      continue;
+    }
+    keep--;
+    if(keep != pos - 1U)
+    {
+      mqtt_publish_item_t *to = &publish_slots[keep & MQTT_PUBLISH_QUEUE_MASK].item;
+      mqtt_publish_queue_move(to, item);
+      memcpy(to->content, item->content, item->content_length);
+    }
+  }
+
+  /* the expired ones are all at the head now */
+  while(dequeue_pos != keep)
+  { mqtt_publish_queue_pop(); }
+
+  publish_expired += expired;
+  return expired;
+}
+
+bool mqtt_publish_queue_earliest_expiry(uint32_t *expiry_tick)
+{
+  bool found = false;
+  uint32_t now = osKernelGetTickCount();
+  mqtt_publish_slot_t *slot;
+
+  for(uint32_t i = 0; i < MQTT_PUBLISH_QUEUE_SLOTS; i++)
+  {
+    if((slot = mqtt_publish_queue_ready_slot(dequeue_pos + i)) == NULL)
+    { break; }
+    if(slot->item.expiry_tick == 0)
+    { continue; }
+    if(!found || (int32_t)(slot->item.expiry_tick - now) < (int32_t)(*expiry_tick - now))
+    {
+      *expiry_tick = slot->item.expiry_tick;
+      found = true;
+    }
+  }
+  return found;
+}
+
+uint32_t mqtt_publish_queue_depth(uint32_t *oldest_tick)
+{
+  uint32_t depth = 0;
+  mqtt_publish_slot_t *slot;
+
+  while(depth < MQTT_PUBLISH_QUEUE_SLOTS && (slot = mqtt_publish_queue_ready_slot(dequeue_pos + depth)) != NULL)
+  {
+    /* items are never reordered, the head is the oldest */
+    if(depth == 0)
+    { *oldest_tick = slot->item.queued_tick; }
+    depth++;
+  }
+  return depth;
+}
+
+bool mqtt_publish_queue_has_critical(void)
+{
+  mqtt_publish_slot_t *slot;
+
+  for(uint32_t i = 0; i < MQTT_PUBLISH_QUEUE_SLOTS; i++)
+  {
+    if((slot = mqtt_publish_queue_ready_slot(dequeue_pos + i)) == NULL)
+    { break; }
+    if(slot->item.is_critical)
+    { return true; }
+  }
+  return false;
+}
+
+void mqtt_publish_queue_kick(void)
+{
+  if(publish_consumer != NULL)
+  { osThreadFlagsSet(publish_consumer, MQTT_PUBLISH_QUEUE_FLAG); }
+}
+
+void mqtt_publish_queue_get_stats(mqtt_publish_queue_stats_t *stats)
+{
+  stats->queued         = atomic_load_explicit(&publish_queued, memory_order_relaxed);
+  stats->full_drops     = atomic_load_explicit(&publish_full_drops, memory_order_relaxed);
+  stats->oversize_drops = atomic_load_explicit(&publish_oversize_drops, memory_order_relaxed);
+  stats->expired        = publish_expired;
+}
+
+static bool mqtt_publish_queue_is_expired(const mqtt_publish_item_t *item, uint32_t now)
+{
+  return (item->expiry_tick != 0) && ((int32_t)(now - item->expiry_tick) >= 0);
+}
+
+static mqtt_publish_slot_t *mqtt_publish_queue_ready_slot(uint32_t pos)
+{
+  mqtt_publish_slot_t *slot = &publish_slots[pos & MQTT_PUBLISH_QUEUE_MASK];
+  unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+
+  return (sequence == pos + 1U) ? slot : NULL;
+}
+
+/* everything but the content */
+static void mqtt_publish_queue_move(mqtt_publish_item_t *to, const mqtt_publish_item_t *from)
+{
+  to->topic          = from->topic;
+  to->topic_length   = from->topic_length;
+  to->qos_level      = from->qos_level;
+  to->is_retained    = from->is_retained;
+  to->is_critical    = from->is_critical;
+  to->content_length = from->content_length;
+  to->queued_tick    = from->queued_tick;
+  to->expiry_tick    = from->expiry_tick;
+}
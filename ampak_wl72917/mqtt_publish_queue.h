@@ -0,0 +1,73 @@
+/*
+ * mqtt_publish_queue.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_MQTT_PUBLISH_QUEUE_H_
+#define AMPAK_WL72917_MQTT_PUBLISH_QUEUE_H_
+
+#include "cmsis_os2.h"
+#include "sl_status.h"
+#include "stdint.h"
+#include "stdbool.h"
+
+/** must be a power of two **/
+#define MQTT_PUBLISH_QUEUE_SLOTS 16U
+#define MQTT_PUBLISH_PAYLOAD_SIZE 200U
+
+/** thread flag raised on the consumer when an item is queued **/
+#define MQTT_PUBLISH_QUEUE_FLAG 0x0001U
+
+/** ttl_ms value for items that never expire **/
+#define MQTT_PUBLISH_NO_EXPIRY 0U
+
+typedef struct {
+  const char *topic;        /* must outlive the item, normally a string literal */
+  uint16_t topic_length;
+  uint8_t qos_level;
+  uint8_t is_retained;
+  uint8_t is_critical;      /* never downgraded by the link policy */
+  uint16_t content_length;
+  uint32_t queued_tick;
+  uint32_t expiry_tick;     /* 0 when the item never expires */
+  uint8_t content[MQTT_PUBLISH_PAYLOAD_SIZE];
+} mqtt_publish_item_t;
+
+typedef struct {
+  uint32_t queued;
+  uint32_t full_drops;
+  uint32_t oversize_drops;
+  uint32_t expired;
+} mqtt_publish_queue_stats_t;
+
+/**
+ * Multi-producer single-consumer ring of outbound publishes.
+ *
+ * mqtt_publish_queue_push() never blocks and is safe from tasks and ISRs.
+ * Only the thread passed to mqtt_publish_queue_init() may call the other
+ * functions. Items older than their ttl_ms are never returned by
+ * mqtt_publish_queue_front(), which drops them at the head;
+ * mqtt_publish_queue_purge_expired() frees expired items anywhere in the
+ * ring. Live items keep their order. A push that finds the ring full raises
+ * MQTT_PUBLISH_QUEUE_FLAG so the consumer purges.
+ */
+void mqtt_publish_queue_init(osThreadId_t consumer);
+sl_status_t mqtt_publish_queue_push(const char *topic,
+                                    const uint8_t *content,
+                                    uint16_t content_length,
+                                    uint8_t qos_level,
+                                    uint8_t is_retained,
+                                    uint8_t is_critical,
+                                    uint32_t ttl_ms);
+mqtt_publish_item_t *mqtt_publish_queue_front(void);
+void mqtt_publish_queue_pop(void);
+uint32_t mqtt_publish_queue_purge_expired(void);
+bool mqtt_publish_queue_earliest_expiry(uint32_t *expiry_tick);
+uint32_t mqtt_publish_queue_depth(uint32_t *oldest_tick);
+bool mqtt_publish_queue_has_critical(void);
+void mqtt_publish_queue_kick(void);
+void mqtt_publish_queue_get_stats(mqtt_publish_queue_stats_t *stats);
+
+#endif /* AMPAK_WL72917_MQTT_PUBLISH_QUEUE_H_ */
@@ -0,0 +1,131 @@
+/*
+ * mqtt_retained_cache.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#include "ampak_wl72917/mqtt_retained_cache.h"
+#include "stdatomic.h"
+#include "string.h"
+
+typedef struct {
+  atomic_uint sequence;  /* odd while a write is in progress */
+  uint16_t topic_length;
+  uint16_t value_length;
+  bool has_value;
+  uint32_t generation;   /* retained_generation the value was written in */
+  uint8_t topic[MQTT_RETAINED_CACHE_TOPIC_SIZE];
+  uint8_t value[MQTT_RETAINED_CACHE_VALUE_SIZE];
+} mqtt_retained_cache_entry_t;
+
+static mqtt_retained_cache_entry_t retained_entries[MQTT_RETAINED_CACHE_SLOTS];
+static uint32_t retained_entry_count;
+/* bumped by invalidate, values from an older generation read as empty; the entries keep one writer */
+static atomic_uint retained_generation;
+
+/**
+ *  Local functions
+ */
+
+static mqtt_retained_cache_entry_t *mqtt_retained_cache_find(const uint8_t *topic, uint16_t topic_length);
+
+/**
+ * Function implementation
+ */
+
+sl_status_t mqtt_retained_cache_register(const char *topic)
+{
+  uint16_t topic_length = (uint16_t)strlen(topic);
+
+  if(topic_length > MQTT_RETAINED_CACHE_TOPIC_SIZE)
+  { return SL_STATUS_INVALID_PARAMETER; }
+  if(mqtt_retained_cache_find((const uint8_t *)topic, topic_length) != NULL)
+  { return SL_STATUS_OK; } /* kept over reconnect */
+  if(retained_entry_count >= MQTT_RETAINED_CACHE_SLOTS)
+  { return SL_STATUS_NO_MORE_RESOURCE; }
+
+  mqtt_retained_cache_entry_t *entry = &retained_entries[retained_entry_count];
+  memcpy(entry->topic, topic, topic_length);
+  entry->topic_length = topic_length;
+  entry->has_value    = false;
+  atomic_init(&entry->sequence, 0U);
+  retained_entry_count++;
+  return SL_STATUS_OK;
+}
+
+mqttRetainedCacheResult_t mqtt_retained_cache_update(const uint8_t *topic, uint16_t topic_length,
+                                                     const uint8_t *content, uint32_t content_length)
+{
+  mqtt_retained_cache_entry_t *entry = mqtt_retained_cache_find(topic, topic_length);
+
+  if(entry == NULL || content_length > MQTT_RETAINED_CACHE_VALUE_SIZE)
+  { return mqtt_retained_cache_not_cached; }
+
+  unsigned int generation = atomic_load_explicit(&retained_generation, memory_order_acquire);
+  if(entry->has_value && entry->generation == generation && entry->value_length == content_length
+     && memcmp(entry->value, content, content_length) == 0)
+  { return mqtt_retained_cache_unchanged; }
+
+  /* single writer: the MQTT receive context */
+  unsigned int sequence = atomic_load_explicit(&entry->sequence, memory_order_relaxed);
+  atomic_store_explicit(&entry->sequence, sequence + 1U, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  memcpy(entry->value, content, content_length);
+  entry->value_length = (uint16_t)content_length;
+  entry->has_value    = true;
+  entry->generation   = generation;
+
+  atomic_store_explicit(&entry->sequence, sequence + 2U, memory_order_release);
+  return mqtt_retained_cache_changed;
+}
+
+sl_status_t mqtt_retained_cache_read(const char *topic, uint8_t *buffer, uint32_t buffer_size, uint32_t *length)
+{
+  mqtt_retained_cache_entry_t *entry = mqtt_retained_cache_find((const uint8_t *)topic, (uint16_t)strlen(topic));
+  unsigned int before, after;
+  uint32_t value_length;
+  bool has_value;
+
+  if(entry == NULL)
+  { return SL_STATUS_NOT_FOUND; }
+
+  do
+  {
+    before = atomic_load_explicit(&entry->sequence, memory_order_acquire);
+    if(before & 1U)
+    { continue; }
+
+    has_value    = entry->has_value
+                   && entry->generation == atomic_load_explicit(&retained_generation, memory_order_acquire);
+    value_length = entry->value_length;
+    if(has_value && value_length <= buffer_size)
+    { memcpy(buffer, entry->value, value_length); }
+
+    atomic_thread_fence(memory_order_acquire);
+    after = atomic_load_explicit(&entry->sequence, memory_order_relaxed);
+  } while((before & 1U) || before != after);
+
+  if(!has_value)
+  { return SL_STATUS_EMPTY; }
+  *length = value_length;
+  return (value_length <= buffer_size) ? SL_STATUS_OK : SL_STATUS_WOULD_OVERFLOW;
+}
+
+void mqtt_retained_cache_invalidate(void)
+{
+  /* no entry is written here, the receive context stays their only writer */
+  atomic_fetch_add_explicit(&retained_generation, 1U, memory_order_release);
+}
+
+static mqtt_retained_cache_entry_t *mqtt_retained_cache_find(const uint8_t *topic, uint16_t topic_length)
+{
+  for(uint32_t i = 0; i < retained_entry_count; i++)
+  {
+    if(retained_entries[i].topic_length == topic_length
+       && memcmp(retained_entries[i].topic, topic, topic_length) == 0)
+    { return &retained_entries[i]; }
+  }
+  return NULL;
+}
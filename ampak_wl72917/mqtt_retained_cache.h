@@ -0,0 +1,43 @@
+/*
+ * mqtt_retained_cache.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_MQTT_RETAINED_CACHE_H_
+#define AMPAK_WL72917_MQTT_RETAINED_CACHE_H_
+
+#include "sl_status.h"
+#include "stdint.h"
+#include "stdbool.h"
+
+#define MQTT_RETAINED_CACHE_SLOTS 4U
+#define MQTT_RETAINED_CACHE_TOPIC_SIZE 64U
+#define MQTT_RETAINED_CACHE_VALUE_SIZE 128U
+
+/** keep cached values over M4 sleep with retention, else drop them on wake up **/
+#define MQTT_RETAINED_CACHE_KEEP_OVER_SLEEP 1
+
+typedef enum {
+  mqtt_retained_cache_not_cached = 0, /* topic not registered or value too large */
+  mqtt_retained_cache_changed,
+  mqtt_retained_cache_unchanged,
+} mqttRetainedCacheResult_t;
+
+/**
+ * Last value store for selected topics.
+ *
+ * Values are written from the MQTT receive context and read from any task
+ * without locking: readers retry while a write is in progress (seqlock).
+ * Contents are kept across reconnects. mqtt_retained_cache_invalidate() may
+ * be called from any task; it only moves to a new generation, in which the
+ * old values read as empty until received again.
+ */
+sl_status_t mqtt_retained_cache_register(const char *topic);
+mqttRetainedCacheResult_t mqtt_retained_cache_update(const uint8_t *topic, uint16_t topic_length,
+                                                     const uint8_t *content, uint32_t content_length);
+sl_status_t mqtt_retained_cache_read(const char *topic, uint8_t *buffer, uint32_t buffer_size, uint32_t *length);
+void mqtt_retained_cache_invalidate(void);
+
+#endif /* AMPAK_WL72917_MQTT_RETAINED_CACHE_H_ */
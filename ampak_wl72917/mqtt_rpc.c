@@ -0,0 +1,342 @@
+/*
+ * mqtt_rpc.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#include "ampak_wl72917/mqtt_rpc.h"
+#include "ampak_wl72917/mqtt_command.h"
+#include "ampak_wl72917/mqtt_publish_queue.h"
+#include "ampak_wl72917/ampak_fmt.h"
+#include "ampak_wl72917/sl_mqtt_client_ext.h"
+#include "cmsis_os2.h"
+#include "stdio.h"
+#include "string.h"
+
+typedef enum {
+  mqtt_rpc_slot_free = 0,
+  mqtt_rpc_slot_queued,
+  mqtt_rpc_slot_running,
+} mqttRpcSlotState_t;
+
+typedef struct {
+  uint8_t state;              /* mqttRpcSlotState_t */
+  uint8_t id_length;
+  uint16_t command_length;
+  uint32_t sequence;          /* arrival order */
+  uint32_t received_tick;
+  uint32_t deadline_tick;
+  sl_mqtt_client_message_t *request;  /* retained, id and command point into it */
+  const char *id;
+  const uint8_t *command;
+} mqtt_rpc_slot_t;
+
+typedef struct {
+  const uint8_t *id;
+  uint32_t id_length;
+  uint32_t deadline_ms;
+  const uint8_t *command;
+  uint32_t command_length;
+} mqtt_rpc_envelope_t;
+
+static mqtt_rpc_slot_t rpc_slots[MQTT_RPC_INFLIGHT_SLOTS];
+static uint32_t rpc_sequence;
+static const char *rpc_response_topic = NULL;
+static uint8_t rpc_qos_level;
+static osMutexId_t rpc_lock = NULL;
+static mqtt_rpc_stats_t rpc_stats;
+
+/**
+ *  Local functions
+ */
+
+static bool mqtt_rpc_parse(const uint8_t *payload, uint32_t payload_length, mqtt_rpc_envelope_t *envelope);
+static void mqtt_rpc_respond(const char *id,
+                             uint32_t id_length,
+                             const char *verdict,
+                             const char *result,
+                             uint32_t result_length,
+                             int32_t ttl_ms);
+static void mqtt_rpc_histogram_add(mqtt_rpc_histogram_t *histogram, uint32_t ms);
+static uint32_t mqtt_rpc_ticks_to_ms(uint32_t ticks);
+
+/**
+ * Function implementation
+ */
+
+sl_status_t mqtt_rpc_init(const char *response_topic, uint8_t qos_level)
+{
+  if(response_topic == NULL)
+  { return SL_STATUS_NULL_POINTER; }
+  if(rpc_lock == NULL)
+  { rpc_lock = osMutexNew(NULL); }
+  if(rpc_lock == NULL)
+  { return SL_STATUS_ALLOCATION_FAILED; }
+
+  osMutexAcquire(rpc_lock, osWaitForever);
+  rpc_response_topic = response_topic;
+  rpc_qos_level      = qos_level;
+  osMutexRelease(rpc_lock);
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_rpc_submit(sl_mqtt_client_message_t *message)
+{
+  mqtt_rpc_envelope_t envelope;
+  mqtt_rpc_slot_t *free_slot = NULL;
+  sl_mqtt_client_message_t *request = NULL;
+  uint32_t in_flight         = 0;
+  bool duplicate             = false;
+
+  if(rpc_lock == NULL)
+  { return SL_STATUS_NOT_INITIALIZED; }
+  if(!mqtt_rpc_parse(message->content, message->content_length, &envelope))
+  {
+    osMutexAcquire(rpc_lock, osWaitForever);
+    rpc_stats.malformed++;
+    osMutexRelease(rpc_lock);
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  osMutexAcquire(rpc_lock, osWaitForever);
+  rpc_stats.received++;
+  for(uint32_t i = 0; i < MQTT_RPC_INFLIGHT_SLOTS; i++)
+  {
+    mqtt_rpc_slot_t *slot = &rpc_slots[i];
+    if(slot->state == mqtt_rpc_slot_free)
+    {
+      if(free_slot == NULL)
+      { free_slot = slot; }
+      continue;
+    }
+    in_flight++;
+    if(slot->id_length == envelope.id_length && memcmp(slot->id, envelope.id, envelope.id_length) == 0)
+    { duplicate = true; }
+  }
+
+  if(!duplicate && free_slot != NULL)
+  { request = sl_mqtt_client_message_retain(message); }
+
+  if(duplicate)
+  { rpc_stats.duplicates++; }
+  else if(request == NULL)
+  { rpc_stats.busy++; }
+  else
+  {
+    uint32_t now = osKernelGetTickCount();
+    free_slot->state          = mqtt_rpc_slot_queued;
+    free_slot->id_length      = (uint8_t)envelope.id_length;
+    free_slot->command_length = (uint16_t)envelope.command_length;
+    free_slot->sequence       = rpc_sequence++;
+    free_slot->received_tick  = now;
+    free_slot->deadline_tick  = now + (uint32_t)(((uint64_t)envelope.deadline_ms * osKernelGetTickFreq()) / 1000U);
+    free_slot->request        = request;
+    free_slot->id             = (const char *)envelope.id;
+    free_slot->command        = envelope.command;
+    if(++in_flight > rpc_stats.max_in_flight)
+    { rpc_stats.max_in_flight = in_flight; }
+  }
+  osMutexRelease(rpc_lock);
+
+  if(duplicate)
+  { return SL_STATUS_ALREADY_EXISTS; }
+  if(request == NULL)
+  {
+    /* answer right away, the caller should back off rather than wait for a deadline */
+    mqtt_rpc_respond((const char *)envelope.id, envelope.id_length, "busy", NULL, 0, (int32_t)envelope.deadline_ms);
+    return SL_STATUS_BUSY;
+  }
+  return SL_STATUS_OK;
+}
+
+uint32_t mqtt_rpc_process(void)
+{
+  static char result[MQTT_PUBLISH_PAYLOAD_SIZE];
+  uint32_t handled = 0;
+
+  if(rpc_lock == NULL)
+  { return 0; }
+
+  while(1)
+  {
+    mqtt_rpc_slot_t *slot = NULL;
+
+    osMutexAcquire(rpc_lock, osWaitForever);
+    for(uint32_t i = 0; i < MQTT_RPC_INFLIGHT_SLOTS; i++)
+    {
+      if(rpc_slots[i].state == mqtt_rpc_slot_queued
+         && (slot == NULL || (int32_t)(rpc_slots[i].sequence - slot->sequence) < 0))
+      { slot = &rpc_slots[i]; }
+    }
+    if(slot != NULL)
+    { slot->state = mqtt_rpc_slot_running; }
+    osMutexRelease(rpc_lock);
+    if(slot == NULL)
+    { break; }
+
+    uint32_t start_tick = osKernelGetTickCount();
+    uint32_t end_tick   = start_tick;
+    int32_t remaining   = (int32_t)(slot->deadline_tick - start_tick);
+    bool timed_out      = (remaining <= 0);
+
+    if(timed_out)
+    { mqtt_rpc_respond(slot->id, slot->id_length, "timeout", NULL, 0, 0); }
+    else
+    {
+      uint32_t result_length = 0;
+      sl_status_t status     = mqtt_command_dispatch(slot->command, slot->command_length, result, sizeof(result), &result_length);
+
+      end_tick  = osKernelGetTickCount();
+      remaining = (int32_t)(slot->deadline_tick - end_tick);
+      remaining = (remaining > 0) ? (int32_t)mqtt_rpc_ticks_to_ms((uint32_t)remaining) : 0;
+      if(status == SL_STATUS_OK)
+      { mqtt_rpc_respond(slot->id, slot->id_length, "ok", result, result_length, remaining); }
+      else
+      {
+        ampak_fmt_t fmt;
+        ampak_fmt_hex(ampak_fmt_lit(ampak_fmt_init(&fmt, result, sizeof(result)), "0x"), status, 8);
+        mqtt_rpc_respond(slot->id, slot->id_length, "error", result, ampak_fmt_length(&fmt), remaining);
+      }
+    }
+
+    /* stats are read by other tasks, so they only change under the lock */
+    osMutexAcquire(rpc_lock, osWaitForever);
+    if(timed_out)
+    { rpc_stats.timed_out++; }
+    else
+    {
+      mqtt_rpc_histogram_add(&rpc_stats.queue_ms, mqtt_rpc_ticks_to_ms(start_tick - slot->received_tick));
+      mqtt_rpc_histogram_add(&rpc_stats.service_ms, mqtt_rpc_ticks_to_ms(end_tick - start_tick));
+      rpc_stats.completed++;
+    }
+    sl_mqtt_client_message_t *request = slot->request;
+    slot->request = NULL;
+    slot->state   = mqtt_rpc_slot_free;
+    osMutexRelease(rpc_lock);
+    sl_mqtt_client_message_release(request);
+    handled++;
+  }
+  return handled;
+}
+
+void mqtt_rpc_get_stats(mqtt_rpc_stats_t *stats)
+{
+  if(rpc_lock == NULL)
+  {
+    memset(stats, 0, sizeof(*stats));
+    return;
+  }
+  osMutexAcquire(rpc_lock, osWaitForever);
+  *stats = rpc_stats;
+  osMutexRelease(rpc_lock);
+}
+
+uint32_t mqtt_rpc_histogram_percentile(const mqtt_rpc_histogram_t *histogram, uint32_t percent)
+{
+  uint64_t total = 0;
+  uint64_t seen  = 0;
+
+  for(uint32_t i = 0; i < MQTT_RPC_HISTOGRAM_BUCKETS; i++)
+  { total += histogram->count[i]; }
+  if(total == 0)
+  { return 0; }
+
+  uint64_t target = (total * percent + 99U) / 100U;
+  for(uint32_t i = 0; i < MQTT_RPC_HISTOGRAM_BUCKETS; i++)
+  {
+    seen += histogram->count[i];
+    if(seen >= target && seen != 0)
+    { return (i == 0) ? 0 : (1UL << i) - 1U; }
+  }
+  return (1UL << (MQTT_RPC_HISTOGRAM_BUCKETS - 1U)) - 1U;
+}
+
+static bool mqtt_rpc_parse(const uint8_t *payload, uint32_t payload_length, mqtt_rpc_envelope_t *envelope)
+{
+  uint32_t i = 1;
+
+  if(payload_length < 4U || payload[0] != MQTT_RPC_ENVELOPE_MARK)
+  { return false; }
+
+  envelope->id = &payload[i];
+  while(i < payload_length && payload[i] != ' ' && payload[i] != MQTT_RPC_DEADLINE_MARK)
+  {
+    if(payload[i] < 0x21U || payload[i] > 0x7EU)
+    { return false; }
+    i++;
+  }
+  envelope->id_length = i - 1U;
+  if(envelope->id_length == 0 || envelope->id_length > MQTT_RPC_ID_MAX)
+  { return false; }
+
+  envelope->deadline_ms = MQTT_RPC_DEFAULT_DEADLINE_MS;
+  if(i < payload_length && payload[i] == MQTT_RPC_DEADLINE_MARK)
+  {
+    uint32_t deadline = 0;
+    uint32_t digits   = 0;
+    for(i++; i < payload_length && payload[i] >= '0' && payload[i] <= '9'; i++, digits++)
+    {
+      deadline = deadline * 10U + (uint32_t)(payload[i] - '0');
+      if(deadline > MQTT_RPC_MAX_DEADLINE_MS)
+      { return false; }
+    }
+    if(digits == 0 || deadline == 0)
+    { return false; }
+    envelope->deadline_ms = deadline;
+  }
+
+  if(i >= payload_length || payload[i] != ' ')
+  { return false; }
+  envelope->command        = &payload[i + 1U];
+  envelope->command_length = payload_length - i - 1U;
+  return (envelope->command_length != 0 && envelope->command_length <= MQTT_RPC_REQUEST_SIZE);
+}
+
+static void mqtt_rpc_respond(const char *id,
+                             uint32_t id_length,
+                             const char *verdict,
+                             const char *result,
+                             uint32_t result_length,
+                             int32_t ttl_ms)
+{
+  char response[MQTT_PUBLISH_PAYLOAD_SIZE];
+  ampak_fmt_t fmt;
+
+  ampak_fmt_init(&fmt, response, sizeof(response));
+  ampak_fmt_mem(ampak_fmt_char(&fmt, MQTT_RPC_ENVELOPE_MARK), id, id_length);
+  ampak_fmt_str(ampak_fmt_char(&fmt, ' '), verdict);
+  if(result_length != 0)
+  { ampak_fmt_mem(ampak_fmt_char(&fmt, ' '), result, result_length); }
+
+  /* a result cut short is still better than none, the verdict comes first */
+  sl_status_t status = mqtt_publish_queue_push(rpc_response_topic,
+                                               (const uint8_t *)response,
+                                               (uint16_t)ampak_fmt_length(&fmt),
+                                               rpc_qos_level,
+                                               0,
+                                               0,
+                                               (ttl_ms > (int32_t)MQTT_RPC_MIN_REPLY_TTL_MS) ? (uint32_t)ttl_ms
+                                                                                             : MQTT_RPC_MIN_REPLY_TTL_MS);
+  if(status != SL_STATUS_OK)
+  {
+    osMutexAcquire(rpc_lock, osWaitForever);
+    rpc_stats.reply_drops++;
+    osMutexRelease(rpc_lock);
+    printf("Failed to queue rpc response: 0x%lx\r\n", status);
+  }
+}
+
+static void mqtt_rpc_histogram_add(mqtt_rpc_histogram_t *histogram, uint32_t ms)
+{
+  uint32_t bucket = (ms == 0) ? 0 : 32U - (uint32_t)__builtin_clz(ms);
+
+  if(bucket >= MQTT_RPC_HISTOGRAM_BUCKETS)
+  { bucket = MQTT_RPC_HISTOGRAM_BUCKETS - 1U; }
+  histogram->count[bucket]++;
+}
+
+static uint32_t mqtt_rpc_ticks_to_ms(uint32_t ticks)
+{
+  return (uint32_t)(((uint64_t)ticks * 1000U) / osKernelGetTickFreq());
+}
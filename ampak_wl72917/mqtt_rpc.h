@@ -0,0 +1,75 @@
+/*
+ * mqtt_rpc.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_MQTT_RPC_H_
+#define AMPAK_WL72917_MQTT_RPC_H_
+
+#include "sl_status.h"
+#include "sl_mqtt_client.h"
+#include "stdint.h"
+#include "stdbool.h"
+
+/** requests accepted but not answered yet, more are answered "busy" straight away **/
+#define MQTT_RPC_INFLIGHT_SLOTS 8U
+/** longest command part of a request **/
+#define MQTT_RPC_REQUEST_SIZE   128U
+#define MQTT_RPC_ID_MAX         16U
+/** deadline of a request that does not carry one **/
+#define MQTT_RPC_DEFAULT_DEADLINE_MS 10000U
+#define MQTT_RPC_MAX_DEADLINE_MS     300000U
+#define MQTT_RPC_MIN_REPLY_TTL_MS    1000U
+
+/** bucket 0 is 0 ms, bucket n is 2^(n-1) .. 2^n - 1 ms, the last one open ended **/
+#define MQTT_RPC_HISTOGRAM_BUCKETS 14U
+
+/** request envelope, "@<id>[/<deadline ms>] <verb>[ <argument>]" **/
+#define MQTT_RPC_ENVELOPE_MARK     '@'
+#define MQTT_RPC_DEADLINE_MARK     '/'
+
+typedef struct {
+  uint32_t count[MQTT_RPC_HISTOGRAM_BUCKETS];
+} mqtt_rpc_histogram_t;
+
+typedef struct {
+  uint32_t received;
+  uint32_t completed;       /* handler ran, "ok" or "error" sent */
+  uint32_t busy;            /* in-flight table or receive buffer pool full */
+  uint32_t timed_out;       /* deadline passed before the handler ran */
+  uint32_t duplicates;      /* id already in flight, ignored */
+  uint32_t malformed;       /* no usable envelope, nothing to answer to */
+  uint32_t reply_drops;     /* response could not be queued */
+  uint32_t max_in_flight;
+  mqtt_rpc_histogram_t queue_ms;    /* arrival until the handler starts */
+  mqtt_rpc_histogram_t service_ms;  /* handler run time */
+} mqtt_rpc_stats_t;
+
+/**
+ * Request / response over MQTT.
+ *
+ * Requests arrive on a per device topic wrapped in an envelope carrying the
+ * caller's id and an optional deadline, so a backend can pipeline several of
+ * them. Each is answered on response_topic with "@<id> ok <result>",
+ * "@<id> error 0x<status>", "@<id> timeout" or "@<id> busy", the result being
+ * whatever the mqtt_command handler wrote.
+ *
+ * mqtt_rpc_submit() runs in the client callback and retains the received
+ * message in a free in-flight slot, no copy; a message that can not be
+ * retained is answered "busy" like a full table. mqtt_rpc_process() runs the
+ * queued requests oldest first from one task and releases each message. A request whose deadline passed while queued is
+ * answered "timeout" without running. Responses expire from the publish
+ * queue at the request deadline, but never sooner than
+ * MQTT_RPC_MIN_REPLY_TTL_MS. response_topic must stay valid.
+ */
+sl_status_t mqtt_rpc_init(const char *response_topic, uint8_t qos_level);
+sl_status_t mqtt_rpc_submit(sl_mqtt_client_message_t *message);
+uint32_t mqtt_rpc_process(void);
+void mqtt_rpc_get_stats(mqtt_rpc_stats_t *stats);
+
+/** upper bound of the bucket holding the given percentile, 0 when empty **/
+uint32_t mqtt_rpc_histogram_percentile(const mqtt_rpc_histogram_t *histogram, uint32_t percent);
+
+#endif /* AMPAK_WL72917_MQTT_RPC_H_ */
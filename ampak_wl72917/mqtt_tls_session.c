@@ -0,0 +1,115 @@
+/*
+ * mqtt_tls_session.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#include "ampak_wl72917/mqtt_tls_session.h"
+#include "cmsis_os2.h"
+
+typedef struct {
+  bool valid;
+  uint32_t address;           /* IPv4, network order as in sl_mqtt_broker_t */
+  uint16_t port;
+  uint32_t established_ms;    /* last full handshake */
+} mqtt_tls_session_entry_t;
+
+/* .bss, so empty after reset and kept over sleep with retention, like the NWP session cache */
+static mqtt_tls_session_entry_t session_entry;
+static mqtt_tls_session_entry_t session_pending;
+static mqttTlsHandshake_t session_expected;
+static mqttTlsHandshake_t session_last;
+static mqtt_tls_session_stats_t session_stats;
+
+static const char *const session_names[mqtt_tls_handshake_count] = { "none", "full", "resumable (expected)" };
+
+/**
+ *  Local functions
+ */
+
+static uint32_t mqtt_tls_session_now_ms(void);
+
+/**
+ * Function implementation
+ */
+
+void mqtt_tls_session_on_connect_start(const sl_mqtt_broker_t *broker)
+{
+  uint32_t now = mqtt_tls_session_now_ms();
+
+  session_expected = mqtt_tls_handshake_none;
+  if(broker == NULL || !broker->is_connection_encrypted)
+  { return; }
+
+  session_pending.valid          = true;
+  session_pending.address        = broker->ip.ip.v4.value;
+  session_pending.port           = broker->port;
+  session_pending.established_ms = now;
+
+  if(session_entry.valid && (now - session_entry.established_ms) >= MQTT_TLS_SESSION_LIFETIME_MS)
+  {
+    session_entry.valid = false;
+    session_stats.invalidated++;
+  }
+
+  if(session_entry.valid && session_entry.address == session_pending.address && session_entry.port == session_pending.port)
+  { session_expected = mqtt_tls_handshake_resumable; }
+  else
+  { session_expected = mqtt_tls_handshake_full; }
+}
+
+mqttTlsHandshake_t mqtt_tls_session_on_connected(uint32_t transport_ms)
+{
+  mqttTlsHandshake_t handshake = session_expected;
+
+  session_expected = mqtt_tls_handshake_none;
+  if(handshake == mqtt_tls_handshake_none)
+  { return session_last = mqtt_tls_handshake_none; }
+
+  /* the session age runs from the last connect expected to be full */
+  if(handshake == mqtt_tls_handshake_full)
+  { session_entry = session_pending; }
+
+  session_stats.connects[handshake]++;
+  session_stats.total_ms[handshake] += transport_ms;
+  if(transport_ms > session_stats.max_ms[handshake])
+  { session_stats.max_ms[handshake] = transport_ms; }
+  return session_last = handshake;
+}
+
+void mqtt_tls_session_on_connect_failed(void)
+{
+  /* a failed handshake may have been a rejected session, do not offer it again */
+  if(session_expected != mqtt_tls_handshake_none)
+  { mqtt_tls_session_invalidate(); }
+  session_expected = mqtt_tls_handshake_none;
+}
+
+void mqtt_tls_session_invalidate(void)
+{
+  if(!session_entry.valid)
+  { return; }
+  session_entry.valid = false;
+  session_stats.invalidated++;
+}
+
+mqttTlsHandshake_t mqtt_tls_session_last(void)
+{
+  return session_last;
+}
+
+void mqtt_tls_session_get_stats(mqtt_tls_session_stats_t *stats)
+{
+  *stats = session_stats;
+}
+
+const char *mqtt_tls_session_name(mqttTlsHandshake_t handshake)
+{
+  return (handshake < mqtt_tls_handshake_count) ? session_names[handshake] : "?";
+}
+
+static uint32_t mqtt_tls_session_now_ms(void)
+{
+  return (uint32_t)(((uint64_t)osKernelGetTickCount() * 1000U) / osKernelGetTickFreq());
+}
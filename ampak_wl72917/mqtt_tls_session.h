@@ -0,0 +1,59 @@
+/*
+ * mqtt_tls_session.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_MQTT_TLS_SESSION_H_
+#define AMPAK_WL72917_MQTT_TLS_SESSION_H_
+
+#include "sl_mqtt_client.h"
+#include "stdint.h"
+#include "stdbool.h"
+
+/** do not expect resumption past this, keep at or below the broker's ticket / session cache lifetime **/
+#ifndef MQTT_TLS_SESSION_LIFETIME_MS
+#define MQTT_TLS_SESSION_LIFETIME_MS (2UL * 3600UL * 1000UL)
+#endif
+
+typedef enum {
+  mqtt_tls_handshake_none = 0,    /* plain TCP, or no connect yet */
+  mqtt_tls_handshake_full,
+  mqtt_tls_handshake_resumable,   /* a session the NWP may resume existed, not confirmed */
+  mqtt_tls_handshake_count
+} mqttTlsHandshake_t;
+
+typedef struct {
+  uint32_t connects[mqtt_tls_handshake_count];
+  uint32_t total_ms[mqtt_tls_handshake_count];  /* TCP/TLS setup plus CONNACK */
+  uint32_t max_ms[mqtt_tls_handshake_count];
+  uint32_t invalidated;       /* sessions dropped: failure, new CA, lifetime */
+} mqtt_tls_session_stats_t;
+
+/**
+ * TLS session resumption bookkeeping.
+ *
+ * The embedded MQTT client of the NWP owns the TLS socket; its init request
+ * only carries an encrypt flag, and the session cache of the NWP TLS stack is
+ * not visible to the host. What the host controls is keeping that cache
+ * usable: reconnect to the same broker address, leave the NWP powered over M4
+ * sleep, and do not rewrite the CA certificate (provision_cache), any of
+ * which would force a full handshake.
+ *
+ * The module tracks whether the last TLS connect to this broker is recent
+ * enough to be resumed and files every connect as full or resumable, with
+ * its CONNACK latency. Firmware 3.1.4 does not report whether the NWP really
+ * resumed, so "resumable" is an expectation, not a measurement.
+ * State sits in plain .bss: lost on reset, kept over sleep with retention.
+ */
+void mqtt_tls_session_on_connect_start(const sl_mqtt_broker_t *broker);
+mqttTlsHandshake_t mqtt_tls_session_on_connected(uint32_t transport_ms);
+void mqtt_tls_session_on_connect_failed(void);
+void mqtt_tls_session_invalidate(void);
+
+mqttTlsHandshake_t mqtt_tls_session_last(void);
+void mqtt_tls_session_get_stats(mqtt_tls_session_stats_t *stats);
+const char *mqtt_tls_session_name(mqttTlsHandshake_t handshake);
+
+#endif /* AMPAK_WL72917_MQTT_TLS_SESSION_H_ */
@@ -12,6 +12,7 @@ static uint8_t os_log_read_buffer[OS_LOG_BUFFER_SIZE + STRING_BUFFER_END];
 static uint8_t os_log_write_buffer[OS_LOG_BUFFER_SIZE];
 osMessageQueueId_t os_log_msg_queue = NULL;
 osThreadId_t os_log_thread_id = NULL;
+static uint32_t os_log_drops;
 
 const osThreadAttr_t os_log_thread_attributes =
     {
@@ -115,11 +116,10 @@ void os_log_task(void* args)
 
   while(1)
   {
-    os_status = osMessageQueueGet(os_log_msg_queue, os_log_read_buffer, NULL, OS_LOG_READ_DELAY);
+    /* block until a line is queued, nothing to poll in between */
+    os_status = osMessageQueueGet(os_log_msg_queue, os_log_read_buffer, NULL, osWaitForever);
     if(os_status == osOK)
     { printf("%s",os_log_read_buffer); }
-    else
-    { osThreadYield(); }
   }
 }
 
@@ -135,6 +135,7 @@ inline static osStatus_t os_log_write(const void* write_buff)
 
   if(os_status != osOK)
   {
+    __atomic_fetch_add(&os_log_drops, 1U, __ATOMIC_RELAXED);
     printf("[%s]", (const char *)write_buff);
     printf("mq%d\r\n", os_status);
   }
@@ -148,7 +149,7 @@ inline osStatus_t os_log_sprint_write(const char* format, ...)
 
   va_list args;
   va_start(args, format);
-  vsprintf((char *)os_log_write_buffer, format, args);
+  vsnprintf((char *)os_log_write_buffer, sizeof(os_log_write_buffer), format, args);
   va_end(args);
 
   return os_log_write(os_log_write_buffer);
@@ -158,3 +159,13 @@ bool os_log_ready(void)
 {
   return (os_log_msg_queue == NULL)? false : ((os_log_thread_id == NULL)? false : true);
 }
+
+uint32_t os_log_queue_depth(void)
+{
+  return (os_log_msg_queue == NULL)? 0 : osMessageQueueGetCount(os_log_msg_queue);
+}
+
+uint32_t os_log_dropped(void)
+{
+  return __atomic_load_n(&os_log_drops, __ATOMIC_RELAXED);
+}
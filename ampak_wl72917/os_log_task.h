@@ -44,5 +44,8 @@ void os_log_deinit(void);
 void os_log_task(void* args);
 osStatus_t os_log_sprint_write(const char* format, ...);
 bool os_log_ready(void);
+uint32_t os_log_queue_depth(void);
+/** lines lost because the queue stayed full, counted whether or not the task runs **/
+uint32_t os_log_dropped(void);
 
 #endif /* AMPAK_WL72917_OS_LOG_TASK_H_ */
@@ -12,6 +12,9 @@
 #include "rsi_ps_config.h"
 #include "sl_si91x_host_interface.h"
 #include "sl_wifi.h"
+#include "ampak_wl72917/mqtt_retained_cache.h"
+#include "ampak_wl72917/ampak_util.h"
+#include "ampak_wl72917/boot_timeline.h"
 
 #define SL_SI91X_MCU_ALARM_BASED_WAKEUP 0
 #define ALARM_PERIODIC_TIME 30 /*<! periodic alarm configuration in SEC */
@@ -23,6 +26,21 @@
 #define BROADCAST_IN_TIM                1
 #define BROADCAST_TIM_TILL_NEXT_COMMAND 1
 
+/** set once the NWP runs associated power save, publishers batch to its wake windows **/
+static volatile bool power_save_active = false;
+/** wakes from M4 sleep since boot, .bss is retained over sleep **/
+static volatile uint32_t m4_wake_count = 0;
+
+bool ampak_power_save_is_active(void)
+{
+  return power_save_active;
+}
+
+uint32_t ampak_m4_wake_count(void)
+{
+  return m4_wake_count;
+}
+
 void ampak_m4_sleep_wakeup(void)
 {
   sl_status_t status = SL_STATUS_OK;
@@ -40,6 +58,7 @@ void ampak_m4_sleep_wakeup(void)
     printf("\r\nPower save configuration Failed, Error Code : 0x%lX\r\n", status);
     return;
   }
+  power_save_active = true;
 
 #ifndef SLI_SI91X_MCU_ENABLE_FLASH_BASED_EXECUTION
   /* LDOSOC Default Mode needs to be disabled */
@@ -103,4 +122,11 @@ void ampak_m4_sleep_wakeup(void)
   //  /*Start of M4 init after wake up  */
   printf("===M4 Wake Up===\r\n");
 #endif
+
+  m4_wake_count++;
+  boot_timeline_wake(); // profile wake to the next publish
+
+#if !MQTT_RETAINED_CACHE_KEEP_OVER_SLEEP
+  mqtt_retained_cache_invalidate();
+#endif
 }
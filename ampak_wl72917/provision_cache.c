@@ -0,0 +1,195 @@
+/*
+ * provision_cache.c
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#include "ampak_wl72917/provision_cache.h"
+#include "sl_si91x_driver.h"
+#include "cmsis_os2.h"
+#include "stddef.h"
+#include "stdio.h"
+#include "string.h"
+
+#define PROVISION_CACHE_MAGIC   0x50524F56UL  /* "PROV" */
+#define PROVISION_CACHE_VERSION 1U
+
+#define PROVISION_CACHE_FNV_OFFSET 0xCBF29CE484222325ULL
+#define PROVISION_CACHE_FNV_PRIME  0x00000100000001B3ULL
+
+typedef struct {
+  uint32_t id;
+  uint32_t type;
+  uint32_t length;
+  uint32_t reserved;
+  uint64_t hash;
+} provision_cache_entry_t;
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint64_t salt;
+  provision_cache_entry_t entries[PROVISION_CACHE_ENTRIES];
+  uint64_t check;             /* hash of everything above */
+} provision_cache_manifest_t;
+
+static provision_cache_manifest_t cache_manifest;
+static const provision_cache_storage_t *cache_storage = NULL;
+static osMutexId_t cache_lock = NULL;
+static bool cache_dirty;
+static provision_cache_stats_t cache_stats;
+
+/**
+ *  Local functions
+ */
+
+static uint64_t provision_cache_hash(uint64_t hash, const void *data, uint32_t length);
+static provision_cache_entry_t *provision_cache_find(sl_net_credential_id_t id);
+static sl_status_t provision_cache_flash_read(void *data, uint32_t length);
+static sl_status_t provision_cache_flash_write(const void *data, uint32_t length);
+
+const provision_cache_storage_t provision_cache_flash_storage = {
+  .read  = provision_cache_flash_read,
+  .write = provision_cache_flash_write,
+};
+
+/**
+ * Function implementation
+ */
+
+void provision_cache_init(const provision_cache_storage_t *storage, const void *salt, uint32_t salt_length)
+{
+  uint64_t salt_hash = provision_cache_hash(PROVISION_CACHE_FNV_OFFSET, salt, salt_length);
+
+  cache_storage = storage;
+  cache_dirty   = false;
+  memset(&cache_stats, 0, sizeof(cache_stats));
+  if(cache_lock == NULL)
+  { cache_lock = osMutexNew(NULL); }
+
+  if(storage == NULL || storage->read(&cache_manifest, sizeof(cache_manifest)) != SL_STATUS_OK
+     || cache_manifest.magic != PROVISION_CACHE_MAGIC || cache_manifest.version != PROVISION_CACHE_VERSION
+     || cache_manifest.count > PROVISION_CACHE_ENTRIES
+     || cache_manifest.check != provision_cache_hash(PROVISION_CACHE_FNV_OFFSET, &cache_manifest, offsetof(provision_cache_manifest_t, check)))
+  {
+    printf("Provisioning manifest empty\r\n");
+    memset(&cache_manifest, 0, sizeof(cache_manifest));
+  }
+  else if(cache_manifest.salt != salt_hash)
+  {
+    printf("NWP firmware changed, provisioning manifest dropped\r\n");
+    memset(&cache_manifest, 0, sizeof(cache_manifest));
+  }
+
+  cache_manifest.magic   = PROVISION_CACHE_MAGIC;
+  cache_manifest.version = PROVISION_CACHE_VERSION;
+  cache_manifest.salt    = salt_hash;
+}
+
+sl_status_t provision_cache_set_credential(sl_net_credential_id_t id,
+                                           sl_net_credential_type_t type,
+                                           const void *data,
+                                           uint32_t length,
+                                           bool *written)
+{
+  uint64_t hash = provision_cache_hash(PROVISION_CACHE_FNV_OFFSET, data, length);
+  provision_cache_entry_t *entry;
+  bool current;
+
+  if(written != NULL)
+  { *written = false; }
+
+  osMutexAcquire(cache_lock, osWaitForever);
+  entry   = provision_cache_find(id);
+  current = (entry != NULL && entry->type == (uint32_t)type && entry->length == length && entry->hash == hash);
+  if(current)
+  { cache_stats.skipped++; }
+  osMutexRelease(cache_lock);
+  if(current)
+  { return SL_STATUS_OK; }
+
+  sl_status_t status = sl_net_set_credential(id, type, data, length);
+  if(status != SL_STATUS_OK)
+  { return status; }
+  if(written != NULL)
+  { *written = true; }
+
+  osMutexAcquire(cache_lock, osWaitForever);
+  cache_stats.written++;
+  entry = provision_cache_find(id);
+  if(entry == NULL && cache_manifest.count < PROVISION_CACHE_ENTRIES)
+  { entry = &cache_manifest.entries[cache_manifest.count++]; }
+  if(entry != NULL)
+  {
+    entry->id     = (uint32_t)id;
+    entry->type   = (uint32_t)type;
+    entry->length = length;
+    entry->hash   = hash;
+    cache_dirty   = true;
+  }
+  else
+  { printf("Provisioning manifest full, credential 0x%lx not cached\r\n", (uint32_t)id); }
+  osMutexRelease(cache_lock);
+  return SL_STATUS_OK;
+}
+
+sl_status_t provision_cache_commit(void)
+{
+  if(!cache_dirty || cache_storage == NULL)
+  { return SL_STATUS_OK; }
+
+  cache_manifest.check = provision_cache_hash(PROVISION_CACHE_FNV_OFFSET, &cache_manifest, offsetof(provision_cache_manifest_t, check));
+  sl_status_t status   = cache_storage->write(&cache_manifest, sizeof(cache_manifest));
+  if(status != SL_STATUS_OK)
+  {
+    printf("Failed to write provisioning manifest: 0x%lx\r\n", status);
+    return status;
+  }
+  cache_dirty = false;
+  cache_stats.manifest_writes++;
+  return SL_STATUS_OK;
+}
+
+void provision_cache_get_stats(provision_cache_stats_t *stats)
+{
+  *stats = cache_stats;
+}
+
+static uint64_t provision_cache_hash(uint64_t hash, const void *data, uint32_t length)
+{
+  const uint8_t *bytes = (const uint8_t *)data;
+
+  for(uint32_t i = 0; i < length; i++)
+  {
+    hash ^= bytes[i];
+    hash *= PROVISION_CACHE_FNV_PRIME;
+  }
+  return hash;
+}
+
+static provision_cache_entry_t *provision_cache_find(sl_net_credential_id_t id)
+{
+  for(uint32_t i = 0; i < cache_manifest.count; i++)
+  {
+    if(cache_manifest.entries[i].id == (uint32_t)id)
+    { return &cache_manifest.entries[i]; }
+  }
+  return NULL;
+}
+
+static sl_status_t provision_cache_flash_read(void *data, uint32_t length)
+{
+  /* common flash is memory mapped for the M4 */
+  memcpy(data, (const void *)PROVISION_CACHE_FLASH_ADDRESS, length);
+  return SL_STATUS_OK;
+}
+
+static sl_status_t provision_cache_flash_write(const void *data, uint32_t length)
+{
+  if(length > 0xFFFFU)
+  { return SL_STATUS_INVALID_PARAMETER; }
+  /* the NWP owns flash programming; erase the sector first */
+  return sl_si91x_command_to_write_common_flash(PROVISION_CACHE_FLASH_ADDRESS, (uint8_t *)data, (uint16_t)length, 1);
+}
@@ -0,0 +1,65 @@
+/*
+ * provision_cache.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+#ifndef AMPAK_WL72917_PROVISION_CACHE_H_
+#define AMPAK_WL72917_PROVISION_CACHE_H_
+
+#include "sl_net.h"
+#include "sl_status.h"
+#include "stdint.h"
+#include "stdbool.h"
+
+#define PROVISION_CACHE_ENTRIES 8U
+
+/**
+ * 4 KB common flash sector holding the manifest. config/linkerfile_SoC.ld
+ * reserves it as the "provision" region, cut from the end of rom, and fails
+ * the link if the image reaches it; move both together.
+ */
+#ifndef PROVISION_CACHE_FLASH_ADDRESS
+#define PROVISION_CACHE_FLASH_ADDRESS 0x083FF000UL
+#endif
+
+typedef struct {
+  sl_status_t (*read)(void *data, uint32_t length);
+  sl_status_t (*write)(const void *data, uint32_t length);   /* erase and program */
+} provision_cache_storage_t;
+
+typedef struct {
+  uint32_t skipped;           /* writes avoided, content already in the NWP */
+  uint32_t written;
+  uint32_t manifest_writes;
+} provision_cache_stats_t;
+
+/**
+ * Manifest of what was last written to the NWP credential store.
+ *
+ * Each entry keeps credential id, type, length and a 64-bit FNV-1a hash of the
+ * content; a salt (the NWP firmware version) covers all of them, because a
+ * firmware update may wipe the store. provision_cache_set_credential() only
+ * calls sl_net_set_credential() when the entry differs, so an unchanged boot
+ * costs one hash per credential and no flash write.
+ *
+ * The hash detects changes, it does not authenticate; the manifest itself is
+ * checked with its own hash and treated as empty when that does not match.
+ * Set credentials from any thread; provision_cache_commit() persists them
+ * and must not run concurrently with them.
+ */
+void provision_cache_init(const provision_cache_storage_t *storage, const void *salt, uint32_t salt_length);
+/** @param written  optional, true when the credential went to the NWP, false when it was already there **/
+sl_status_t provision_cache_set_credential(sl_net_credential_id_t id,
+                                           sl_net_credential_type_t type,
+                                           const void *data,
+                                           uint32_t length,
+                                           bool *written);
+sl_status_t provision_cache_commit(void);
+void provision_cache_get_stats(provision_cache_stats_t *stats);
+
+/** default storage, memory mapped read and NWP common flash write at PROVISION_CACHE_FLASH_ADDRESS **/
+extern const provision_cache_storage_t provision_cache_flash_storage;
+
+#endif /* AMPAK_WL72917_PROVISION_CACHE_H_ */
@@ -0,0 +1,124 @@
+/*
+ * sl_mqtt_client_ext.h
+ *
+ *  Created on: 2026/10/18
+ *      Author: ch.wang
+ */
+
+/** Extensions implemented in the local copy of sl_mqtt_client.c **/
+
+#ifndef AMPAK_WL72917_SL_MQTT_CLIENT_EXT_H_
+#define AMPAK_WL72917_SL_MQTT_CLIENT_EXT_H_
+
+#include "sl_mqtt_client.h"
+#include "sl_status.h"
+
+/**
+ * What sl_mqtt_client_publish() does with a message whose topic matches one of
+ * the client's own subscriptions.
+ */
+typedef enum {
+  SL_MQTT_CLIENT_LOOPBACK_DISABLED = 0,      ///< Broker round trip only (default)
+  SL_MQTT_CLIENT_LOOPBACK_LOCAL_AND_UPSTREAM, ///< Deliver locally now and send to broker, broker echo is dropped
+  SL_MQTT_CLIENT_LOOPBACK_LOCAL_ONLY,         ///< Deliver locally, never send to broker
+} sl_mqtt_client_loopback_policy_t;
+
+/** Number of looped back messages whose broker echo can be pending at once **/
+#define SL_MQTT_CLIENT_LOOPBACK_ECHO_SLOTS 4
+/** A broker echo not seen within this long is not expected anymore **/
+#define SL_MQTT_CLIENT_LOOPBACK_ECHO_TTL_MS 5000
+
+/** Pool of receive buffers that message handlers may keep past the callback, shared by commands and rpc requests **/
+#define SL_MQTT_CLIENT_RX_BUFFER_COUNT 8
+/** Topic plus content bytes per receive buffer, larger messages are not retainable **/
+#define SL_MQTT_CLIENT_RX_BUFFER_SIZE 512
+
+/** Number of state transitions kept in the trace ring **/
+#define SL_MQTT_CLIENT_STATE_TRACE_SLOTS 32
+
+/** Asynchronous publishes allowed in the shared driver queue at once **/
+#define SL_MQTT_CLIENT_PUBLISH_WINDOW 4
+/** Asynchronous commands whose completion time is tracked **/
+#define SL_MQTT_CLIENT_INFLIGHT_SLOTS 8
+/** A command without completion after this long no longer holds back publishes **/
+#define SL_MQTT_CLIENT_INFLIGHT_STALE_MS 10000
+
+/**
+ * Submission class of a firmware command. The firmware serves the shared network
+ * command queue in order, so control commands get ahead by bounding the publishes
+ * in front of them: publishes are refused with SL_STATUS_BUSY while a control
+ * command is in flight or SL_MQTT_CLIENT_PUBLISH_WINDOW publishes are.
+ */
+typedef enum {
+  SL_MQTT_CLIENT_PRIORITY_CONTROL = 0, ///< init, connect, subscribe, unsubscribe, disconnect, deinit
+  SL_MQTT_CLIENT_PRIORITY_PUBLISH,     ///< publish
+  SL_MQTT_CLIENT_PRIORITY_COUNT
+} sl_mqtt_client_command_priority_t;
+
+/**
+ * Per class submission statistics. Waits are submission until completion event.
+ */
+typedef struct {
+  uint32_t submitted;    ///< Commands handed to the driver
+  uint32_t completed;    ///< Completions matched to a tracked submission
+  uint32_t deferred;     ///< Publishes refused with SL_STATUS_BUSY
+  uint32_t in_flight;    ///< Tracked submissions without completion
+  uint32_t total_wait_ms;
+  uint32_t max_wait_ms;
+} sl_mqtt_client_command_stats_t;
+
+/**
+ * What caused a client state transition.
+ */
+typedef enum {
+  SL_MQTT_CLIENT_TRIGGER_CONNECT = 0,   ///< sl_mqtt_client_connect()
+  SL_MQTT_CLIENT_TRIGGER_DISCONNECT,    ///< sl_mqtt_client_disconnect()
+  SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT ///< Asynchronous response or event from the firmware
+} sl_mqtt_client_trigger_t;
+
+/**
+ * One recorded client state transition.
+ */
+typedef struct {
+  uint32_t timestamp_ms; ///< Kernel time of the transition
+  uint8_t from_state;    ///< sl_mqtt_client_connection_state_t
+  uint8_t to_state;      ///< sl_mqtt_client_connection_state_t
+  uint8_t trigger;       ///< sl_mqtt_client_trigger_t
+  uint8_t is_expected;   ///< 0 if the transition is not in the state machine table
+} sl_mqtt_client_state_trace_t;
+
+/**
+ * Where the time of the last connect went. Phases not reached yet read 0.
+ */
+typedef struct {
+  uint32_t firmware_init_ms;     ///< connect() call until the firmware accepted MQTT init
+  uint32_t transport_connack_ms; ///< TCP/TLS setup plus CONNACK, one firmware command so not separable on the host
+  uint32_t first_suback_ms;      ///< CONNACK until the first SUBACK
+  uint32_t total_ms;             ///< connect() call until the last phase reached
+} sl_mqtt_client_connect_latency_t;
+
+sl_status_t sl_mqtt_client_set_loopback_policy(sl_mqtt_client_t *client, sl_mqtt_client_loopback_policy_t policy);
+
+/**
+ * Copy the most recent state transitions, newest first.
+ * @return Number of records copied.
+ */
+uint32_t sl_mqtt_client_get_state_trace(sl_mqtt_client_state_trace_t *records, uint32_t max_records);
+
+sl_status_t sl_mqtt_client_get_connect_latency(sl_mqtt_client_connect_latency_t *latency);
+
+/**
+ * Keep a received message, topic and content included, valid after the message handler returns.
+ * Safe to call from any task, every successful retain needs one sl_mqtt_client_message_release().
+ * @param message  Message passed to a sl_mqtt_client_message_received_t handler.
+ * @return The same message, or NULL if it is not pool backed (pool exhausted or message too large),
+ *         in which case the handler has to copy what it needs.
+ */
+sl_mqtt_client_message_t *sl_mqtt_client_message_retain(sl_mqtt_client_message_t *message);
+
+void sl_mqtt_client_message_release(sl_mqtt_client_message_t *message);
+
+sl_status_t sl_mqtt_client_get_command_stats(sl_mqtt_client_command_priority_t priority,
+                                             sl_mqtt_client_command_stats_t *stats);
+
+#endif /* AMPAK_WL72917_SL_MQTT_CLIENT_EXT_H_ */
@@ -32,6 +32,7 @@
 #include "sl_net.h"
 #include "sl_utility.h"
 #include "cmsis_os2.h"
+#include "FreeRTOS.h"
 #include "sl_constants.h"
 #include "sl_mqtt_client.h"
 #include "cacert.pem.h"
@@ -40,12 +41,33 @@
 #include "app.h"
 #include "ampak_wl72917/ampak_util.h"
 #include "ampak_wl72917/ble_config.h"
+#include "ampak_wl72917/mqtt_keepalive.h"
+#include "ampak_wl72917/mqtt_publish_queue.h"
+#include "ampak_wl72917/mqtt_link_policy.h"
+#include "ampak_wl72917/mqtt_power_gate.h"
+#include "ampak_wl72917/mqtt_command.h"
+#include "ampak_wl72917/ampak_fmt.h"
+#include "ampak_wl72917/mqtt_dedup.h"
+#include "ampak_wl72917/mqtt_retained_cache.h"
+#include "ampak_wl72917/sl_mqtt_client_ext.h"
+#include "ampak_wl72917/app_reactor.h"
+#include "ampak_wl72917/app_timer_wheel.h"
+#include "ampak_wl72917/boot_timeline.h"
+#include "ampak_wl72917/app_startup.h"
+#include "ampak_wl72917/provision_cache.h"
+#include "ampak_wl72917/mqtt_tls_session.h"
+#include "ampak_wl72917/mqtt_broker_list.h"
+#include "ampak_wl72917/mqtt_rpc.h"
+#include "ampak_wl72917/mqtt_ota.h"
+#include "ampak_wl72917/app_metrics.h"
+#include "ampak_wl72917/os_log_task.h"
 /******************************************************
  *                    Constants
  ******************************************************/
 #define AMPAK_USE_BLE 1
 
 
+// Broker endpoints go in mqtt_broker_endpoints[], host names or IPv4 literals.
 #define MQTT_BROKER_IP   "10.10.28.233"
 #define MQTT_BROKER_PORT 1883
 
@@ -55,16 +77,34 @@
 
 #define TOPIC_TO_BE_SUBSCRIBED "Ampak/917/command"
 #define QOS_OF_SUBSCRIPTION    SL_MQTT_QOS_LEVEL_1
+// Commands waiting for mqtt_task; each holds a receive buffer, so more could not be retained anyway.
+#define MQTT_COMMAND_QUEUE_SLOTS SL_MQTT_CLIENT_RX_BUFFER_COUNT
+
+#define CONFIG_TOPIC "Ampak/917/config"
+
+// Per device RPC, "<prefix><mac>/request" in and "<prefix><mac>/response" out, see mqtt_rpc.h.
+#define RPC_TOPIC_PREFIX "Ampak/917/rpc/"
+#define RPC_TOPIC_SIZE   64
+
+// Per device OTA, frames in on "<prefix><mac>/chunk", acks out on "<prefix><mac>/status", see mqtt_ota.h.
+#define OTA_TOPIC_PREFIX "Ampak/917/ota/"
+#define OTA_TOPIC_SIZE   64
 
 #define PUBLISH_TOPIC          "Ampak/917/report"
 #define PUBLISH_MESSAGE        "I am alive."
 #define QOS_OF_PUBLISH_MESSAGE SL_MQTT_QOS_LEVEL_1
+#define PUBLISH_MESSAGE_TTL_MS 60000
+// Critical messages keep QOS_OF_PUBLISH_MESSAGE on a poor link, others may drop to QoS 0.
+#define PUBLISH_MESSAGE_IS_CRITICAL 0
+
+#define MQTT_LOOPBACK_POLICY SL_MQTT_CLIENT_LOOPBACK_DISABLED
 
 #define IS_DUPLICATE_MESSAGE 0
 #define IS_MESSAGE_RETAINED  1
 #define IS_CLEAN_SESSION     1
 
 #define LAST_WILL_TOPIC       "Ampak/917/dismiss"
+#define LAST_WILL_TOPIC_SIZE  200 // with "/<mac>" appended
 #define LAST_WILL_MESSAGE     "disconnect"
 #define QOS_OF_LAST_WILL      SL_MQTT_QOS_LEVEL_1
 #define IS_LAST_WILL_RETAINED 1
@@ -74,11 +114,41 @@
 #define MQTT_CONNECT_TIMEOUT   5000
 #define MQTT_KEEPALIVE_RETRIES 20
 
+// Reconnect after a drop we did not ask for, doubling per drop that did not get a session back.
+#define MQTT_RECONNECT_MIN_MS 1000U
+#define MQTT_RECONNECT_MAX_MS 60000U
+
 #define SEND_CREDENTIALS 1
 
 #define USERNAME "mqttusr"
 #define PASSWORD "88888888"
 
+// Events run by mqtt_task through the reactor, one flag bit each.
+#define APP_EVENT_MQTT_CONNECTED (1UL << 0)
+#define APP_EVENT_MQTT_COMMAND   (1UL << 1)
+#define APP_EVENT_MQTT_CLEANUP   (1UL << 2)
+#define APP_EVENT_BOOT_TIMELINE  (1UL << 3)
+#define APP_EVENT_MQTT_FAILOVER  (1UL << 4)
+#define APP_EVENT_MQTT_RPC       (1UL << 5)
+#define APP_EVENT_MQTT_DROPPED   (1UL << 6)
+
+// Startup breakdown, retained so the last one is there for whoever subscribes later.
+#define BOOT_TIMELINE_TOPIC "Ampak/917/diag/boot"
+
+// CBOR metrics snapshot on "Ampak/917/diag/<mac>/metrics", id -> name schema on ".../schema".
+#define METRICS_TOPIC_PREFIX "Ampak/917/diag/"
+#define METRICS_TOPIC_SIZE   64
+#define METRICS_PERIOD_MS    300000
+#define METRICS_PHASE_MS     20000 // away from the housekeeping printout
+#define QOS_OF_METRICS       SL_MQTT_QOS_LEVEL_0
+
+// Periodic jobs on the timer wheel, ms. Periods share an epoch so related jobs wake together.
+#define SAMPLE_PERIOD_MS       10000
+#define REPORT_PERIOD_MS       60000
+#define REPORT_JITTER_MS       2000 // spreads a fleet that booted together
+#define HOUSEKEEPING_PERIOD_MS 600000
+#define HOUSEKEEPING_PHASE_MS  5000
+
 /******************************************************
  *               Variable Definitions
  ******************************************************/
@@ -95,6 +165,18 @@ const osThreadAttr_t mqtt_thread_attributes = {
   .reserved   = 0,
 };
 
+const osThreadAttr_t mqtt_io_thread_attributes = {
+  .name       = "mqtt_io",
+  .attr_bits  = 0,
+  .cb_mem     = 0,
+  .cb_size    = 0,
+  .stack_mem  = 0,
+  .stack_size = 1536,
+  .priority   = osPriorityBelowNormal,
+  .tz_module  = 0,
+  .reserved   = 0,
+};
+
 #if AMPAK_USE_DEFAULT_DEVICE_CONFIG
 static const sl_wifi_device_configuration_t wifi_mqtt_client_configuration =
 {
@@ -227,11 +309,81 @@ static const sl_wifi_device_configuration_t wifi_mqtt_client_configuration =
 
 sl_mqtt_client_t client = { 0 };
 
-uint8_t is_execution_completed = 0;
+// Received commands waiting for mqtt_task, as messages retained from the client's receive pool.
+osMessageQueueId_t mqtt_command_queue = NULL;
+
+// Completion context of a publish. The window keeps at most SL_MQTT_CLIENT_PUBLISH_WINDOW in flight,
+// so a record is long completed by the time the ring comes back to it.
+#define MQTT_PUBLISH_CONTEXT_SLOTS (2 * SL_MQTT_CLIENT_PUBLISH_WINDOW)
+typedef struct {
+  const char *topic;
+  uint8_t qos_level;
+} mqtt_publish_context_t;
+mqtt_publish_context_t mqtt_publish_contexts[MQTT_PUBLISH_CONTEXT_SLOTS];
+uint32_t mqtt_publish_context_next = 0;
+
+app_timer_job_t sample_job;
+app_timer_job_t report_job;
+app_timer_job_t housekeeping_job;
+app_timer_job_t failover_job;
+app_timer_job_t metrics_job;
+
+// RSSI seen by the sample job since the last report.
+int32_t sample_rssi_sum = 0;
+int32_t sample_rssi_min = 0;
+int32_t sample_rssi_max = 0;
+uint32_t sample_count   = 0;
+
+// Username is the MAC; static so bring-up does not touch the heap.
+union {
+  sl_mqtt_client_credentials_t header;
+  uint8_t raw[sizeof(sl_mqtt_client_credentials_t) + AMPAK_FMT_MAC_SIZE + sizeof(PASSWORD)];
+} mqtt_credential_blob;
+
+sl_mqtt_client_credentials_t *client_credentails = &mqtt_credential_blob.header;
+
+char mac_for_id[AMPAK_FMT_MAC_SIZE] = {0};
+
+char rpc_request_topic[RPC_TOPIC_SIZE]  = {0};
+char rpc_response_topic[RPC_TOPIC_SIZE] = {0};
+
+char ota_chunk_topic[OTA_TOPIC_SIZE]  = {0};
+char ota_status_topic[OTA_TOPIC_SIZE] = {0};
+
+char metrics_topic[METRICS_TOPIC_SIZE]        = {0};
+char metrics_schema_topic[METRICS_TOPIC_SIZE] = {0};
+
+// MQTT operations by type and result, counted from the client callbacks.
+enum {
+  MQTT_METRIC_CONNECT_OK = 0,
+  MQTT_METRIC_CONNECT_FAILED,
+  MQTT_METRIC_RECONNECT,
+  MQTT_METRIC_DISCONNECT,
+  MQTT_METRIC_PUBLISH_OK,
+  MQTT_METRIC_PUBLISH_FAILED,
+  MQTT_METRIC_SUBSCRIBE_OK,
+  MQTT_METRIC_SUBSCRIBE_FAILED,
+  MQTT_METRIC_COUNT,
+};
+
+const char *const mqtt_metric_names[MQTT_METRIC_COUNT] = {
+  [MQTT_METRIC_CONNECT_OK]       = "con.ok", // first connect after boot
+  [MQTT_METRIC_CONNECT_FAILED]   = "con.err",
+  [MQTT_METRIC_RECONNECT]        = "recon",
+  [MQTT_METRIC_DISCONNECT]       = "disc",
+  [MQTT_METRIC_PUBLISH_OK]       = "pub.ok",
+  [MQTT_METRIC_PUBLISH_FAILED]   = "pub.err",
+  [MQTT_METRIC_SUBSCRIBE_OK]     = "sub.ok",
+  [MQTT_METRIC_SUBSCRIBE_FAILED] = "sub.err",
+};
 
-sl_mqtt_client_credentials_t *client_credentails = NULL;
+app_metric_id_t mqtt_metric_ids[MQTT_METRIC_COUNT];
+bool mqtt_connected_once = false;
 
-char mac_for_id[13] = {0};
+bool mqtt_disconnect_requested = false;
+uint32_t mqtt_reconnect_delay_ms = MQTT_RECONNECT_MIN_MS;
+// Set while a failed connect is torn down; the DISCONNECTED event then moves on to the next broker.
+volatile bool mqtt_failover_pending = false;
 
 sl_mqtt_client_configuration_t mqtt_client_configuration = { .is_clean_session = IS_CLEAN_SESSION,
                                                              .client_id        = (uint8_t *)CLIENT_ID,
@@ -246,16 +398,6 @@ sl_mqtt_broker_t mqtt_broker_configuration = {
   .keep_alive_retries      = MQTT_KEEPALIVE_RETRIES,
 };
 
-sl_mqtt_client_message_t message_to_be_published = {
-  .qos_level            = QOS_OF_PUBLISH_MESSAGE,
-  .is_retained          = IS_MESSAGE_RETAINED,
-  .is_duplicate_message = IS_DUPLICATE_MESSAGE,
-  .topic                = (uint8_t *)PUBLISH_TOPIC,
-  .topic_length         = strlen(PUBLISH_TOPIC),
-  .content              = (uint8_t *)PUBLISH_MESSAGE,
-  .content_length       = strlen(PUBLISH_MESSAGE),
-};
-
 sl_mqtt_client_last_will_message_t last_will_message = {
   .is_retained         = IS_LAST_WILL_RETAINED,
   .will_qos_level      = QOS_OF_LAST_WILL,
@@ -269,15 +411,103 @@ sl_mqtt_client_last_will_message_t last_will_message = {
  *               Function Declarations
  ******************************************************/
 void mqtt_client_message_handler(void *client, sl_mqtt_client_message_t *message, void *context);
+void mqtt_config_message_handler(void *client, sl_mqtt_client_message_t *message, void *context);
+void mqtt_rpc_message_handler(void *client, sl_mqtt_client_message_t *message, void *context);
+void mqtt_ota_message_handler(void *client, sl_mqtt_client_message_t *message, void *context);
 void mqtt_client_event_handler(void *client, sl_mqtt_client_event_t event, void *event_data, void *context);
-void mqtt_client_error_event_handler(void *client, sl_mqtt_client_error_status_t *error);
+void mqtt_client_error_event_handler(void *client, sl_mqtt_client_error_status_t *error, void *context);
 void mqtt_client_cleanup();
 void print_char_buffer(char *buffer, uint32_t buffer_length);
+sl_status_t mqtt_command_http_get(const mqtt_command_args_t *args,
+                                  char *reply,
+                                  uint32_t reply_size,
+                                  uint32_t *reply_length);
+sl_status_t mqtt_command_ping(const mqtt_command_args_t *args,
+                              char *reply,
+                              uint32_t reply_size,
+                              uint32_t *reply_length);
+sl_status_t mqtt_command_link(const mqtt_command_args_t *args,
+                              char *reply,
+                              uint32_t reply_size,
+                              uint32_t *reply_length);
 sl_status_t mqtt_client_setup();
+sl_status_t mqtt_net_init(void);
 sl_status_t mqtt_net_up(void);
+sl_status_t mqtt_setup_mac(void);
+sl_status_t mqtt_setup_manifest(void);
+sl_status_t mqtt_setup_tls_cert(void);
+sl_status_t mqtt_setup_credential(void);
+sl_status_t mqtt_setup_client_init(void);
+sl_status_t mqtt_setup_broker_addr(void);
+sl_status_t mqtt_setup_connect(void);
+void mqtt_on_connected(void *context);
+void mqtt_on_command(void *context);
+void mqtt_on_cleanup(void *context);
+void mqtt_on_rpc(void *context);
+void boot_timeline_report(void *context);
+void sample_job_handler(void *context);
+void report_job_handler(void *context);
+void housekeeping_job_handler(void *context);
+void mqtt_on_failover(void *context);
+void mqtt_on_dropped(void *context);
+void mqtt_reconnect(void *context);
+void mqtt_connect_failed(void);
+void metrics_init(void);
+void metrics_job_handler(void *context);
+void metrics_publish_schema(void);
+int32_t metrics_read_heap_free(void);
+int32_t metrics_read_heap_min(void);
+int32_t metrics_read_wakes(void);
+int32_t metrics_read_log_depth(void);
+int32_t metrics_read_log_drops(void);
 
 
 osSemaphoreId_t mqtt_sem;
+osThreadId_t mqtt_io_thread_id = NULL;
+
+// Bring-up graph run by mqtt_client_setup(); a step may only depend on steps listed before it.
+// Without AMPAK_NOT_NET_UP the network steps are no-ops, Wi-Fi is brought up elsewhere.
+enum {
+  STARTUP_NET_INIT = 0,
+  STARTUP_NET_UP,
+  STARTUP_MAC,
+  STARTUP_MANIFEST,
+  STARTUP_TLS_CERT,
+  STARTUP_CREDENTIAL,
+  STARTUP_CLIENT_INIT,
+  STARTUP_BROKER_ADDR,
+  STARTUP_CONNECT,
+};
+
+const app_startup_step_t mqtt_startup_steps[] = {
+  [STARTUP_NET_INIT]    = { .name = "net_init", .run = mqtt_net_init, .depends = 0 },
+  [STARTUP_NET_UP]      = { .name = "net_up", .run = mqtt_net_up, .depends = APP_STARTUP_STEP(STARTUP_NET_INIT) },
+  [STARTUP_MAC]         = { .name = "mac", .run = mqtt_setup_mac, .depends = APP_STARTUP_STEP(STARTUP_NET_INIT) },
+  [STARTUP_MANIFEST]    = { .name = "manifest", .run = mqtt_setup_manifest, .depends = APP_STARTUP_STEP(STARTUP_NET_INIT) },
+  [STARTUP_TLS_CERT]    = { .name = "tls_cert", .run = mqtt_setup_tls_cert, .depends = APP_STARTUP_STEP(STARTUP_MANIFEST) },
+  [STARTUP_CREDENTIAL]  = { .name = "credential",
+                            .run  = mqtt_setup_credential,
+                            .depends = APP_STARTUP_STEP(STARTUP_MAC) | APP_STARTUP_STEP(STARTUP_MANIFEST) },
+  [STARTUP_CLIENT_INIT] = { .name = "client_init", .run = mqtt_setup_client_init, .depends = APP_STARTUP_STEP(STARTUP_NET_INIT) },
+  [STARTUP_BROKER_ADDR] = { .name = "broker_addr", .run = mqtt_setup_broker_addr, .depends = APP_STARTUP_STEP(STARTUP_NET_UP) },
+  [STARTUP_CONNECT]     = { .name = "connect",
+                            .run  = mqtt_setup_connect,
+                            .depends = APP_STARTUP_STEP(STARTUP_NET_UP) | APP_STARTUP_STEP(STARTUP_MAC)
+                                       | APP_STARTUP_STEP(STARTUP_TLS_CERT) | APP_STARTUP_STEP(STARTUP_CREDENTIAL)
+                                       | APP_STARTUP_STEP(STARTUP_CLIENT_INIT) | APP_STARTUP_STEP(STARTUP_BROKER_ADDR) },
+};
+
+// Tried fastest first by measured connect latency; on a failed connect the next one takes over.
+const mqtt_broker_endpoint_t mqtt_broker_endpoints[] = {
+  { .host = MQTT_BROKER_IP, .port = MQTT_BROKER_PORT },
+};
+
+// Commands accepted on TOPIC_TO_BE_SUBSCRIBED, "<verb>[ <argument>]".
+const mqtt_command_t mqtt_commands[] = {
+  { .name = "http_get", .args = mqtt_command_args_none, .reply = mqtt_command_reply_result, .handler = mqtt_command_http_get },
+  { .name = "ping", .args = mqtt_command_args_none, .reply = mqtt_command_reply_ack, .handler = mqtt_command_ping },
+  { .name = "link", .args = mqtt_command_args_none, .reply = mqtt_command_reply_result, .handler = mqtt_command_link },
+};
 
 
 /******************************************************
@@ -285,33 +515,132 @@ osSemaphoreId_t mqtt_sem;
  ******************************************************/
 void mqtt_publish_message_api(char* message)
 {
-  if(client.state == SL_MQTT_CLIENT_DISCONNECTED)
-  {
-    printf("MQTT not connected yet.\r\n");
+  sl_status_t status;
+
+  char message_append_mac[MQTT_PUBLISH_PAYLOAD_SIZE];
+  ampak_fmt_t fmt;
+
+  ampak_fmt_init(&fmt, message_append_mac, sizeof(message_append_mac));
+  ampak_fmt_str(ampak_fmt_lit(ampak_fmt_str(&fmt, message), " : "), mac_for_id);
+  if (!ampak_fmt_ok(&fmt)) {
+    printf("Publish message too long\r\n");
     return;
   }
+
+  // Only mqtt_io_task talks to the client, publishers just queue.
+  // While offline the message is held, and dropped if still unsent after its TTL.
+  status = mqtt_publish_queue_push(PUBLISH_TOPIC,
+                                   (uint8_t *)message_append_mac,
+                                   (uint16_t)ampak_fmt_length(&fmt),
+                                   QOS_OF_PUBLISH_MESSAGE,
+                                   IS_MESSAGE_RETAINED,
+                                   PUBLISH_MESSAGE_IS_CRITICAL,
+                                   PUBLISH_MESSAGE_TTL_MS);
+  if (status != SL_STATUS_OK) {
+    printf("Failed to queue message: 0x%lx\r\n", status);
+  }
+}
+
+void mqtt_io_task(void *argument)
+{
+  UNUSED_PARAMETER(argument);
   sl_status_t status;
+  sl_mqtt_client_message_t message = {
+    .is_duplicate_message = IS_DUPLICATE_MESSAGE,
+  };
 
-  static char message_append_mac[200] = {0};
-  memset(message_append_mac, 0, 200);
+  uint32_t batch_wait = osWaitForever;
 
-  sprintf(message_append_mac, "%s : %s",message, mac_for_id);
-  message_to_be_published.content = (uint8_t *) message_append_mac;
-  message_to_be_published.content_length = strlen(message_append_mac);
-  status = sl_mqtt_client_publish(&client, &message_to_be_published, 0, &message_to_be_published);
-  if (status != SL_STATUS_IN_PROGRESS)
-  {
-    printf("Failed to publish message: 0x%lx\r\n", status);
+  while (1) {
+    uint32_t timeout = batch_wait;
+    uint32_t expiry_tick;
+    uint32_t oldest_tick;
+
+    // Offline, sleep until new work or until the first queued message expires and its slot can be freed.
+    if (client.state != SL_MQTT_CLIENT_CONNECTED && mqtt_publish_queue_earliest_expiry(&expiry_tick)) {
+      int32_t remaining = (int32_t)(expiry_tick - osKernelGetTickCount());
+      timeout           = (remaining > 0) ? (uint32_t)remaining : 1U;
+    }
+    osThreadFlagsWait(MQTT_PUBLISH_QUEUE_FLAG, osFlagsWaitAny, timeout);
+    batch_wait = osWaitForever;
+
+    uint32_t expired = mqtt_publish_queue_purge_expired();
+    if (expired != 0) {
+      printf("Dropped %lu expired messages\r\n", expired);
+    }
+
+    if (client.state != SL_MQTT_CLIENT_CONNECTED) {
+      continue;
+    }
+
+    // On a weak link, let publishes pile up and send them in one burst.
+    mqtt_link_policy_sample();
+    uint32_t depth = mqtt_publish_queue_depth(&oldest_tick);
+    if (!mqtt_link_policy_flush_due(depth, oldest_tick, &batch_wait)) {
+      continue;
+    }
+
+    // In power save, hold them for the next radio wake unless one is critical or would expire first.
+    bool has_deadline = mqtt_publish_queue_earliest_expiry(&expiry_tick);
+    if (!mqtt_power_gate_flush_due(depth,
+                                   oldest_tick,
+                                   mqtt_publish_queue_has_critical(),
+                                   has_deadline ? &expiry_tick : NULL,
+                                   &batch_wait)) {
+      continue;
+    }
+
+    mqtt_publish_item_t *item;
+    uint32_t sent = 0;
+    while (client.state == SL_MQTT_CLIENT_CONNECTED && (item = mqtt_publish_queue_front()) != NULL) {
+      message.qos_level      = mqtt_link_policy_qos(item->qos_level, item->is_critical);
+      message.is_retained    = item->is_retained;
+      message.topic          = (uint8_t *)item->topic;
+      message.topic_length   = item->topic_length;
+      message.content        = item->content;
+      message.content_length = item->content_length;
+
+      // The client copies the payload, so the slot can go back right away.
+      // The topic outlives the request; it and the QoS sent make the completion context.
+      mqtt_publish_context_t *publish_context =
+        &mqtt_publish_contexts[mqtt_publish_context_next++ % MQTT_PUBLISH_CONTEXT_SLOTS];
+      publish_context->topic     = item->topic;
+      publish_context->qos_level = message.qos_level;
+      status = sl_mqtt_client_publish(&client, &message, 0, publish_context);
+      if (status == SL_STATUS_INVALID_STATE) {
+        break; // link went down under us, keep the message for the next connection
+      }
+      if (status == SL_STATUS_BUSY) {
+        // Control command or full publish window ahead, retried on the next completion. A completion that
+        // never comes stops counting after SL_MQTT_CLIENT_INFLIGHT_STALE_MS, so retry then at the latest.
+        uint32_t stale_wait = (SL_MQTT_CLIENT_INFLIGHT_STALE_MS * osKernelGetTickFreq()) / 1000U;
+        if (batch_wait > stale_wait) {
+          batch_wait = stale_wait;
+        }
+        break;
+      }
+      mqtt_publish_queue_pop();
+      if (status != SL_STATUS_IN_PROGRESS) {
+        printf("Failed to publish message: 0x%lx\r\n", status);
+        if (message.qos_level != SL_MQTT_QOS_LEVEL_0) {
+          mqtt_link_policy_on_publish_result(false);
+        }
 #if AMPAK_USE_FUNC_MQTT_CLIENT_CLEANUP
-    mqtt_client_cleanup();
+        mqtt_client_cleanup();
 #endif
-    return;
+        continue;
+      }
+      mqtt_keepalive_on_publish_sent(message.qos_level);
+      sent++;
+    }
+    mqtt_power_gate_on_flushed(sent);
   }
 }
 
 
-sl_status_t mqtt_net_up(void)
+sl_status_t mqtt_net_init(void)
 {
+#if AMPAK_NOT_NET_UP
   sl_status_t status;
 
   status = sl_net_init(SL_NET_WIFI_CLIENT_INTERFACE, &wifi_mqtt_client_configuration, NULL, NULL);
@@ -319,23 +648,81 @@ sl_status_t mqtt_net_up(void)
     printf("Failed to start Wi-Fi client interface: 0x%lx\r\n", status);
     return status;
   }
+  boot_timeline_mark(boot_timeline_net_init);
   printf("\r\nWi-Fi client interface up Success\r\n");
+#endif
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_net_up(void)
+{
+#if AMPAK_NOT_NET_UP
+  sl_status_t status;
 
   status = sl_net_up(SL_NET_WIFI_CLIENT_INTERFACE, SL_NET_DEFAULT_WIFI_CLIENT_PROFILE_ID);
   if (status != SL_STATUS_OK) {
     printf("Failed to bring Wi-Fi client interface up: 0x%lx\r\n", status);
     return status;
   }
+  boot_timeline_mark(boot_timeline_net_up);
   printf("Wi-Fi client connected\r\n");
-  return status;
+#endif
+  return SL_STATUS_OK;
 }
 
 void mqtt_init(void)
 {
+  boot_timeline_mark(boot_timeline_mqtt_init);
+  metrics_init();
   mqtt_sem = osSemaphoreNew(1,0,NULL);
   if (mqtt_sem == NULL){
       printf("Fail to new sem\r\n");
   }
+  mqtt_command_queue = osMessageQueueNew(MQTT_COMMAND_QUEUE_SLOTS, sizeof(sl_mqtt_client_message_t *), NULL);
+  if (mqtt_command_queue == NULL) {
+      printf("Fail to new command queue\r\n");
+  }
+  if (app_reactor_init() == SL_STATUS_OK) {
+    app_reactor_register(APP_EVENT_MQTT_CONNECTED, mqtt_on_connected, &client);
+    app_reactor_register(APP_EVENT_MQTT_COMMAND, mqtt_on_command, NULL);
+    app_reactor_register(APP_EVENT_MQTT_CLEANUP, mqtt_on_cleanup, NULL);
+    app_reactor_register(APP_EVENT_BOOT_TIMELINE, boot_timeline_report, NULL);
+    app_reactor_register(APP_EVENT_MQTT_FAILOVER, mqtt_on_failover, NULL);
+    app_reactor_register(APP_EVENT_MQTT_RPC, mqtt_on_rpc, NULL);
+    app_reactor_register(APP_EVENT_MQTT_DROPPED, mqtt_on_dropped, NULL);
+  }
+  app_timer_wheel_init();
+  app_reactor_set_deadline(app_timer_wheel_next_wait, app_timer_wheel_run, NULL);
+  app_timer_job_init(&sample_job, "sample", sample_job_handler, NULL);
+  app_timer_job_init(&report_job, "report", report_job_handler, NULL);
+  app_timer_job_init(&housekeeping_job, "housekeeping", housekeeping_job_handler, NULL);
+  app_timer_job_init(&failover_job, "failover", mqtt_reconnect, NULL);
+  app_timer_job_init(&metrics_job, "metrics", metrics_job_handler, NULL);
+  app_timer_job_start(&sample_job, SAMPLE_PERIOD_MS, 0, 0);
+  app_timer_job_start(&report_job, REPORT_PERIOD_MS, 0, REPORT_JITTER_MS);
+  app_timer_job_start(&housekeeping_job, HOUSEKEEPING_PERIOD_MS, HOUSEKEEPING_PHASE_MS, 0);
+  app_timer_job_start(&metrics_job, METRICS_PERIOD_MS, METRICS_PHASE_MS, 0);
+  mqtt_keepalive_init(KEEP_ALIVE_INTERVAL, MQTT_KEEPALIVE_RETRIES);
+  mqtt_link_policy_init();
+  mqtt_power_gate_init();
+  if (mqtt_broker_list_init(mqtt_broker_endpoints, sizeof(mqtt_broker_endpoints) / sizeof(mqtt_broker_endpoints[0]))
+      != SL_STATUS_OK) {
+      printf("Fail to init broker list\r\n");
+  }
+  for (uint32_t i = 0; i < sizeof(mqtt_commands) / sizeof(mqtt_commands[0]); i++) {
+    if (mqtt_command_register(&mqtt_commands[i]) != SL_STATUS_OK) {
+      printf("Fail to register command %s\r\n", mqtt_commands[i].name);
+    }
+  }
+  mqtt_command_build();
+  if (mqtt_retained_cache_register(CONFIG_TOPIC) != SL_STATUS_OK) {
+      printf("Fail to register config cache\r\n");
+  }
+  mqtt_io_thread_id = osThreadNew((osThreadFunc_t)mqtt_io_task, NULL, &mqtt_io_thread_attributes);
+  if (mqtt_io_thread_id == NULL) {
+      printf("Fail to new mqtt io thread\r\n");
+  }
+  mqtt_publish_queue_init(mqtt_io_thread_id);
   osThreadNew((osThreadFunc_t)mqtt_task, NULL, &mqtt_thread_attributes);
 
 
@@ -344,23 +731,404 @@ void mqtt_init(void)
 void mqtt_task(void *argument)
 {
   UNUSED_PARAMETER(argument);
-#if AMPAK_NOT_NET_UP
-  mqtt_net_up();
-#endif
   mqtt_client_setup();
-  //sl_status_t status;
-  while (1) {
-      //printf("Come in task\r\n");
-      //osSemaphoreAcquire(mqtt_sem, 5000);
-      //printf(".");
 
-  }
+  // Everything after setup arrives as an event; block until there is one.
+  app_reactor_run();
 }
 
 void mqtt_client_cleanup()
 {
-  SL_CLEANUP_MALLOC(client_credentails);
-  is_execution_completed = 1;
+  app_reactor_post(APP_EVENT_MQTT_CLEANUP);
+}
+
+void mqtt_on_cleanup(void *context)
+{
+  UNUSED_PARAMETER(context);
+  printf("Example execution completed \r\n");
+}
+
+void mqtt_on_failover(void *context)
+{
+  UNUSED_PARAMETER(context);
+  uint32_t delay = mqtt_broker_list_retry_delay_ms();
+
+  // Straight to the next endpoint if one is not backing off, else wait for the first that is done.
+  if (delay == 0) {
+    mqtt_reconnect(NULL);
+    return;
+  }
+  printf("All brokers backing off, retry in %lu ms\r\n", delay);
+  app_timer_job_start_once(&failover_job, delay);
+}
+
+// The session dropped on its own, e.g. an idle NAT mapping expired. Reconnecting also applies the
+// keep alive interval learned from it, mqtt_setup_broker_addr() picks that up.
+void mqtt_on_dropped(void *context)
+{
+  UNUSED_PARAMETER(context);
+  uint32_t delay = mqtt_reconnect_delay_ms;
+
+  mqtt_reconnect_delay_ms = (delay >= MQTT_RECONNECT_MAX_MS / 2U) ? MQTT_RECONNECT_MAX_MS : delay * 2U;
+  printf("Reconnect in %lu ms\r\n", delay);
+  app_timer_job_start_once(&failover_job, delay);
+}
+
+// The firmware client only takes a new connect once a failed one was disconnected and deinited too.
+void mqtt_connect_failed(void)
+{
+  app_metrics_add(mqtt_metric_ids[MQTT_METRIC_CONNECT_FAILED], 1);
+  mqtt_keepalive_on_connect_failed();
+  mqtt_tls_session_on_connect_failed();
+  mqtt_broker_list_on_connect_failed();
+
+  if (client.state == SL_MQTT_CLIENT_CONNECTION_FAILED) {
+    mqtt_failover_pending = true;
+    if (sl_mqtt_client_disconnect(&client, 0) == SL_STATUS_IN_PROGRESS) {
+      return; // next endpoint once DISCONNECTED is reported
+    }
+    mqtt_failover_pending = false;
+  }
+  app_reactor_post(APP_EVENT_MQTT_FAILOVER); // next endpoint, from mqtt_task
+}
+
+void mqtt_reconnect(void *context)
+{
+  UNUSED_PARAMETER(context);
+
+  if (client.state == SL_MQTT_CLIENT_CONNECTED) {
+    return;
+  }
+  if (mqtt_setup_broker_addr() == SL_STATUS_OK) {
+    mqtt_setup_connect();
+  } else {
+    app_reactor_post(APP_EVENT_MQTT_FAILOVER); // none resolved, all backing off now
+  }
+}
+
+void sample_job_handler(void *context)
+{
+  UNUSED_PARAMETER(context);
+  mqtt_link_status_t link;
+
+  mqtt_link_policy_get_status(&link);
+  if (sample_count == 0 || link.rssi < sample_rssi_min) {
+    sample_rssi_min = link.rssi;
+  }
+  if (sample_count == 0 || link.rssi > sample_rssi_max) {
+    sample_rssi_max = link.rssi;
+  }
+  sample_rssi_sum += link.rssi;
+  sample_count++;
+}
+
+void report_job_handler(void *context)
+{
+  UNUSED_PARAMETER(context);
+  char report[MQTT_PUBLISH_PAYLOAD_SIZE];
+  ampak_fmt_t fmt;
+
+  if (client.state != SL_MQTT_CLIENT_CONNECTED || sample_count == 0) {
+    return;
+  }
+
+  ampak_fmt_init(&fmt, report, sizeof(report));
+  ampak_fmt_i32(ampak_fmt_lit(&fmt, "Report: rssi "), sample_rssi_sum / (int32_t)sample_count);
+  ampak_fmt_i32(ampak_fmt_lit(&fmt, " min "), sample_rssi_min);
+  ampak_fmt_lit(ampak_fmt_i32(ampak_fmt_lit(&fmt, " max "), sample_rssi_max), " dBm");
+  ampak_fmt_u32(ampak_fmt_lit(&fmt, ", samples "), sample_count);
+  sample_rssi_sum = 0;
+  sample_count    = 0;
+  mqtt_publish_message_api(report);
+}
+
+void housekeeping_job_handler(void *context)
+{
+  UNUSED_PARAMETER(context);
+  app_reactor_stats_t reactor;
+  app_timer_wheel_stats_t wheel;
+
+  app_reactor_get_stats(&reactor);
+  app_timer_wheel_get_stats(&wheel);
+  printf("Reactor: %lu wakeups, %lu events, %lu deadlines; wheel: %lu armed, %lu runs, %lu cascades\r\n",
+         reactor.wakeups,
+         reactor.dispatched,
+         reactor.deadlines,
+         wheel.armed,
+         wheel.runs,
+         wheel.cascades);
+  printf("Report job: %lu runs, %lu missed, %lu ms max late\r\n",
+         report_job.runs,
+         report_job.missed,
+         report_job.max_late_ms);
+
+  mqtt_power_gate_stats_t gate;
+  mqtt_power_gate_get_stats(&gate);
+  printf("Power gate: %lu held, %lu windows, %lu piggybacked, %lu bypassed, ~%lu wakeups / %lu mJ saved\r\n",
+         gate.held,
+         gate.windows,
+         gate.piggybacked,
+         gate.bypassed,
+         gate.wakeups_saved,
+         gate.energy_saved_uj / 1000U);
+
+  mqtt_rpc_stats_t rpc;
+  mqtt_rpc_get_stats(&rpc);
+  printf("RPC: %lu received, %lu completed, %lu busy, %lu timed out, %lu max in flight; "
+         "queue p50 %lu p99 %lu ms, service p50 %lu p99 %lu ms\r\n",
+         rpc.received,
+         rpc.completed,
+         rpc.busy,
+         rpc.timed_out,
+         rpc.max_in_flight,
+         mqtt_rpc_histogram_percentile(&rpc.queue_ms, 50),
+         mqtt_rpc_histogram_percentile(&rpc.queue_ms, 99),
+         mqtt_rpc_histogram_percentile(&rpc.service_ms, 50),
+         mqtt_rpc_histogram_percentile(&rpc.service_ms, 99));
+
+  mqtt_ota_status_t ota;
+  mqtt_ota_get_status(&ota);
+  if (ota.state != mqtt_ota_state_idle) {
+    printf("OTA %08lx: state %u, %lu/%lu bytes, %lu chunks, %lu resent, %lu out of window, %lu ms in flash\r\n",
+           ota.image_id,
+           ota.state,
+           ota.committed,
+           ota.image_size,
+           ota.chunks,
+           ota.duplicates,
+           ota.out_of_window,
+           ota.flash_ms);
+  }
+
+  mqtt_broker_status_t brokers[MQTT_BROKER_LIST_MAX_ENDPOINTS];
+  uint32_t broker_count = mqtt_broker_list_get_status(brokers, MQTT_BROKER_LIST_MAX_ENDPOINTS);
+  for (uint32_t i = 0; i < broker_count; i++) {
+    printf("Broker %s%s: %lu ms, %lu connects, %lu failures, %lu lookups\r\n",
+           brokers[i].host,
+           brokers[i].selected ? " (current)" : "",
+           brokers[i].srtt_ms,
+           brokers[i].connects,
+           brokers[i].failures,
+           brokers[i].resolves);
+  }
+
+  if (ENCRYPT_CONNECTION) {
+    mqtt_tls_session_stats_t tls;
+    mqtt_tls_session_get_stats(&tls);
+    printf("TLS: %lu full, %lu resumable (expected), %lu invalidated; max %lu / %lu ms to CONNACK\r\n",
+           tls.connects[mqtt_tls_handshake_full],
+           tls.connects[mqtt_tls_handshake_resumable],
+           tls.invalidated,
+           tls.max_ms[mqtt_tls_handshake_full],
+           tls.max_ms[mqtt_tls_handshake_resumable]);
+  }
+}
+
+void metrics_init(void)
+{
+  for (uint32_t i = 0; i < MQTT_METRIC_COUNT; i++) {
+    app_metrics_register(mqtt_metric_names[i], app_metrics_counter, NULL, &mqtt_metric_ids[i]);
+  }
+  app_metrics_register("heap.free", app_metrics_gauge, metrics_read_heap_free, NULL);
+  app_metrics_register("heap.min", app_metrics_gauge, metrics_read_heap_min, NULL);
+  app_metrics_register("wakes", app_metrics_counter, metrics_read_wakes, NULL);
+  app_metrics_register("log.depth", app_metrics_gauge, metrics_read_log_depth, NULL);
+  app_metrics_register("log.drop", app_metrics_counter, metrics_read_log_drops, NULL);
+}
+
+int32_t metrics_read_heap_free(void)
+{
+  return (int32_t)xPortGetFreeHeapSize();
+}
+
+int32_t metrics_read_heap_min(void)
+{
+  return (int32_t)xPortGetMinimumEverFreeHeapSize();
+}
+
+int32_t metrics_read_wakes(void)
+{
+  return (int32_t)ampak_m4_wake_count();
+}
+
+int32_t metrics_read_log_depth(void)
+{
+  return (int32_t)os_log_queue_depth();
+}
+
+int32_t metrics_read_log_drops(void)
+{
+  return (int32_t)os_log_dropped();
+}
+
+// One snapshot, split into as many parts as the publish payload needs; each part decodes on its own.
+void metrics_job_handler(void *context)
+{
+  UNUSED_PARAMETER(context);
+  uint8_t part[MQTT_PUBLISH_PAYLOAD_SIZE];
+  uint32_t first = 0;
+  sl_status_t status;
+
+  if (metrics_topic[0] == '\0') {
+    return; // no MAC yet
+  }
+
+  do {
+    uint32_t length = app_metrics_encode(part, sizeof(part), &first);
+    if (length == 0) {
+      printf("Metric %lu does not fit a publish\r\n", first);
+      return;
+    }
+    // A snapshot still queued when the next one is taken is stale, so it expires with the period.
+    status = mqtt_publish_queue_push(metrics_topic, part, (uint16_t)length, QOS_OF_METRICS, 0, 0, METRICS_PERIOD_MS);
+    if (status != SL_STATUS_OK) {
+      printf("Failed to queue metrics: 0x%lx\r\n", status);
+      return;
+    }
+  } while (first < app_metrics_count());
+}
+
+// Ids follow registration order, fixed for a build; sent once per connect so a backend can label them.
+void metrics_publish_schema(void)
+{
+  uint8_t part[MQTT_PUBLISH_PAYLOAD_SIZE];
+  uint32_t first = 0;
+  sl_status_t status;
+
+  while (first < app_metrics_count()) {
+    uint32_t length = app_metrics_encode_schema(part, sizeof(part), &first);
+    if (length == 0) {
+      return;
+    }
+    status = mqtt_publish_queue_push(metrics_schema_topic,
+                                     part,
+                                     (uint16_t)length,
+                                     QOS_OF_PUBLISH_MESSAGE,
+                                     0,
+                                     0,
+                                     PUBLISH_MESSAGE_TTL_MS);
+    if (status != SL_STATUS_OK) {
+      printf("Failed to queue metrics schema: 0x%lx\r\n", status);
+      return;
+    }
+  }
+}
+
+void boot_timeline_report(void *context)
+{
+  UNUSED_PARAMETER(context);
+  char record[BOOT_TIMELINE_TEXT_SIZE];
+  char timeline[MQTT_PUBLISH_PAYLOAD_SIZE];
+  ampak_fmt_t fmt;
+  sl_status_t status;
+
+  boot_timeline_format(boot_timeline_active(), record, sizeof(record));
+  ampak_fmt_init(&fmt, timeline, sizeof(timeline));
+  ampak_fmt_str(ampak_fmt_char(ampak_fmt_str(&fmt, mac_for_id), ' '), record);
+  printf("Timeline %s\r\n", timeline);
+
+  status = mqtt_publish_queue_push(BOOT_TIMELINE_TOPIC,
+                                   (uint8_t *)timeline,
+                                   (uint16_t)ampak_fmt_length(&fmt),
+                                   QOS_OF_PUBLISH_MESSAGE,
+                                   1,
+                                   0,
+                                   PUBLISH_MESSAGE_TTL_MS);
+  if (status != SL_STATUS_OK) {
+    printf("Failed to queue timeline: 0x%lx\r\n", status);
+  }
+}
+
+void mqtt_on_connected(void *context)
+{
+  sl_mqtt_client_t *mqtt_client = (sl_mqtt_client_t *)context;
+  sl_status_t status;
+
+  if (mqtt_client->state != SL_MQTT_CLIENT_CONNECTED) {
+    return; // dropped again before the event ran
+  }
+
+  status = sl_mqtt_client_subscribe(mqtt_client,
+                                    (uint8_t *)TOPIC_TO_BE_SUBSCRIBED,
+                                    strlen(TOPIC_TO_BE_SUBSCRIBED),
+                                    QOS_OF_SUBSCRIPTION,
+                                    0,
+                                    mqtt_client_message_handler,
+                                    TOPIC_TO_BE_SUBSCRIBED);
+  if (status != SL_STATUS_IN_PROGRESS) {
+    printf("Failed to subscribe : 0x%lx\r\n", status);
+
+    mqtt_client_cleanup();
+    return;
+  }
+
+  status = sl_mqtt_client_subscribe(mqtt_client,
+                                    (uint8_t *)CONFIG_TOPIC,
+                                    strlen(CONFIG_TOPIC),
+                                    QOS_OF_SUBSCRIPTION,
+                                    0,
+                                    mqtt_config_message_handler,
+                                    CONFIG_TOPIC);
+  if (status != SL_STATUS_IN_PROGRESS) {
+    printf("Failed to subscribe : 0x%lx\r\n", status);
+  }
+
+  status = sl_mqtt_client_subscribe(mqtt_client,
+                                    (uint8_t *)rpc_request_topic,
+                                    strlen(rpc_request_topic),
+                                    QOS_OF_SUBSCRIPTION,
+                                    0,
+                                    mqtt_rpc_message_handler,
+                                    rpc_request_topic);
+  if (status != SL_STATUS_IN_PROGRESS) {
+    printf("Failed to subscribe : 0x%lx\r\n", status);
+  }
+
+  status = sl_mqtt_client_subscribe(mqtt_client,
+                                    (uint8_t *)ota_chunk_topic,
+                                    strlen(ota_chunk_topic),
+                                    QOS_OF_SUBSCRIPTION,
+                                    0,
+                                    mqtt_ota_message_handler,
+                                    ota_chunk_topic);
+  if (status != SL_STATUS_IN_PROGRESS) {
+    printf("Failed to subscribe : 0x%lx\r\n", status);
+  }
+  mqtt_ota_on_connected(); // an interrupted download resumes from its last written sector
+  metrics_publish_schema();
+#if 1
+  mqtt_publish_message_api("MQTT connect ok");
+#endif
+}
+
+void mqtt_on_command(void *context)
+{
+  UNUSED_PARAMETER(context);
+  sl_status_t status;
+  static char report[MQTT_PUBLISH_PAYLOAD_SIZE];
+  uint32_t report_length;
+  ampak_fmt_t fmt;
+  sl_mqtt_client_message_t *command;
+
+  while (mqtt_command_queue != NULL && osMessageQueueGet(mqtt_command_queue, &command, NULL, 0) == osOK) {
+    status = mqtt_command_dispatch(command->content, command->content_length, report, sizeof(report), &report_length);
+    if (status == SL_STATUS_NOT_FOUND) {
+      // Not a command, acknowledge the content as before.
+      ampak_fmt_mem(ampak_fmt_lit(ampak_fmt_init(&fmt, report, sizeof(report)), "Ack: "),
+                    command->content,
+                    command->content_length);
+      report_length = ampak_fmt_length(&fmt);
+    } else if (status != SL_STATUS_OK) {
+      ampak_fmt_hex(ampak_fmt_lit(ampak_fmt_init(&fmt, report, sizeof(report)), "Bad command: 0x"), status, 8);
+      report_length = ampak_fmt_length(&fmt);
+    }
+    sl_mqtt_client_message_release(command);
+
+    if (report_length != 0) {
+      report[report_length] = '\0';
+      mqtt_publish_message_api(report);
+    }
+  }
 }
 
 void mqtt_client_message_handler(void *client, sl_mqtt_client_message_t *message, void *context)
@@ -370,39 +1138,168 @@ void mqtt_client_message_handler(void *client, sl_mqtt_client_message_t *message
   UNUSED_PARAMETER(client);
   UNUSED_PARAMETER(status);
 
+  mqtt_keepalive_on_activity();
+  mqtt_power_gate_on_radio_activity();
+
+  if (mqtt_dedup_is_duplicate(message->topic,
+                              message->topic_length,
+                              message->content,
+                              message->content_length,
+                              (uint8_t)message->qos_level,
+                              message->is_duplicate_message != 0)) {
+    printf("Dropped redelivered message\r\n");
+    return;
+  }
+
   printf("Message Received on Topic: ");
   print_char_buffer((char *)message->topic, message->topic_length);
   printf(", Content: ");
   print_char_buffer((char *)message->content , message->content_length);
   printf("\r\n");
 
-  static char report[200] = {0};
-  memset(report, 0, 200);
+  // Commands run in mqtt_task, not in the client callback; retaining keeps the payload valid until then.
+  sl_mqtt_client_message_t *command = sl_mqtt_client_message_retain(message);
+  if (command == NULL) {
+    printf("Command not retainable, dropped\r\n"); // larger than a receive buffer, or all of them held
+    return;
+  }
+  if (mqtt_command_queue == NULL || osMessageQueuePut(mqtt_command_queue, &command, 0, 0) != osOK) {
+    sl_mqtt_client_message_release(command);
+    printf("Command queue full, dropped\r\n");
+    return;
+  }
+  app_reactor_post(APP_EVENT_MQTT_COMMAND);
+}
 
-  if(strcmp((char *)message->content, "http_get") == 0)
-  {
-    sprintf(report, "Action: %s", (char *)message->content);
-    mqtt_publish_message_api(report);
+void mqtt_rpc_message_handler(void *client, sl_mqtt_client_message_t *message, void *context)
+{
+  UNUSED_PARAMETER(context);
+  UNUSED_PARAMETER(client);
+
+  mqtt_keepalive_on_activity();
+  mqtt_power_gate_on_radio_activity();
+
+  // No mqtt_dedup here: a request answered "busy" or "timeout" is retried with the same envelope on purpose,
+  // and one still in flight is already ignored by its id.
+  // Up to MQTT_RPC_INFLIGHT_SLOTS requests queue up, each answered on rpc_response_topic by mqtt_task.
+  sl_status_t status = mqtt_rpc_submit(message);
+  if (status == SL_STATUS_OK) {
+    app_reactor_post(APP_EVENT_MQTT_RPC);
+  } else if (status == SL_STATUS_INVALID_PARAMETER) {
+    printf("Malformed rpc request, dropped\r\n");
   }
-  else
-  {
-    strcpy(report, "Ack: ");
-    strncpy(report+strlen("Ack: "), (char *)message->content, message->content_length);
-    mqtt_publish_message_api(report);
+}
+
+void mqtt_ota_message_handler(void *client, sl_mqtt_client_message_t *message, void *context)
+{
+  UNUSED_PARAMETER(context);
+  UNUSED_PARAMETER(client);
+
+  mqtt_keepalive_on_activity();
+  mqtt_power_gate_on_radio_activity();
+
+  // Only copies the chunk, flash writes run on the OTA writer thread. Retaining would not save that copy,
+  // chunks are reassembled into whole sectors and a full chunk is larger than a receive buffer anyway.
+  // Resent chunks are recognised by index, so no dedup here.
+  mqtt_ota_on_message(message->content, message->content_length);
+}
+
+void mqtt_on_rpc(void *context)
+{
+  UNUSED_PARAMETER(context);
+  mqtt_rpc_process();
+}
+
+sl_status_t mqtt_command_http_get(const mqtt_command_args_t *args,
+                                  char *reply,
+                                  uint32_t reply_size,
+                                  uint32_t *reply_length)
+{
+  UNUSED_PARAMETER(args);
+  ampak_fmt_t fmt;
+
+  *reply_length = ampak_fmt_length(ampak_fmt_lit(ampak_fmt_init(&fmt, reply, reply_size), "Action: http_get"));
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_command_ping(const mqtt_command_args_t *args,
+                              char *reply,
+                              uint32_t reply_size,
+                              uint32_t *reply_length)
+{
+  UNUSED_PARAMETER(args);
+  UNUSED_PARAMETER(reply);
+  UNUSED_PARAMETER(reply_size);
+  UNUSED_PARAMETER(reply_length);
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_command_link(const mqtt_command_args_t *args,
+                              char *reply,
+                              uint32_t reply_size,
+                              uint32_t *reply_length)
+{
+  UNUSED_PARAMETER(args);
+  mqtt_link_status_t link;
+  ampak_fmt_t fmt;
+
+  mqtt_link_policy_get_status(&link);
+  ampak_fmt_init(&fmt, reply, reply_size);
+  ampak_fmt_u32(ampak_fmt_lit(&fmt, "Link: quality "), link.quality);
+  ampak_fmt_lit(ampak_fmt_i32(ampak_fmt_lit(&fmt, ", rssi "), link.rssi), " dBm");
+  ampak_fmt_lit(ampak_fmt_u32(ampak_fmt_lit(&fmt, ", loss "), link.loss_percent), "%");
+  ampak_fmt_lit(ampak_fmt_u32(ampak_fmt_lit(&fmt, ", keep alive "), mqtt_keepalive_next_interval()), "s");
+  *reply_length = ampak_fmt_length(&fmt);
+  return SL_STATUS_OK;
+}
+
+void mqtt_config_message_handler(void *client, sl_mqtt_client_message_t *message, void *context)
+{
+  UNUSED_PARAMETER(context);
+  UNUSED_PARAMETER(client);
+
+  mqtt_keepalive_on_activity();
+  mqtt_power_gate_on_radio_activity();
+
+  // The broker replays the retained config on every subscribe; only act on changes.
+  // Readers get the current value with mqtt_retained_cache_read(CONFIG_TOPIC, ...).
+  mqttRetainedCacheResult_t result =
+    mqtt_retained_cache_update(message->topic, message->topic_length, message->content, message->content_length);
+  if (result == mqtt_retained_cache_unchanged) {
+    return;
   }
+
+  printf("Config %s: ", (result == mqtt_retained_cache_changed) ? "updated" : "not cached");
+  print_char_buffer((char *)message->content, message->content_length);
+  printf("\r\n");
 }
 
 void print_char_buffer(char *buffer, uint32_t buffer_length)
 {
-  for (uint32_t index = 0; index < buffer_length; index++) {
-    printf("%c", buffer[index]);
-  }
+  fwrite(buffer, 1, buffer_length, stdout);
 }
 
-void mqtt_client_error_event_handler(void *client, sl_mqtt_client_error_status_t *error)
+void mqtt_client_error_event_handler(void *client, sl_mqtt_client_error_status_t *error, void *context)
 {
   UNUSED_PARAMETER(client);
   printf("Terminating program, Error: %d\r\n", *error);
+  if (*error == SL_MQTT_CLIENT_CONNECT_FAILED) {
+    mqtt_connect_failed();
+  } else if (*error == SL_MQTT_CLIENT_DISCONNECT_FAILED && mqtt_failover_pending) {
+    mqtt_failover_pending = false;
+    app_reactor_post(APP_EVENT_MQTT_FAILOVER); // the retry backs off if the client is still stuck
+  } else if (*error == SL_MQTT_CLIENT_PUBLISH_FAILED) {
+    const mqtt_publish_context_t *publish_context = (const mqtt_publish_context_t *)context;
+
+    app_metrics_add(mqtt_metric_ids[MQTT_METRIC_PUBLISH_FAILED], 1);
+    // A QoS 0 publish has no PUBACK, its outcome says nothing about the link.
+    if (publish_context->qos_level != SL_MQTT_QOS_LEVEL_0) {
+      mqtt_link_policy_on_publish_result(false);
+    }
+  } else if (*error == SL_MQTT_CLIENT_SUBSCRIBE_FAILED) {
+    app_metrics_add(mqtt_metric_ids[MQTT_METRIC_SUBSCRIBE_FAILED], 1);
+  }
+  mqtt_publish_queue_kick(); // a failed command no longer holds the publish window either
 #if AMPAK_USE_FUNC_MQTT_CLIENT_CLEANUP
   mqtt_client_cleanup();
 #endif
@@ -413,42 +1310,63 @@ void mqtt_client_event_handler(void *client, sl_mqtt_client_event_t event, void
   switch (event) {
     case SL_MQTT_CLIENT_CONNECTED_EVENT: {
       printf("SL_MQTT_CLIENT_CONNECTED_EVENT\r\n");
-      sl_status_t status;
-
-      status = sl_mqtt_client_subscribe(client,
-                                        (uint8_t *)TOPIC_TO_BE_SUBSCRIBED,
-                                        strlen(TOPIC_TO_BE_SUBSCRIBED),
-                                        QOS_OF_SUBSCRIPTION,
-                                        0,
-                                        mqtt_client_message_handler,
-                                        TOPIC_TO_BE_SUBSCRIBED);
-      if (status != SL_STATUS_IN_PROGRESS) {
-        printf("Failed to subscribe : 0x%lx\r\n", status);
-
-        mqtt_client_cleanup();
-        return;
+      boot_timeline_mark(boot_timeline_connack);
+      app_metrics_add(mqtt_metric_ids[mqtt_connected_once ? MQTT_METRIC_RECONNECT : MQTT_METRIC_CONNECT_OK], 1);
+      mqtt_connected_once     = true;
+      mqtt_reconnect_delay_ms = MQTT_RECONNECT_MIN_MS;
+
+      sl_mqtt_client_connect_latency_t latency;
+      if (sl_mqtt_client_get_connect_latency(&latency) == SL_STATUS_OK) {
+        mqtt_broker_list_on_connected(latency.transport_connack_ms);
+        mqttTlsHandshake_t handshake = mqtt_tls_session_on_connected(latency.transport_connack_ms);
+        if (handshake != mqtt_tls_handshake_none) {
+          printf("TLS handshake %s, %lu ms to CONNACK\r\n", mqtt_tls_session_name(handshake), latency.transport_connack_ms);
+        }
       }
-#if 1
-      mqtt_publish_message_api("MQTT connect ok");
-#endif
+
+      mqtt_keepalive_on_connected();
+      mqtt_dedup_new_session();
+      mqtt_publish_queue_kick(); // flush what was held while offline
+      app_reactor_post(APP_EVENT_MQTT_CONNECTED); // subscribes run in mqtt_task
       break;
     }
 
     case SL_MQTT_CLIENT_MESSAGE_PUBLISHED_EVENT: {
       printf("SL_MQTT_CLIENT_MESSAGE_PUBLISHED_EVENT\r\n");
-      sl_mqtt_client_message_t *published_message = (sl_mqtt_client_message_t *)context;
-
-      printf("Published message successfully on topic: ");
-      print_char_buffer((char *)published_message->topic, published_message->topic_length);
-      printf("\r\n");
+      app_metrics_add(mqtt_metric_ids[MQTT_METRIC_PUBLISH_OK], 1);
+      const mqtt_publish_context_t *publish_context = (const mqtt_publish_context_t *)context;
+
+      if (publish_context->qos_level != SL_MQTT_QOS_LEVEL_0) {
+        mqtt_keepalive_on_publish_acked();
+        mqtt_link_policy_on_publish_result(true);
+      } else {
+        mqtt_keepalive_on_activity(); // only the NWP taking the frame, not a broker round trip
+      }
+      mqtt_power_gate_on_radio_activity();
+      mqtt_publish_queue_kick(); // publish window has room again
+      if (boot_timeline_mark(boot_timeline_publish)) {
+        app_reactor_post(APP_EVENT_BOOT_TIMELINE);
+      }
+      printf("Published message successfully on topic: %s\r\n", publish_context->topic);
       break;
     }
 
     case SL_MQTT_CLIENT_SUBSCRIBED_EVENT: {
 
       char *subscribed_topic = (char *)context;
+      sl_mqtt_client_connect_latency_t latency;
 
       printf("Subscribed to Topic: %s\r\n", subscribed_topic);
+      app_metrics_add(mqtt_metric_ids[MQTT_METRIC_SUBSCRIBE_OK], 1);
+      boot_timeline_mark(boot_timeline_suback);
+      mqtt_publish_queue_kick(); // publishes held back behind the subscribe
+      if (sl_mqtt_client_get_connect_latency(&latency) == SL_STATUS_OK) {
+        printf("Connect latency: init %lu ms, tcp/tls+connack %lu ms, suback %lu ms, total %lu ms\r\n",
+               latency.firmware_init_ms,
+               latency.transport_connack_ms,
+               latency.first_suback_ms,
+               latency.total_ms);
+      }
       break;
     }
 
@@ -456,7 +1374,9 @@ void mqtt_client_event_handler(void *client, sl_mqtt_client_event_t event, void
       char *unsubscribed_topic = (char *)context;
 
       printf("Unsubscribed from topic: %s\r\n", unsubscribed_topic);
+      mqtt_publish_queue_kick();
 #if AMPAK_MQTT_DISCONNECT_ON_UNSUBSCRIBE
+      mqtt_disconnect_requested = true;
       sl_mqtt_client_disconnect(client, 0);
 #endif
       break;
@@ -464,14 +1384,26 @@ void mqtt_client_event_handler(void *client, sl_mqtt_client_event_t event, void
 
     case SL_MQTT_CLIENT_DISCONNECTED_EVENT: {
       printf("Disconnected from MQTT broker\r\n");
+      if (mqtt_failover_pending) {
+        mqtt_failover_pending = false;
+        app_reactor_post(APP_EVENT_MQTT_FAILOVER); // failed connect torn down, never was a session
+        break;
+      }
+      app_metrics_add(mqtt_metric_ids[MQTT_METRIC_DISCONNECT], 1);
+      mqtt_keepalive_on_disconnected(mqtt_disconnect_requested);
 #if AMPAK_USE_FUNC_MQTT_CLIENT_CLEANUP
       mqtt_client_cleanup();
+#else
+      if (!mqtt_disconnect_requested) {
+        app_reactor_post(APP_EVENT_MQTT_DROPPED); // timer jobs only start from mqtt_task
+      }
 #endif
+      mqtt_disconnect_requested = false;
       break;
     }
 
     case SL_MQTT_CLIENT_ERROR_EVENT: {
-      mqtt_client_error_event_handler(client, (sl_mqtt_client_error_status_t *)event_data);
+      mqtt_client_error_event_handler(client, (sl_mqtt_client_error_status_t *)event_data, context);
       break;
     }
     default:
@@ -480,6 +1412,32 @@ void mqtt_client_event_handler(void *client, sl_mqtt_client_event_t event, void
 }
 
 sl_status_t mqtt_client_setup()
+{
+  sl_status_t status;
+  app_startup_report_t report;
+
+  // Independent steps overlap, e.g. credentials go in while Wi-Fi is still associating.
+  status = app_startup_run(mqtt_startup_steps, sizeof(mqtt_startup_steps) / sizeof(mqtt_startup_steps[0]), &report);
+  if (status != SL_STATUS_OK) {
+    return status;
+  }
+
+  provision_cache_stats_t provision;
+  provision_cache_commit();
+  provision_cache_get_stats(&provision);
+  printf("Credentials: %lu written, %lu unchanged\r\n", provision.written, provision.skipped);
+
+  //ampak_switch_device_profile_startover();
+#if 1//AMPAK_USE_SLEEP
+  osDelay(1000);
+  printf("Go DTIM 10\r\n");
+  ampak_m4_sleep_wakeup();
+#endif
+
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_setup_mac(void)
 {
   sl_status_t status;
 
@@ -493,38 +1451,89 @@ sl_status_t mqtt_client_setup()
     return status;
   }
 
-  memset(mac_for_id, 0, 13);
-  char mac_str[13] = {0};
-  sprintf(mac_str, "%2x%2x%2x%2x%2x%2x"
-          ,get_mac.octet[0]
-          ,get_mac.octet[1]
-          ,get_mac.octet[2]
-          ,get_mac.octet[3]
-          ,get_mac.octet[4]
-          ,get_mac.octet[5]
-         );
-  strncpy(mac_for_id, mac_str, 12);
+  ampak_fmt_t fmt;
+  ampak_fmt_mac(ampak_fmt_init(&fmt, mac_for_id, sizeof(mac_for_id)), get_mac.octet, 0);
 
   printf("MAC %s\r\n",mac_for_id);
+  boot_timeline_mark(boot_timeline_mac);
 
   mqtt_client_configuration.client_id = (uint8_t*) mac_for_id;
   mqtt_client_configuration.client_id_length = strlen(mac_for_id);
 
-  char will_topic_append_mac[200];
-  sprintf(will_topic_append_mac,"%s/%s",last_will_message.will_topic, mac_for_id);
+  // Referenced by the client until the next connect, so it can not live on the stack.
+  static char will_topic_append_mac[LAST_WILL_TOPIC_SIZE];
+  ampak_fmt_init(&fmt, will_topic_append_mac, sizeof(will_topic_append_mac));
+  ampak_fmt_str(ampak_fmt_lit(ampak_fmt_lit(&fmt, LAST_WILL_TOPIC), "/"), mac_for_id);
   last_will_message.will_topic = (uint8_t*)will_topic_append_mac;
-  last_will_message.will_topic_length = strlen(will_topic_append_mac);
+  last_will_message.will_topic_length = ampak_fmt_length(&fmt);
+
+  ampak_fmt_init(&fmt, rpc_request_topic, sizeof(rpc_request_topic));
+  ampak_fmt_lit(ampak_fmt_str(ampak_fmt_lit(&fmt, RPC_TOPIC_PREFIX), mac_for_id), "/request");
+  ampak_fmt_init(&fmt, rpc_response_topic, sizeof(rpc_response_topic));
+  ampak_fmt_lit(ampak_fmt_str(ampak_fmt_lit(&fmt, RPC_TOPIC_PREFIX), mac_for_id), "/response");
+  if (mqtt_rpc_init(rpc_response_topic, QOS_OF_PUBLISH_MESSAGE) != SL_STATUS_OK) {
+    printf("Failed to init rpc\r\n");
+  }
+
+  ampak_fmt_init(&fmt, ota_chunk_topic, sizeof(ota_chunk_topic));
+  ampak_fmt_lit(ampak_fmt_str(ampak_fmt_lit(&fmt, OTA_TOPIC_PREFIX), mac_for_id), "/chunk");
+  ampak_fmt_init(&fmt, ota_status_topic, sizeof(ota_status_topic));
+  ampak_fmt_lit(ampak_fmt_str(ampak_fmt_lit(&fmt, OTA_TOPIC_PREFIX), mac_for_id), "/status");
+  if (mqtt_ota_init(&mqtt_ota_fwup_flash, ota_status_topic, QOS_OF_PUBLISH_MESSAGE) != SL_STATUS_OK) {
+    printf("Failed to init ota\r\n");
+  }
+
+  ampak_fmt_init(&fmt, metrics_topic, sizeof(metrics_topic));
+  ampak_fmt_lit(ampak_fmt_str(ampak_fmt_lit(&fmt, METRICS_TOPIC_PREFIX), mac_for_id), "/metrics");
+  ampak_fmt_init(&fmt, metrics_schema_topic, sizeof(metrics_schema_topic));
+  ampak_fmt_lit(ampak_fmt_str(ampak_fmt_lit(&fmt, METRICS_TOPIC_PREFIX), mac_for_id), "/schema");
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_setup_manifest(void)
+{
+  sl_wifi_firmware_version_t version = { 0 };
+
+  // A new NWP firmware may come with an empty credential store, so it invalidates the manifest.
+  if (sl_wifi_get_firmware_version(&version) != SL_STATUS_OK) {
+    printf("Failed to read firmware version, credentials rewritten\r\n");
+    provision_cache_init(NULL, NULL, 0);
+    return SL_STATUS_OK;
+  }
+  provision_cache_init(&provision_cache_flash_storage, &version, sizeof(version));
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_setup_tls_cert(void)
+{
+  sl_status_t status;
 
   if (ENCRYPT_CONNECTION) {
+    bool written = false;
+
     // Load SSL CA certificate
-    status =
-      sl_net_set_credential(SL_NET_TLS_SERVER_CREDENTIAL_ID(0), SL_NET_SIGNING_CERTIFICATE, cacert, sizeof(cacert) - 1);
+    status = provision_cache_set_credential(SL_NET_TLS_SERVER_CREDENTIAL_ID(0),
+                                            SL_NET_SIGNING_CERTIFICATE,
+                                            cacert,
+                                            sizeof(cacert) - 1,
+                                            &written);
     if (status != SL_STATUS_OK) {
       printf("\r\nLoading TLS CA certificate in to FLASH Failed, Error Code : 0x%lX\r\n", status);
       return status;
     }
     printf("\r\nLoad TLS CA certificate at index %d Success\r\n", 0);
+
+    // A new CA means a new trust decision, the cached TLS session does not carry over.
+    if (written) {
+      mqtt_tls_session_invalidate();
+    }
   }
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_setup_credential(void)
+{
+  sl_status_t status;
 
   if (SEND_CREDENTIALS) {
     uint16_t username_length, password_length;
@@ -532,22 +1541,24 @@ sl_status_t mqtt_client_setup()
     username_length = strlen(mac_for_id);
     password_length = strlen(PASSWORD);
 
-    uint32_t malloc_size = sizeof(sl_mqtt_client_credentials_t) + username_length + password_length;
+    uint32_t credential_size = sizeof(sl_mqtt_client_credentials_t) + username_length + password_length;
 
-    client_credentails = malloc(malloc_size);
-    if (client_credentails == NULL)
-      return SL_STATUS_ALLOCATION_FAILED;
-    memset(client_credentails, 0, malloc_size);
+    if (credential_size > sizeof(mqtt_credential_blob)) {
+      return SL_STATUS_WOULD_OVERFLOW;
+    }
+    memset(&mqtt_credential_blob, 0, sizeof(mqtt_credential_blob));
     client_credentails->username_length = username_length;
     client_credentails->password_length = password_length;
 
     memcpy(&client_credentails->data[0], mac_for_id, username_length);
     memcpy(&client_credentails->data[username_length], PASSWORD, password_length);
 
-    status = sl_net_set_credential(SL_NET_MQTT_CLIENT_CREDENTIAL_ID(0),
-                                   SL_NET_MQTT_CLIENT_CREDENTIAL,
-                                   client_credentails,
-                                   malloc_size);
+    // Skipped when the NWP already holds this exact blob.
+    status = provision_cache_set_credential(SL_NET_MQTT_CLIENT_CREDENTIAL_ID(0),
+                                            SL_NET_MQTT_CLIENT_CREDENTIAL,
+                                            client_credentails,
+                                            credential_size,
+                                            NULL);
 
     if (status != SL_STATUS_OK) {
       mqtt_client_cleanup();
@@ -557,9 +1568,15 @@ sl_status_t mqtt_client_setup()
     }
     printf("Set credentials Success \r\n ");
 
-    free(client_credentails);
     mqtt_client_configuration.credential_id = SL_NET_MQTT_CLIENT_CREDENTIAL_ID(0);
   }
+  boot_timeline_mark(boot_timeline_credentials);
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_setup_client_init(void)
+{
+  sl_status_t status;
 
   status = sl_mqtt_client_init(&client, mqtt_client_event_handler);
   if (status != SL_STATUS_OK) {
@@ -570,36 +1587,48 @@ sl_status_t mqtt_client_setup()
   }
   printf("Init mqtt client Success \r\n");
 
-  status = sl_net_inet_addr(MQTT_BROKER_IP, &mqtt_broker_configuration.ip.ip.v4.value);
+  status = sl_mqtt_client_set_loopback_policy(&client, MQTT_LOOPBACK_POLICY);
+  if (status != SL_STATUS_OK) {
+    printf("Failed to set loopback policy: 0x%lx\r\n", status);
+  }
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_setup_broker_addr(void)
+{
+  sl_status_t status;
+
+  // Cached DNS answer or a lookup; endpoints that do not resolve are skipped.
+  status = mqtt_broker_list_select(&mqtt_broker_configuration);
   if (status != SL_STATUS_OK) {
-    printf("Failed to convert IP address \r\n");
+    printf("No broker address: 0x%lx\r\n", status);
 
     mqtt_client_cleanup();
     return status;
   }
 
+  // Keep alive is re-tuned from the outcome of previous connections
+  mqtt_broker_configuration.keep_alive_interval = mqtt_keepalive_next_interval();
+  mqtt_broker_configuration.keep_alive_retries  = mqtt_keepalive_next_retries();
+  return SL_STATUS_OK;
+}
+
+sl_status_t mqtt_setup_connect(void)
+{
+  sl_status_t status;
+
+  mqtt_keepalive_on_connect_start();
+  mqtt_tls_session_on_connect_start(&mqtt_broker_configuration);
+
   status =
     sl_mqtt_client_connect(&client, &mqtt_broker_configuration, &last_will_message, &mqtt_client_configuration, 0);
   if (status != SL_STATUS_IN_PROGRESS) {
     printf("Failed to connect to mqtt broker: 0x%lx\r\n", status);
 
-    mqtt_client_cleanup();
+    mqtt_connect_failed();
     return status;
   }
   printf("Connect to mqtt broker Success \r\n");
-
-  //ampak_switch_device_profile_startover();
-#if 1//AMPAK_USE_SLEEP
-  osDelay(1000);
-  printf("Go DTIM 10\r\n");
-  ampak_m4_sleep_wakeup();
-#endif
-
-  while (!is_execution_completed) {
-    osThreadYield(); // TODO: keep running in this while loop
-  }
-
-  printf("Example execution completed \r\n");
-
+  boot_timeline_mark(boot_timeline_connect);
   return SL_STATUS_OK;
 }
@@ -17,6 +17,7 @@
 #include "sl_component_catalog.h"
 #include "sl_system_init.h"
 #include "app.h"
+#include "ampak_wl72917/boot_timeline.h"
 #if defined(SL_CATALOG_POWER_MANAGER_PRESENT)
 #include "sl_power_manager.h"
 #endif
@@ -28,10 +29,13 @@
 
 int main(void)
 {
+  boot_timeline_start();
+
   // Initialize Silicon Labs device, system, service(s) and protocol stack(s).
   // Note that if the kernel is present, processing task(s) will be created by
   // this call.
   sl_system_init();
+  boot_timeline_mark(boot_timeline_system_init);
 
   // Initialize the application. For example, create periodic timer(s) or
   // task(s) if the kernel is present.
@@ -0,0 +1,139 @@
+/*
+ * host_os.c
+ *
+ * CMSIS-RTOS2 subset on POSIX threads, for host tests of modules that run their own task.
+ * The kernel tick is a millisecond monotonic clock.
+ */
+
+#include "cmsis_os2.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  uint32_t flags;
+  osThreadFunc_t func;
+  void *argument;
+} host_thread_t;
+
+static __thread host_thread_t *current_thread;
+
+static void *host_thread_entry(void *argument)
+{
+  host_thread_t *thread = argument;
+
+  current_thread = thread;
+  thread->func(thread->argument);
+  return NULL;
+}
+
+uint32_t osKernelGetTickCount(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)((uint64_t)now.tv_sec * 1000U + (uint64_t)now.tv_nsec / 1000000U);
+}
+
+uint32_t osKernelGetTickFreq(void)
+{
+  return 1000U;
+}
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void *argument, const osThreadAttr_t *attr)
+{
+  pthread_condattr_t condattr;
+  host_thread_t *thread = calloc(1, sizeof(*thread));
+
+  (void)attr;
+  if (thread == NULL) {
+    return NULL;
+  }
+  thread->func     = func;
+  thread->argument = argument;
+  pthread_mutex_init(&thread->lock, NULL);
+  pthread_condattr_init(&condattr);
+  pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+  pthread_cond_init(&thread->changed, &condattr);
+
+  if (pthread_create(&thread->thread, NULL, host_thread_entry, thread) != 0) {
+    free(thread);
+    return NULL;
+  }
+  pthread_detach(thread->thread);
+  return thread;
+}
+
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags)
+{
+  host_thread_t *thread = thread_id;
+  uint32_t result;
+
+  pthread_mutex_lock(&thread->lock);
+  thread->flags |= flags;
+  result = thread->flags;
+  pthread_cond_signal(&thread->changed);
+  pthread_mutex_unlock(&thread->lock);
+  return result;
+}
+
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout)
+{
+  host_thread_t *thread = current_thread;
+  struct timespec deadline;
+  uint32_t result;
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeout / 1000U;
+  deadline.tv_nsec += (long)(timeout % 1000U) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  pthread_mutex_lock(&thread->lock);
+  while (1) {
+    result = thread->flags & flags;
+    if ((options & osFlagsWaitAll) ? (result == flags) : (result != 0)) {
+      break;
+    }
+    if (timeout == 0
+        || (timeout != osWaitForever && pthread_cond_timedwait(&thread->changed, &thread->lock, &deadline) != 0)) {
+      pthread_mutex_unlock(&thread->lock);
+      return osFlagsErrorTimeout;
+    }
+    if (timeout == osWaitForever) {
+      pthread_cond_wait(&thread->changed, &thread->lock);
+    }
+  }
+  if ((options & osFlagsNoClear) == 0) {
+    thread->flags &= ~result;
+  }
+  pthread_mutex_unlock(&thread->lock);
+  return result;
+}
+
+osMutexId_t osMutexNew(const void *attr)
+{
+  pthread_mutex_t *mutex = malloc(sizeof(*mutex));
+
+  (void)attr;
+  if (mutex != NULL) {
+    pthread_mutex_init(mutex, NULL);
+  }
+  return mutex;
+}
+
+osStatus_t osMutexAcquire(osMutexId_t mutex_id, uint32_t timeout)
+{
+  (void)timeout;
+  return (pthread_mutex_lock(mutex_id) == 0) ? osOK : osError;
+}
+
+osStatus_t osMutexRelease(osMutexId_t mutex_id)
+{
+  return (pthread_mutex_unlock(mutex_id) == 0) ? osOK : osError;
+}
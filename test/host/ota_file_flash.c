@@ -0,0 +1,124 @@
+/*
+ * ota_file_flash.c
+ *
+ * File backed mqtt_ota_flash_t, see ota_file_flash.h.
+ */
+
+#include "ota_file_flash.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *flash_path;
+static FILE *flash_file;
+static uint32_t flash_size;
+static uint32_t flash_next;     /* offset the next write has to start at */
+static uint32_t flash_erased;   /* end of the erased range */
+static ota_file_flash_stats_t flash_stats;
+static pthread_mutex_t flash_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static sl_status_t ota_file_flash_begin(uint32_t image_size)
+{
+  pthread_mutex_lock(&flash_lock);
+  if (flash_file != NULL) {
+    fclose(flash_file);
+  }
+  flash_file   = fopen(flash_path, "w+b");
+  flash_size   = image_size;
+  flash_next   = 0;
+  flash_erased = 0;
+  flash_stats.begins++;
+  pthread_mutex_unlock(&flash_lock);
+
+  return (flash_file != NULL) ? SL_STATUS_OK : SL_STATUS_FAIL;
+}
+
+static sl_status_t ota_file_flash_erase(uint32_t offset, uint32_t length)
+{
+  uint8_t blank[MQTT_OTA_SECTOR_SIZE];
+  sl_status_t status = SL_STATUS_OK;
+
+  memset(blank, 0xFF, sizeof(blank));
+  pthread_mutex_lock(&flash_lock);
+  flash_stats.erases++;
+  if (offset != flash_next || length != MQTT_OTA_SECTOR_SIZE) {
+    flash_stats.violations++;
+    status = SL_STATUS_INVALID_PARAMETER;
+  } else if (fseek(flash_file, (long)offset, SEEK_SET) != 0 || fwrite(blank, 1, length, flash_file) != length) {
+    status = SL_STATUS_FAIL;
+  } else {
+    flash_erased = offset + length;
+  }
+  pthread_mutex_unlock(&flash_lock);
+  return status;
+}
+
+static sl_status_t ota_file_flash_write(uint32_t offset, const uint8_t *data, uint32_t length)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  pthread_mutex_lock(&flash_lock);
+  flash_stats.writes++;
+  if (offset != flash_next || offset + length > flash_erased || length > MQTT_OTA_SECTOR_SIZE) {
+    flash_stats.violations++;
+    status = SL_STATUS_INVALID_PARAMETER;
+  } else if (fseek(flash_file, (long)offset, SEEK_SET) != 0 || fwrite(data, 1, length, flash_file) != length) {
+    status = SL_STATUS_FAIL;
+  } else {
+    flash_next = offset + length;
+  }
+  pthread_mutex_unlock(&flash_lock);
+  return status;
+}
+
+static sl_status_t ota_file_flash_finish(void)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  pthread_mutex_lock(&flash_lock);
+  flash_stats.finishes++;
+  if (flash_next != flash_size) {
+    flash_stats.violations++;
+    status = SL_STATUS_FAIL;
+  } else {
+    fflush(flash_file);
+  }
+  pthread_mutex_unlock(&flash_lock);
+  return status;
+}
+
+const mqtt_ota_flash_t ota_file_flash = {
+  .begin  = ota_file_flash_begin,
+  .erase  = ota_file_flash_erase,
+  .write  = ota_file_flash_write,
+  .finish = ota_file_flash_finish,
+};
+
+void ota_file_flash_set_path(const char *path)
+{
+  flash_path = path;
+}
+
+void ota_file_flash_get_stats(ota_file_flash_stats_t *stats)
+{
+  pthread_mutex_lock(&flash_lock);
+  *stats = flash_stats;
+  pthread_mutex_unlock(&flash_lock);
+}
+
+bool ota_file_flash_holds(const uint8_t *image, uint32_t image_size)
+{
+  bool holds = false;
+  uint8_t *content = malloc(image_size);
+
+  pthread_mutex_lock(&flash_lock);
+  if (content != NULL && flash_file != NULL && flash_next == image_size && fseek(flash_file, 0, SEEK_SET) == 0
+      && fread(content, 1, image_size, flash_file) == image_size) {
+    holds = (memcmp(content, image, image_size) == 0);
+  }
+  pthread_mutex_unlock(&flash_lock);
+
+  free(content);
+  return holds;
+}
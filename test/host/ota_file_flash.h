@@ -0,0 +1,30 @@
+/*
+ * ota_file_flash.h
+ *
+ * File backed mqtt_ota_flash_t for host tests. Checks the contract the receiver promises:
+ * writes in image order, one sector at a time, never into a sector that was not erased.
+ */
+
+#ifndef TEST_HOST_OTA_FILE_FLASH_H_
+#define TEST_HOST_OTA_FILE_FLASH_H_
+
+#include "ampak_wl72917/mqtt_ota.h"
+
+typedef struct {
+  uint32_t begins;
+  uint32_t erases;
+  uint32_t writes;
+  uint32_t finishes;
+  uint32_t violations;  /* writes out of order or into a sector not erased */
+} ota_file_flash_stats_t;
+
+extern const mqtt_ota_flash_t ota_file_flash;
+
+/** Back the flash with this file, it is truncated on every begin **/
+void ota_file_flash_set_path(const char *path);
+void ota_file_flash_get_stats(ota_file_flash_stats_t *stats);
+
+/** Compare the file content with the image that was sent **/
+bool ota_file_flash_holds(const uint8_t *image, uint32_t image_size);
+
+#endif /* TEST_HOST_OTA_FILE_FLASH_H_ */
@@ -0,0 +1,178 @@
+/*
+ * sim_driver.c
+ *
+ * Simulated SiWx917 network command queue, see sim_driver.h.
+ */
+
+#include "sim_driver.h"
+#include "cmsis_os2.h"
+#include "sl_net.h"
+#include "sl_si91x_driver.h"
+#include "si91x_mqtt_client_utility.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SIM_RAW_FRAMES 128
+
+typedef struct {
+  void *sdk_context; /* NULL for a raw frame */
+  uint32_t raw_id;
+} sim_frame_t;
+
+uint32_t sim_service_ms = 10;
+
+static uint32_t sim_now;
+static sim_frame_t sim_queue[SIM_QUEUE_DEPTH];
+static uint32_t sim_head;
+static uint32_t sim_count;
+static uint32_t sim_raw_next = 1;
+static uint32_t sim_raw_done[SIM_RAW_FRAMES];
+
+static void sim_push(void *sdk_context, uint32_t raw_id)
+{
+  if (sim_count == SIM_QUEUE_DEPTH) {
+    fprintf(stderr, "simulated firmware queue overflow\n");
+    abort();
+  }
+  sim_queue[(sim_head + sim_count) % SIM_QUEUE_DEPTH] = (sim_frame_t){ sdk_context, raw_id };
+  sim_count++;
+}
+
+uint32_t sim_now_ms(void)
+{
+  return sim_now;
+}
+
+void sim_advance_ms(uint32_t ms)
+{
+  sim_now += ms;
+}
+
+uint32_t sim_queue_length(void)
+{
+  return sim_count;
+}
+
+uint32_t sim_enqueue_raw(void)
+{
+  uint32_t id = sim_raw_next++ % SIM_RAW_FRAMES;
+
+  sim_raw_done[id] = 0;
+  sim_push(NULL, id);
+  return id;
+}
+
+bool sim_complete_next(void)
+{
+  if (sim_count == 0) {
+    return false;
+  }
+
+  sim_frame_t frame = sim_queue[sim_head];
+  sim_head          = (sim_head + 1) % SIM_QUEUE_DEPTH;
+  sim_count--;
+
+  sim_now += sim_service_ms;
+  if (frame.sdk_context == NULL) {
+    sim_raw_done[frame.raw_id] = sim_now;
+  } else {
+    // Frees the context, as on target
+    sli_si91x_mqtt_event_handler(SL_STATUS_OK, frame.sdk_context, NULL);
+  }
+  return true;
+}
+
+uint32_t sim_completed_at_ms(uint32_t id)
+{
+  return sim_raw_done[id % SIM_RAW_FRAMES];
+}
+
+void sim_lose_all(void)
+{
+  // The contexts are kept allocated on purpose: the client still tracks them by address, a freed
+  // address handed out again would let a new command match a lost one.
+  sim_head  = 0;
+  sim_count = 0;
+}
+
+/**
+ *  Driver and RTOS services used by sl_mqtt_client.c
+ */
+sl_status_t sl_si91x_driver_send_command(uint32_t command,
+                                         sl_si91x_queue_type_t queue_type,
+                                         const void *data,
+                                         uint32_t data_length,
+                                         sl_si91x_wait_period_t wait_period,
+                                         void *sdk_context,
+                                         void **data_buffer)
+{
+  (void)command;
+  (void)queue_type;
+  (void)data;
+  (void)data_length;
+  (void)data_buffer;
+
+  if (wait_period != SL_SI91X_RETURN_IMMEDIATELY) {
+    // Blocking command, served after everything queued in front of it
+    while (sim_complete_next()) {
+    }
+    sim_now += sim_service_ms;
+    return SL_STATUS_OK;
+  }
+
+  sim_push(sdk_context, 0);
+  return SL_STATUS_IN_PROGRESS;
+}
+
+sl_status_t sl_net_get_credential(sl_net_credential_id_t id,
+                                  sl_net_credential_type_t *type,
+                                  void *credential,
+                                  uint32_t *credential_length)
+{
+  (void)id;
+  (void)type;
+  (void)credential;
+  (void)credential_length;
+  return SL_STATUS_NOT_FOUND;
+}
+
+void sl_debug_log(const char *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+}
+
+uint32_t osKernelGetTickCount(void)
+{
+  return sim_now;
+}
+
+uint32_t osKernelGetTickFreq(void)
+{
+  return 1000U;
+}
+
+osMutexId_t osMutexNew(const void *attr)
+{
+  static uint8_t mutex;
+
+  (void)attr;
+  return &mutex;
+}
+
+osStatus_t osMutexAcquire(osMutexId_t mutex_id, uint32_t timeout)
+{
+  (void)mutex_id;
+  (void)timeout;
+  return osOK;
+}
+
+osStatus_t osMutexRelease(osMutexId_t mutex_id)
+{
+  (void)mutex_id;
+  return osOK;
+}
@@ -0,0 +1,47 @@
+/*
+ * sim_driver.h
+ *
+ * Simulated SiWx917 network command queue for host tests of the local sl_mqtt_client.c.
+ *
+ * The firmware serves SI91X_NETWORK_CMD_QUEUE one frame at a time, in order. Here every frame takes
+ * sim_service_ms of simulated time and completes through sli_si91x_mqtt_event_handler(), the same
+ * entry the driver's async response path uses. The RTOS tick is the simulated clock.
+ */
+
+#ifndef TEST_HOST_SIM_DRIVER_H_
+#define TEST_HOST_SIM_DRIVER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Frames the simulated firmware queue can hold **/
+#define SIM_QUEUE_DEPTH 64
+
+/** Time the firmware needs per frame, settable by the test **/
+extern uint32_t sim_service_ms;
+
+uint32_t sim_now_ms(void);
+void sim_advance_ms(uint32_t ms);
+
+/** Frames queued and not completed yet **/
+uint32_t sim_queue_length(void);
+
+/**
+ * Queue a frame that does not belong to the MQTT client, e.g. another client's traffic.
+ * @return Id to pass to sim_completed_at_ms().
+ */
+uint32_t sim_enqueue_raw(void);
+
+/**
+ * Serve the frame at the head of the queue.
+ * @return false if the queue is empty.
+ */
+bool sim_complete_next(void);
+
+/** Simulated time at which a raw frame completed, 0 while it is pending **/
+uint32_t sim_completed_at_ms(uint32_t id);
+
+/** Throw away every queued frame without a completion, like a firmware that lost them **/
+void sim_lose_all(void);
+
+#endif /* TEST_HOST_SIM_DRIVER_H_ */
@@ -0,0 +1,64 @@
+/*
+ * cmsis_os2.h
+ *
+ * Host stand-in for the CMSIS-RTOS2 API, the part the host tested sources use.
+ * sim_driver.c implements it single threaded on a simulated clock, host_os.c on POSIX threads.
+ */
+
+#ifndef HOST_STUB_CMSIS_OS2_H_
+#define HOST_STUB_CMSIS_OS2_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+  osOK             = 0,
+  osError          = -1,
+  osErrorTimeout   = -2,
+  osErrorResource  = -3,
+  osErrorParameter = -4,
+} osStatus_t;
+
+typedef enum {
+  osPriorityLow         = 8,
+  osPriorityBelowNormal = 16,
+  osPriorityNormal      = 24,
+  osPriorityAboveNormal = 32,
+} osPriority_t;
+
+typedef void *osThreadId_t;
+typedef void *osMutexId_t;
+typedef void (*osThreadFunc_t)(void *argument);
+
+typedef struct {
+  const char *name;
+  uint32_t attr_bits;
+  void *cb_mem;
+  uint32_t cb_size;
+  void *stack_mem;
+  uint32_t stack_size;
+  osPriority_t priority;
+  uint32_t tz_module;
+  uint32_t reserved;
+} osThreadAttr_t;
+
+#define osWaitForever 0xFFFFFFFFU
+
+#define osFlagsWaitAny      0x00000000U
+#define osFlagsWaitAll      0x00000001U
+#define osFlagsNoClear      0x00000002U
+#define osFlagsError        0x80000000U
+#define osFlagsErrorTimeout 0xFFFFFFFEU
+
+uint32_t osKernelGetTickCount(void);
+uint32_t osKernelGetTickFreq(void);
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void *argument, const osThreadAttr_t *attr);
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags);
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+osMutexId_t osMutexNew(const void *attr);
+osStatus_t osMutexAcquire(osMutexId_t mutex_id, uint32_t timeout);
+osStatus_t osMutexRelease(osMutexId_t mutex_id);
+
+#endif /* HOST_STUB_CMSIS_OS2_H_ */
@@ -0,0 +1,18 @@
+/*
+ * firmware_upgradation.h
+ *
+ * Host stand-in for the WiseConnect 3.1.4 header of the same name.
+ */
+
+#ifndef HOST_STUB_FIRMWARE_UPGRADATION_H_
+#define HOST_STUB_FIRMWARE_UPGRADATION_H_
+
+#include <stdint.h>
+#include "sl_status.h"
+
+#define SL_STATUS_SI91X_FW_UPDATE_DONE ((sl_status_t)0x10003)
+
+sl_status_t sl_si91x_fwup_start(uint8_t *rps_header);
+sl_status_t sl_si91x_fwup_load(uint8_t *content, uint16_t length);
+
+#endif /* HOST_STUB_FIRMWARE_UPGRADATION_H_ */
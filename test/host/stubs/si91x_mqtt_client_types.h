@@ -0,0 +1,112 @@
+/*
+ * si91x_mqtt_client_types.h
+ *
+ * Host stand-in for the WiseConnect 3.1.4 header of the same name, same layout as the firmware frames.
+ */
+
+#ifndef HOST_STUB_SI91X_MQTT_CLIENT_TYPES_H_
+#define HOST_STUB_SI91X_MQTT_CLIENT_TYPES_H_
+
+#include <stdint.h>
+#include "sl_mqtt_client_types.h"
+
+#define SI91X_MQTT_CLIENT_TOPIC_MAXIMUM_LENGTH        202
+#define SI91X_MQTT_CLIENT_ID_MAXIMUM_LENGTH           64
+#define SI91X_MQTT_CLIENT_WILL_TOPIC_MAXIMUM_LENGTH   202
+#define SI91X_MQTT_CLIENT_WILL_MESSAGE_MAXIMUM_LENGTH 100
+#define SI91X_MQTT_CLIENT_USERNAME_MAXIMUM_LENGTH     120
+#define SI91X_MQTT_CLIENT_PASSWORD_MAXIMUM_LENGTH     60
+
+#define SL_SI91X_MQTT_CLIENT_TOPIC_DELIMITER        "/"
+#define SL_SI91X_MQTT_CLIENT_MULTI_LEVEL_WILD_CARD  "#"
+#define SL_SI91X_MQTT_CLIENT_SINGLE_LEVEL_WILD_CARD "+"
+
+typedef enum {
+  SI91X_MQTT_CLIENT_INIT_COMMAND = 1,
+  SI91X_MQTT_CLIENT_CONNECT_COMMAND,
+  SI91X_MQTT_CLIENT_SUBSCRIBE_COMMAND,
+  SI91X_MQTT_CLIENT_PUBLISH_COMMAND,
+  SI91X_MQTT_CLIENT_UNSUBSCRIBE_COMMAND,
+  SI91X_MQTT_CLIENT_PING_COMMAND,
+  SI91X_MQTT_CLIENT_DISCONNECT_COMMAND,
+  SI91X_MQTT_CLIENT_DEINIT_COMMAND,
+} si91x_mqtt_client_command_type_t;
+
+typedef struct {
+  uint32_t command_type;
+  struct {
+    uint8_t server_ip_address[16];
+  } server_ip;
+  uint32_t server_port;
+  uint32_t client_id_len;
+  int8_t client_id[SI91X_MQTT_CLIENT_ID_MAXIMUM_LENGTH];
+  uint16_t keep_alive_interval;
+  uint16_t keep_alive_retries;
+  uint16_t clean;
+  uint16_t encrypt;
+  uint32_t client_port;
+  uint32_t username_len;
+  int8_t user_name[SI91X_MQTT_CLIENT_USERNAME_MAXIMUM_LENGTH];
+  uint32_t password_len;
+  int8_t password[SI91X_MQTT_CLIENT_PASSWORD_MAXIMUM_LENGTH];
+} si91x_mqtt_client_init_request_t;
+
+typedef struct {
+  uint32_t command_type;
+  uint8_t is_username_present;
+  uint8_t is_password_present;
+  uint8_t will_retain;
+  uint8_t will_qos;
+  uint8_t will_flag;
+  uint8_t will_topic_len;
+  uint8_t will_message_len;
+  int8_t will_topic[SI91X_MQTT_CLIENT_WILL_TOPIC_MAXIMUM_LENGTH];
+  int8_t will_msg[SI91X_MQTT_CLIENT_WILL_MESSAGE_MAXIMUM_LENGTH];
+} si91x_mqtt_client_connect_request_t;
+
+typedef struct {
+  uint32_t command_type;
+} si91x_mqtt_client_command_request_t;
+
+typedef struct {
+  uint32_t command_type;
+  uint8_t topic_len;
+  int8_t topic[SI91X_MQTT_CLIENT_TOPIC_MAXIMUM_LENGTH];
+  uint8_t qos;
+  uint8_t retained;
+  uint8_t dup;
+  uint16_t msg_len;
+  int8_t *msg;
+} si91x_mqtt_client_publish_request_t;
+
+typedef struct {
+  uint32_t command_type;
+  uint8_t topic_len;
+  int8_t topic[SI91X_MQTT_CLIENT_TOPIC_MAXIMUM_LENGTH];
+  uint8_t qos;
+} si91x_mqtt_client_subscribe_t;
+
+typedef struct {
+  uint32_t command_type;
+  uint8_t topic_len;
+  int8_t topic[SI91X_MQTT_CLIENT_TOPIC_MAXIMUM_LENGTH];
+} si91x_mqtt_client_unsubscribe_request_t;
+
+typedef struct {
+  uint32_t command_type;
+  uint8_t qos;
+  uint8_t retained;
+  uint8_t duplicate_message;
+  uint16_t topic_length;
+  uint32_t current_chunk_length;
+  uint8_t data[];
+} si91x_mqtt_client_received_message;
+
+typedef struct {
+  sl_mqtt_client_event_t event;
+  sl_mqtt_client_t *client;
+  void *user_context;
+  void *sdk_data;
+} sl_si91x_mqtt_client_context_t;
+
+#endif /* HOST_STUB_SI91X_MQTT_CLIENT_TYPES_H_ */
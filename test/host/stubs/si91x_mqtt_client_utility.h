@@ -0,0 +1,18 @@
+/*
+ * si91x_mqtt_client_utility.h
+ *
+ * Host stand-in for the WiseConnect 3.1.4 header of the same name.
+ */
+
+#ifndef HOST_STUB_SI91X_MQTT_CLIENT_UTILITY_H_
+#define HOST_STUB_SI91X_MQTT_CLIENT_UTILITY_H_
+
+#include "sl_status.h"
+#include "sl_si91x_driver.h"
+#include "si91x_mqtt_client_types.h"
+
+sl_status_t sli_si91x_mqtt_event_handler(sl_status_t status,
+                                         sl_si91x_mqtt_client_context_t *sdk_context,
+                                         sl_si91x_packet_t *rx_packet);
+
+#endif /* HOST_STUB_SI91X_MQTT_CLIENT_UTILITY_H_ */
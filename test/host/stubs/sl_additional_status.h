@@ -0,0 +1,12 @@
+/*
+ * sl_additional_status.h
+ *
+ * Host stand-in, the status codes live in sl_status.h.
+ */
+
+#ifndef HOST_STUB_SL_ADDITIONAL_STATUS_H_
+#define HOST_STUB_SL_ADDITIONAL_STATUS_H_
+
+#include "sl_status.h"
+
+#endif /* HOST_STUB_SL_ADDITIONAL_STATUS_H_ */
@@ -0,0 +1,39 @@
+/*
+ * sl_mqtt_client.h
+ *
+ * Host stand-in for the WiseConnect 3.1.4 header of the same name.
+ */
+
+#ifndef HOST_STUB_SL_MQTT_CLIENT_H_
+#define HOST_STUB_SL_MQTT_CLIENT_H_
+
+#include <stdint.h>
+#include "sl_status.h"
+#include "sl_mqtt_client_types.h"
+
+sl_status_t sl_mqtt_client_init(sl_mqtt_client_t *client, sl_mqtt_client_event_handler_t event_handler);
+sl_status_t sl_mqtt_client_deinit(sl_mqtt_client_t *client);
+sl_status_t sl_mqtt_client_connect(sl_mqtt_client_t *client,
+                                   const sl_mqtt_broker_t *broker,
+                                   const sl_mqtt_client_last_will_message_t *last_will_message,
+                                   const sl_mqtt_client_configuration_t *configuration,
+                                   uint32_t timeout);
+sl_status_t sl_mqtt_client_disconnect(sl_mqtt_client_t *client, uint32_t timeout);
+sl_status_t sl_mqtt_client_publish(sl_mqtt_client_t *client,
+                                   const sl_mqtt_client_message_t *message,
+                                   uint32_t timeout,
+                                   void *context);
+sl_status_t sl_mqtt_client_subscribe(sl_mqtt_client_t *client,
+                                     const uint8_t *topic,
+                                     uint16_t topic_length,
+                                     sl_mqtt_qos_t qos_level,
+                                     uint32_t timeout,
+                                     sl_mqtt_client_message_received_t message_handler,
+                                     void *context);
+sl_status_t sl_mqtt_client_unsubscribe(sl_mqtt_client_t *client,
+                                       const uint8_t *topic,
+                                       uint16_t topic_length,
+                                       uint32_t timeout,
+                                       void *context);
+
+#endif /* HOST_STUB_SL_MQTT_CLIENT_H_ */
@@ -0,0 +1,126 @@
+/*
+ * sl_mqtt_client_types.h
+ *
+ * Host stand-in for the WiseConnect 3.1.4 header of the same name, same layout as the SDK types.
+ */
+
+#ifndef HOST_STUB_SL_MQTT_CLIENT_TYPES_H_
+#define HOST_STUB_SL_MQTT_CLIENT_TYPES_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_status.h"
+
+typedef enum { SL_MQTT_QOS_LEVEL_0, SL_MQTT_QOS_LEVEL_1, SL_MQTT_QOS_LEVEL_2 } sl_mqtt_qos_t;
+
+typedef enum {
+  SL_MQTT_CLIENT_DISCONNECTED,
+  SL_MQTT_CLIENT_TA_INIT,
+  SL_MQTT_CLIENT_CONNECTED,
+  SL_MQTT_CLIENT_CONNECTION_FAILED,
+  SL_MQTT_CLIENT_TA_DISCONNECTED,
+} sl_mqtt_client_connection_state_t;
+
+typedef enum {
+  SL_MQTT_CLIENT_CONNECTED_EVENT,
+  SL_MQTT_CLIENT_DISCONNECTED_EVENT,
+  SL_MQTT_CLIENT_MESSAGE_PUBLISHED_EVENT,
+  SL_MQTT_CLIENT_SUBSCRIBED_EVENT,
+  SL_MQTT_CLIENT_UNSUBSCRIBED_EVENT,
+  SL_MQTT_CLIENT_MESSAGED_RECEIVED_EVENT,
+  SL_MQTT_CLIENT_ERROR_EVENT,
+} sl_mqtt_client_event_t;
+
+typedef enum {
+  SL_MQTT_CLIENT_CONNECT_FAILED,
+  SL_MQTT_CLIENT_DISCONNECT_FAILED,
+  SL_MQTT_CLIENT_PUBLISH_FAILED,
+  SL_MQTT_CLIENT_SUBSCRIBE_FAILED,
+  SL_MQTT_CLIENT_UNSUBSCRIBED_FAILED,
+  SL_MQTT_CLIENT_UNKNKOWN_ERROR,
+} sl_mqtt_client_error_status_t;
+
+typedef struct {
+  uint8_t type;
+  union {
+    struct {
+      uint32_t value;
+    } v4;
+    uint8_t v6[16];
+  } ip;
+} sl_ip_address_t;
+
+typedef struct {
+  void *node;
+} sl_slist_node_t;
+
+typedef struct {
+  uint8_t is_retained;
+  sl_mqtt_qos_t qos_level;
+  uint16_t packet_identifier;
+  uint8_t is_duplicate_message;
+  uint8_t *topic;
+  uint16_t topic_length;
+  uint8_t *content;
+  uint32_t content_length;
+} sl_mqtt_client_message_t;
+
+typedef void (*sl_mqtt_client_message_received_t)(void *client, sl_mqtt_client_message_t *message, void *context);
+typedef void (*sl_mqtt_client_event_handler_t)(void *client,
+                                               sl_mqtt_client_event_t event,
+                                               void *event_data,
+                                               void *context);
+
+typedef struct {
+  sl_slist_node_t next_subscription;
+  sl_mqtt_client_message_received_t topic_message_handler;
+  uint16_t topic_length;
+  uint8_t topic[];
+} sl_mqtt_client_topic_subscription_info_t;
+
+typedef struct {
+  sl_ip_address_t ip;
+  uint16_t port;
+  bool is_connection_encrypted;
+  uint16_t connect_timeout;
+  uint16_t keep_alive_interval;
+  uint16_t keep_alive_retries;
+} sl_mqtt_broker_t;
+
+typedef struct {
+  uint8_t is_retained;
+  sl_mqtt_qos_t will_qos_level;
+  uint8_t *will_topic;
+  uint16_t will_topic_length;
+  uint8_t *will_message;
+  uint32_t will_message_length;
+} sl_mqtt_client_last_will_message_t;
+
+typedef struct {
+  bool auto_reconnect;
+  uint8_t retry_count;
+  uint16_t minimum_back_off_time;
+  uint16_t maximum_back_off_time;
+  bool is_clean_session;
+  uint8_t *client_id;
+  uint8_t client_id_length;
+  uint32_t credential_id;
+  uint16_t client_port;
+} sl_mqtt_client_configuration_t;
+
+typedef struct {
+  uint16_t username_length;
+  uint16_t password_length;
+  uint8_t data[];
+} sl_mqtt_client_credentials_t;
+
+typedef struct {
+  sl_mqtt_client_connection_state_t state;
+  const sl_mqtt_broker_t *broker;
+  const sl_mqtt_client_last_will_message_t *last_will_message;
+  const sl_mqtt_client_configuration_t *client_configuration;
+  sl_mqtt_client_event_handler_t client_event_handler;
+  sl_mqtt_client_topic_subscription_info_t *subscription_list_head;
+} sl_mqtt_client_t;
+
+#endif /* HOST_STUB_SL_MQTT_CLIENT_TYPES_H_ */
@@ -0,0 +1,28 @@
+/*
+ * sl_net.h
+ *
+ * Host stand-in for the WiseConnect 3.1.4 header of the same name, credentials only.
+ */
+
+#ifndef HOST_STUB_SL_NET_H_
+#define HOST_STUB_SL_NET_H_
+
+#include <stdint.h>
+#include "sl_status.h"
+
+typedef uint32_t sl_net_credential_id_t;
+
+typedef enum {
+  SL_NET_SIGNING_CERTIFICATE,
+  SL_NET_MQTT_CLIENT_CREDENTIAL,
+  SL_NET_INVALID_CREDENTIAL_TYPE,
+} sl_net_credential_type_t;
+
+#define SL_NET_MQTT_CLIENT_CREDENTIAL_ID(x) (0x200 + (x))
+
+sl_status_t sl_net_get_credential(sl_net_credential_id_t id,
+                                  sl_net_credential_type_t *type,
+                                  void *credential,
+                                  uint32_t *credential_length);
+
+#endif /* HOST_STUB_SL_NET_H_ */
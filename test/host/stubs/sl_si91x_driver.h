@@ -0,0 +1,48 @@
+/*
+ * sl_si91x_driver.h
+ *
+ * Host stand-in for the WiseConnect 3.1.4 header of the same name.
+ * sl_si91x_driver_send_command() is the simulated firmware queue in sim_driver.c.
+ */
+
+#ifndef HOST_STUB_SL_SI91X_DRIVER_H_
+#define HOST_STUB_SL_SI91X_DRIVER_H_
+
+#include <stdint.h>
+#include "sl_status.h"
+#include "sl_utility.h"
+
+#define RSI_WLAN_REQ_EMB_MQTT_CLIENT 0xCB
+
+#define SL_IPV4               4
+#define SL_IPV6               6
+#define SL_IPV4_ADDRESS_LENGTH 4
+#define SL_IPV6_ADDRESS_LENGTH 16
+
+typedef enum {
+  SI91X_COMMON_CMD_QUEUE,
+  SI91X_WLAN_CMD_QUEUE,
+  SI91X_NETWORK_CMD_QUEUE,
+  SI91X_SOCKET_CMD_QUEUE,
+  SI91X_BT_CMD_QUEUE,
+} sl_si91x_queue_type_t;
+
+typedef uint32_t sl_si91x_wait_period_t;
+
+#define SL_SI91X_WAIT_FOR(x)        ((sl_si91x_wait_period_t)(x))
+#define SL_SI91X_RETURN_IMMEDIATELY ((sl_si91x_wait_period_t)0)
+
+typedef struct {
+  uint8_t desc[16];
+  uint8_t data[];
+} sl_si91x_packet_t;
+
+sl_status_t sl_si91x_driver_send_command(uint32_t command,
+                                         sl_si91x_queue_type_t queue_type,
+                                         const void *data,
+                                         uint32_t data_length,
+                                         sl_si91x_wait_period_t wait_period,
+                                         void *sdk_context,
+                                         void **data_buffer);
+
+#endif /* HOST_STUB_SL_SI91X_DRIVER_H_ */
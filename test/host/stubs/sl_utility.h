@@ -0,0 +1,12 @@
+/*
+ * sl_utility.h
+ *
+ * Host stand-in, only the constants header is needed.
+ */
+
+#ifndef HOST_STUB_SL_UTILITY_H_
+#define HOST_STUB_SL_UTILITY_H_
+
+#include "sl_constants.h"
+
+#endif /* HOST_STUB_SL_UTILITY_H_ */
@@ -0,0 +1,365 @@
+/*
+ * test_mqtt_ota.c
+ *
+ * Host test of the MQTT OTA receiver against the file backed flash: chunks dropped and reordered
+ * within the window, a resume after a disconnect and a corrupt chunk. The test plays the backend,
+ * acks are taken from mqtt_publish_queue_push() and lost chunks come back through the nack timer.
+ */
+
+#include "ota_file_flash.h"
+#include "ampak_wl72917/mqtt_ota.h"
+#include "ampak_wl72917/mqtt_publish_queue.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_ACK_WAIT_MS (MQTT_OTA_NACK_MS + 2000U)
+#define TEST_MAX_ROUNDS  32U
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if (!(condition)) {                                                    \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      failures++;                                                          \
+    }                                                                      \
+  } while (0)
+
+typedef struct {
+  uint32_t id;
+  uint32_t size;
+  uint64_t hash;
+  uint8_t *data;
+} test_image_t;
+
+typedef struct {
+  uint32_t drop_every;    /* drop every n-th first send of a chunk, 0 for none */
+  bool reverse;           /* send each window back to front */
+  uint32_t corrupt_chunk; /* chunk sent once with a flipped byte, UINT32_MAX for none */
+} test_link_t;
+
+static uint32_t failures;
+
+static pthread_mutex_t ack_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ack_changed;
+static uint32_t ack_count;
+static char ack_text[64];
+
+/**
+ *  Stand-in for the publish queue, the ack is all the backend sees
+ */
+sl_status_t mqtt_publish_queue_push(const char *topic,
+                                    const uint8_t *content,
+                                    uint16_t content_length,
+                                    uint8_t qos_level,
+                                    uint8_t is_retained,
+                                    uint8_t is_critical,
+                                    uint32_t ttl_ms)
+{
+  (void)topic;
+  (void)qos_level;
+  (void)is_retained;
+  (void)is_critical;
+  (void)ttl_ms;
+
+  pthread_mutex_lock(&ack_lock);
+  if (content_length >= sizeof(ack_text)) {
+    content_length = sizeof(ack_text) - 1U;
+  }
+  memcpy(ack_text, content, content_length);
+  ack_text[content_length] = '\0';
+  ack_count++;
+  pthread_cond_broadcast(&ack_changed);
+  pthread_mutex_unlock(&ack_lock);
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_si91x_fwup_start(uint8_t *rps_header)
+{
+  (void)rps_header;
+  return SL_STATUS_NOT_SUPPORTED;
+}
+
+sl_status_t sl_si91x_fwup_load(uint8_t *content, uint16_t length)
+{
+  (void)content;
+  (void)length;
+  return SL_STATUS_NOT_SUPPORTED;
+}
+
+static uint32_t acks_seen(void)
+{
+  pthread_mutex_lock(&ack_lock);
+  uint32_t count = ack_count;
+  pthread_mutex_unlock(&ack_lock);
+  return count;
+}
+
+/* wait for an ack after the first `seen`, copies the latest one */
+static bool wait_ack(uint32_t seen, char *text, size_t text_size)
+{
+  struct timespec deadline;
+  bool is_new;
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += TEST_ACK_WAIT_MS / 1000U;
+
+  pthread_mutex_lock(&ack_lock);
+  while (ack_count == seen) {
+    if (pthread_cond_timedwait(&ack_changed, &ack_lock, &deadline) != 0) {
+      break;
+    }
+  }
+  is_new = (ack_count != seen);
+  snprintf(text, text_size, "%s", ack_text);
+  pthread_mutex_unlock(&ack_lock);
+  return is_new;
+}
+
+static void put_u32(uint8_t *data, uint32_t value)
+{
+  data[0] = (uint8_t)value;
+  data[1] = (uint8_t)(value >> 8);
+  data[2] = (uint8_t)(value >> 16);
+  data[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t image_chunks(const test_image_t *image)
+{
+  return (image->size + MQTT_OTA_CHUNK_SIZE - 1U) / MQTT_OTA_CHUNK_SIZE;
+}
+
+static void image_create(test_image_t *image, uint32_t id, uint32_t size)
+{
+  uint32_t seed = id * 2654435761U;
+
+  image->id   = id;
+  image->size = size;
+  image->data = malloc(size);
+  image->hash = 0xCBF29CE484222325ULL;
+  for (uint32_t i = 0; i < size; i++) {
+    seed           = seed * 1103515245U + 12345U;
+    image->data[i] = (uint8_t)(seed >> 16);
+    image->hash ^= image->data[i];
+    image->hash *= 0x00000100000001B3ULL;
+  }
+}
+
+static void send_begin(const test_image_t *image)
+{
+  uint8_t frame[MQTT_OTA_HEADER_SIZE + 8U] = { MQTT_OTA_FRAME_BEGIN };
+
+  put_u32(&frame[4], image->id);
+  put_u32(&frame[8], image->size);
+  put_u32(&frame[12], (uint32_t)image->hash);
+  put_u32(&frame[16], (uint32_t)(image->hash >> 32));
+  mqtt_ota_on_message(frame, sizeof(frame));
+}
+
+static void send_chunk(const test_image_t *image, uint32_t index, bool corrupt)
+{
+  uint8_t frame[MQTT_OTA_HEADER_SIZE + MQTT_OTA_CHUNK_SIZE] = { MQTT_OTA_FRAME_CHUNK };
+  uint32_t offset = index * MQTT_OTA_CHUNK_SIZE;
+  uint32_t length = image->size - offset;
+
+  if (length > MQTT_OTA_CHUNK_SIZE) {
+    length = MQTT_OTA_CHUNK_SIZE;
+  }
+  frame[2] = (uint8_t)length;
+  frame[3] = (uint8_t)(length >> 8);
+  put_u32(&frame[4], image->id);
+  put_u32(&frame[8], index);
+  memcpy(&frame[MQTT_OTA_HEADER_SIZE], &image->data[offset], length);
+  if (corrupt) {
+    frame[MQTT_OTA_HEADER_SIZE] ^= 0x5A;
+  }
+  mqtt_ota_on_message(frame, MQTT_OTA_HEADER_SIZE + length);
+}
+
+/**
+ * Play the backend from `ack` on: resend what the window bitmap misses until done or fail.
+ * @return Final ack text in `ack`, false if the receiver went quiet.
+ */
+static bool run_backend(const test_image_t *image, const test_link_t *link, char *ack, size_t ack_size)
+{
+  uint32_t chunks      = image_chunks(image);
+  bool *sent           = calloc(chunks, sizeof(bool));
+  uint32_t first_sends = 0;
+  bool is_finished     = false;
+
+  for (uint32_t round = 0; round < TEST_MAX_ROUNDS && !is_finished; round++) {
+    uint32_t id, base, bitmap;
+    uint32_t missing[MQTT_OTA_WINDOW_CHUNKS];
+    uint32_t count = 0;
+
+    if (strncmp(ack, "done ", 5) == 0 || strncmp(ack, "fail ", 5) == 0) {
+      is_finished = true;
+      break;
+    }
+    if (sscanf(ack, "ack %x %u %x", &id, &base, &bitmap) != 3 || id != image->id) {
+      break;
+    }
+
+    for (uint32_t i = 0; i < MQTT_OTA_WINDOW_CHUNKS; i++) {
+      if (base + i < chunks && (bitmap & (1UL << i)) == 0) {
+        missing[count++] = base + i;
+      }
+    }
+
+    uint32_t seen = acks_seen();
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t index = missing[link->reverse ? count - 1U - i : i];
+      bool is_first  = !sent[index];
+
+      sent[index] = true;
+      if (is_first && link->drop_every != 0 && (++first_sends % link->drop_every) == 0) {
+        continue;
+      }
+      send_chunk(image, index, is_first && index == link->corrupt_chunk);
+    }
+    if (!wait_ack(seen, ack, ack_size)) {
+      break;
+    }
+  }
+
+  free(sent);
+  return is_finished;
+}
+
+static void wait_writer_idle(void)
+{
+  struct timespec pause = { 0, 50 * 1000000L };
+
+  nanosleep(&pause, NULL);
+}
+
+static void test_drops_and_reordering(void)
+{
+  test_image_t image;
+  test_link_t link = { .drop_every = 5, .reverse = true, .corrupt_chunk = UINT32_MAX };
+  mqtt_ota_status_t status;
+  ota_file_flash_stats_t flash;
+  char ack[64];
+
+  image_create(&image, 0x101, 3U * MQTT_OTA_SECTOR_SIZE + 1234U);
+
+  uint32_t seen = acks_seen();
+  send_begin(&image);
+  CHECK(wait_ack(seen, ack, sizeof(ack)));
+  CHECK(run_backend(&image, &link, ack, sizeof(ack)));
+  CHECK(strcmp(ack, "done 00000101") == 0);
+
+  mqtt_ota_get_status(&status);
+  ota_file_flash_get_stats(&flash);
+  CHECK(status.state == mqtt_ota_state_done);
+  CHECK(status.committed == image.size);
+  CHECK(status.chunks == image_chunks(&image));
+  CHECK(flash.finishes == 1);
+  CHECK(flash.violations == 0);
+  CHECK(ota_file_flash_holds(image.data, image.size));
+  free(image.data);
+}
+
+static void test_resume_after_disconnect(void)
+{
+  test_image_t image;
+  test_link_t link = { .drop_every = 0, .reverse = false, .corrupt_chunk = UINT32_MAX };
+  mqtt_ota_status_t start, before, status;
+  ota_file_flash_stats_t flash_before, flash;
+  uint32_t id, base, bitmap;
+  char ack[64];
+
+  image_create(&image, 0x202, 2U * MQTT_OTA_SECTOR_SIZE + 700U);
+  mqtt_ota_get_status(&start);
+
+  uint32_t seen = acks_seen();
+  send_begin(&image);
+  CHECK(wait_ack(seen, ack, sizeof(ack)));
+
+  // The first sector and half of the second, then the link goes away
+  seen = acks_seen();
+  for (uint32_t index = 0; index < MQTT_OTA_SECTOR_CHUNKS + MQTT_OTA_SECTOR_CHUNKS / 2U; index++) {
+    send_chunk(&image, index, false);
+  }
+  CHECK(wait_ack(seen, ack, sizeof(ack)));
+  wait_writer_idle();
+
+  mqtt_ota_get_status(&before);
+  ota_file_flash_get_stats(&flash_before);
+  CHECK(before.committed == MQTT_OTA_SECTOR_SIZE);
+
+  // Reconnected: the receiver says where to pick up, chunks it holds included
+  seen = acks_seen();
+  mqtt_ota_on_connected();
+  CHECK(wait_ack(seen, ack, sizeof(ack)));
+  CHECK(sscanf(ack, "ack %x %u %x", &id, &base, &bitmap) == 3);
+  CHECK(base == MQTT_OTA_SECTOR_CHUNKS);
+  CHECK((bitmap & ((1UL << (MQTT_OTA_SECTOR_CHUNKS / 2U)) - 1U)) == ((1UL << (MQTT_OTA_SECTOR_CHUNKS / 2U)) - 1U));
+
+  // The backend restarted too and begins again, the written sector is kept
+  seen = acks_seen();
+  send_begin(&image);
+  CHECK(wait_ack(seen, ack, sizeof(ack)));
+  CHECK(run_backend(&image, &link, ack, sizeof(ack)));
+  CHECK(strcmp(ack, "done 00000202") == 0);
+
+  mqtt_ota_get_status(&status);
+  ota_file_flash_get_stats(&flash);
+  CHECK(status.state == mqtt_ota_state_done);
+  CHECK(status.resumes - before.resumes == 1);
+  CHECK(status.chunks - start.chunks == image_chunks(&image));
+  CHECK(flash.begins == flash_before.begins);
+  CHECK(flash.violations == 0);
+  CHECK(ota_file_flash_holds(image.data, image.size));
+  free(image.data);
+}
+
+static void test_corrupt_chunk_never_completes(void)
+{
+  test_image_t image;
+  test_link_t link = { .drop_every = 0, .reverse = false, .corrupt_chunk = 5 };
+  mqtt_ota_status_t status;
+  ota_file_flash_stats_t flash_before, flash;
+  char ack[64];
+
+  image_create(&image, 0x303, 2U * MQTT_OTA_SECTOR_SIZE + 100U);
+  ota_file_flash_get_stats(&flash_before);
+
+  uint32_t seen = acks_seen();
+  send_begin(&image);
+  CHECK(wait_ack(seen, ack, sizeof(ack)));
+  CHECK(run_backend(&image, &link, ack, sizeof(ack)));
+  CHECK(strcmp(ack, "fail 00000303 0x0000002c") == 0);
+
+  mqtt_ota_get_status(&status);
+  ota_file_flash_get_stats(&flash);
+  CHECK(status.state == mqtt_ota_state_failed);
+  CHECK(status.committed < image.size);
+  CHECK(flash.finishes == flash_before.finishes);
+  CHECK(flash.violations == 0);
+  free(image.data);
+}
+
+int main(void)
+{
+  pthread_condattr_t condattr;
+
+  pthread_condattr_init(&condattr);
+  pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+  pthread_cond_init(&ack_changed, &condattr);
+
+  ota_file_flash_set_path("mqtt_ota_image.bin");
+  CHECK(mqtt_ota_init(&ota_file_flash, "ota/status", 1) == SL_STATUS_OK);
+
+  test_drops_and_reordering();
+  test_resume_after_disconnect();
+  test_corrupt_chunk_never_completes();
+
+  if (failures != 0) {
+    printf("%u check(s) failed\n", (unsigned)failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
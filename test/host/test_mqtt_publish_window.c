@@ -0,0 +1,223 @@
+/*
+ * test_mqtt_publish_window.c
+ *
+ * Host test of the publish window in the local sl_mqtt_client.c: BUSY deferral, control commands
+ * overtaking a publish backlog, the stale command timeout and the per class wait statistics.
+ */
+
+#include "sim_driver.h"
+#include "sl_mqtt_client.h"
+#include "ampak_wl72917/sl_mqtt_client_ext.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_BACKLOG    32U
+#define TEST_SERVICE_MS 10U
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if (!(condition)) {                                                    \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      failures++;                                                          \
+    }                                                                      \
+  } while (0)
+
+static uint32_t failures;
+static sl_mqtt_client_t client;
+static uint32_t published_events;
+
+static uint8_t telemetry_topic[] = "telemetry";
+static uint8_t telemetry_data[]  = "{\"t\":1}";
+static const uint8_t command_topic[] = "cmd";
+
+static void event_handler(void *client, sl_mqtt_client_event_t event, void *event_data, void *context)
+{
+  (void)client;
+  (void)event_data;
+  (void)context;
+
+  if (event == SL_MQTT_CLIENT_MESSAGE_PUBLISHED_EVENT) {
+    published_events++;
+  }
+}
+
+static void message_handler(void *client, sl_mqtt_client_message_t *message, void *context)
+{
+  (void)client;
+  (void)message;
+  (void)context;
+}
+
+static sl_status_t publish(void)
+{
+  sl_mqtt_client_message_t message = { 0 };
+
+  message.qos_level      = SL_MQTT_QOS_LEVEL_1;
+  message.topic          = telemetry_topic;
+  message.topic_length   = (uint16_t)strlen((const char *)telemetry_topic);
+  message.content        = telemetry_data;
+  message.content_length = (uint32_t)strlen((const char *)telemetry_data);
+
+  return sl_mqtt_client_publish(&client, &message, 0, NULL);
+}
+
+static sl_status_t subscribe(void)
+{
+  return sl_mqtt_client_subscribe(&client,
+                                  command_topic,
+                                  (uint16_t)strlen((const char *)command_topic),
+                                  SL_MQTT_QOS_LEVEL_1,
+                                  0,
+                                  message_handler,
+                                  NULL);
+}
+
+static sl_mqtt_client_command_stats_t stats_of(sl_mqtt_client_command_priority_t priority)
+{
+  sl_mqtt_client_command_stats_t stats;
+
+  sl_mqtt_client_get_command_stats(priority, &stats);
+  return stats;
+}
+
+static void drain(void)
+{
+  while (sim_complete_next()) {
+  }
+}
+
+// Submit from the backlog until the client defers, like mqtt_publish_queue does
+static uint32_t pump(uint32_t backlog)
+{
+  while (backlog > 0 && publish() == SL_STATUS_IN_PROGRESS) {
+    backlog--;
+  }
+  CHECK(stats_of(SL_MQTT_CLIENT_PRIORITY_PUBLISH).in_flight <= SL_MQTT_CLIENT_PUBLISH_WINDOW);
+  return backlog;
+}
+
+static void test_full_window_defers_publishes(void)
+{
+  sl_mqtt_client_command_stats_t before = stats_of(SL_MQTT_CLIENT_PRIORITY_PUBLISH);
+
+  for (uint32_t index = 0; index < SL_MQTT_CLIENT_PUBLISH_WINDOW; index++) {
+    CHECK(publish() == SL_STATUS_IN_PROGRESS);
+  }
+  CHECK(publish() == SL_STATUS_BUSY);
+  CHECK(sim_queue_length() == SL_MQTT_CLIENT_PUBLISH_WINDOW);
+
+  sl_mqtt_client_command_stats_t after = stats_of(SL_MQTT_CLIENT_PRIORITY_PUBLISH);
+  CHECK(after.deferred - before.deferred == 1);
+  CHECK(after.in_flight == SL_MQTT_CLIENT_PUBLISH_WINDOW);
+
+  // One completion reopens the window for one publish
+  CHECK(sim_complete_next());
+  CHECK(publish() == SL_STATUS_IN_PROGRESS);
+  CHECK(publish() == SL_STATUS_BUSY);
+
+  drain();
+  CHECK(stats_of(SL_MQTT_CLIENT_PRIORITY_PUBLISH).in_flight == 0);
+}
+
+static void test_control_command_closes_window(void)
+{
+  CHECK(subscribe() == SL_STATUS_IN_PROGRESS);
+  CHECK(publish() == SL_STATUS_BUSY);
+
+  drain();
+  CHECK(publish() == SL_STATUS_IN_PROGRESS);
+  drain();
+}
+
+static void test_control_latency_under_publish_load(void)
+{
+  sim_service_ms = TEST_SERVICE_MS;
+
+  // Without the window the whole backlog sits in the shared FIFO in front of the control command
+  for (uint32_t index = 0; index < TEST_BACKLOG; index++) {
+    sim_enqueue_raw();
+  }
+  uint32_t submitted_ms = sim_now_ms();
+  uint32_t control_id   = sim_enqueue_raw();
+  drain();
+  uint32_t fifo_wait_ms = sim_completed_at_ms(control_id) - submitted_ms;
+
+  sl_mqtt_client_command_stats_t control_before = stats_of(SL_MQTT_CLIENT_PRIORITY_CONTROL);
+  sl_mqtt_client_command_stats_t publish_before = stats_of(SL_MQTT_CLIENT_PRIORITY_PUBLISH);
+  uint32_t events_before                        = published_events;
+
+  uint32_t backlog = pump(TEST_BACKLOG);
+  CHECK(subscribe() == SL_STATUS_IN_PROGRESS);
+  while (sim_complete_next()) {
+    backlog = pump(backlog);
+  }
+  CHECK(backlog == 0);
+
+  sl_mqtt_client_command_stats_t control_after = stats_of(SL_MQTT_CLIENT_PRIORITY_CONTROL);
+  sl_mqtt_client_command_stats_t publish_after = stats_of(SL_MQTT_CLIENT_PRIORITY_PUBLISH);
+  uint32_t window_wait_ms                      = control_after.total_wait_ms - control_before.total_wait_ms;
+
+  printf("control wait behind %u publishes: %u ms in a plain FIFO, %u ms with the publish window\n",
+         (unsigned)TEST_BACKLOG,
+         (unsigned)fifo_wait_ms,
+         (unsigned)window_wait_ms);
+
+  CHECK(fifo_wait_ms == (TEST_BACKLOG + 1) * TEST_SERVICE_MS);
+  CHECK(window_wait_ms <= (SL_MQTT_CLIENT_PUBLISH_WINDOW + 1) * TEST_SERVICE_MS);
+  CHECK(window_wait_ms < fifo_wait_ms);
+
+  CHECK(control_after.submitted - control_before.submitted == 1);
+  CHECK(control_after.completed - control_before.completed == 1);
+  CHECK(control_after.max_wait_ms >= window_wait_ms);
+  CHECK(control_after.in_flight == 0);
+
+  CHECK(publish_after.submitted - publish_before.submitted == TEST_BACKLOG);
+  CHECK(publish_after.completed - publish_before.completed == TEST_BACKLOG);
+  CHECK(publish_after.deferred > publish_before.deferred);
+  CHECK(publish_after.in_flight == 0);
+  CHECK(publish_after.max_wait_ms <= (SL_MQTT_CLIENT_PUBLISH_WINDOW + 1) * TEST_SERVICE_MS);
+  CHECK(published_events - events_before == TEST_BACKLOG);
+}
+
+// Leaves lost commands tracked, keep it last
+static void test_stale_commands_stop_blocking(void)
+{
+  sl_mqtt_client_command_stats_t before = stats_of(SL_MQTT_CLIENT_PRIORITY_PUBLISH);
+
+  for (uint32_t index = 0; index < SL_MQTT_CLIENT_PUBLISH_WINDOW; index++) {
+    CHECK(publish() == SL_STATUS_IN_PROGRESS);
+  }
+  sim_lose_all();
+
+  CHECK(publish() == SL_STATUS_BUSY);
+  sim_advance_ms(SL_MQTT_CLIENT_INFLIGHT_STALE_MS - 1);
+  CHECK(publish() == SL_STATUS_BUSY);
+  sim_advance_ms(1);
+  CHECK(publish() == SL_STATUS_IN_PROGRESS);
+
+  // The new publish took over a stale slot, its completion is still matched
+  CHECK(sim_complete_next());
+  sl_mqtt_client_command_stats_t after = stats_of(SL_MQTT_CLIENT_PRIORITY_PUBLISH);
+  CHECK(after.completed - before.completed == 1);
+  CHECK(after.max_wait_ms >= before.max_wait_ms);
+  CHECK(after.in_flight == SL_MQTT_CLIENT_PUBLISH_WINDOW - 1);
+}
+
+int main(void)
+{
+  CHECK(sl_mqtt_client_init(&client, event_handler) == SL_STATUS_OK);
+  // The connect sequence is not under test
+  client.state = SL_MQTT_CLIENT_CONNECTED;
+
+  test_full_window_defers_publishes();
+  test_control_command_closes_window();
+  test_control_latency_under_publish_load();
+  test_stale_commands_stop_blocking();
+
+  if (failures != 0) {
+    printf("%u check(s) failed\n", (unsigned)failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
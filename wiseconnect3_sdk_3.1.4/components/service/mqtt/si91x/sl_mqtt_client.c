@@ -15,16 +15,18 @@
 *
 ******************************************************************************/
 #include "sl_net.h"
-#include "sl_slist.h"
 #include "sl_si91x_driver.h"
 #include "stdint.h"
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <string.h>
 #include "sl_mqtt_client.h"
 #include "sl_mqtt_client_types.h"
 #include "si91x_mqtt_client_types.h"
 #include "si91x_mqtt_client_utility.h"
 #include "sl_status.h"
+#include "cmsis_os2.h"
+#include "ampak_wl72917/sl_mqtt_client_ext.h"
 
 /**
  * MQTT CLIENT STATE MACHINE
@@ -54,6 +56,27 @@
 
 	*UNKOWN -> Throw Error
 	^ -> firmware events
+
+  Every state change goes through sli_si91x_set_client_state(), which checks it against
+  sli_si91x_state_transitions below and records it in the trace ring.
+
+  With a timeout of 0, connect() and disconnect() never wait: the first firmware command
+  (init / disconnect) is sent async and its completion in sli_si91x_mqtt_event_handler() sends
+  the second (connect / deinit). Only the second completion reaches the application.
+**/
+
+/**
+ * SUBSCRIPTION TABLE
+
+  The receive path (driver event thread) and the loopback path (publisher) look subscriptions
+  up while subscribe/unsubscribe and their completions change them from other tasks.
+
+  Readers never block. They enter by counting themselves in the reader counter of the current
+  epoch, load subscription_table, and leave by uncounting. A table is never modified once
+  published: writers, serialized by subscription_write_lock, build a copy, swap the pointer and
+  retire the old table (plus any removed node). The epoch only advances once every reader of the
+  previous epoch has left, so anything retired in epoch e is unreachable once the epoch moved on
+  and the counter of e drained. Retired tables are reclaimed on later table changes.
 **/
 
 // Declaring strtok_r as extern to suppress implicit declaration warning.
@@ -62,6 +85,9 @@ extern char *strtok_r(char *, const char *, char **);
 #define SI91X_MQTT_CLIENT_INIT_TIMEOUT       5000
 #define SI91X_MQTT_CLIENT_DISCONNECT_TIMEOUT 5000
 
+#define SI91X_MQTT_CLIENT_FNV_OFFSET 2166136261U
+#define SI91X_MQTT_CLIENT_FNV_PRIME  16777619U
+
 #define VERIFY_AND_RETURN_ERROR_IF_FALSE(condition, status) \
   {                                                         \
     do {                                                    \
@@ -72,21 +98,116 @@ extern char *strtok_r(char *, const char *, char **);
     } while (0);                                            \
   }
 
+typedef struct {
+  uint32_t topic_hash;
+  uint32_t content_hash;
+  uint32_t expected_ms;
+  volatile bool is_pending;
+} sli_si91x_loopback_echo_t;
+
+// A received message and the bytes it points to. The message must stay the first member,
+// handlers only see &rx_buffer->message.
+typedef struct {
+  sl_mqtt_client_message_t message;
+  atomic_uint reference_count;
+  uint8_t data[SL_MQTT_CLIENT_RX_BUFFER_SIZE];
+} sli_si91x_rx_buffer_t;
+
+// One published version of the subscriptions. The retired_* members are only used once the
+// table has been replaced and waits for its readers to leave.
+typedef struct sli_si91x_subscription_table_s {
+  struct sli_si91x_subscription_table_s *next_retired;
+  sl_mqtt_client_topic_subscription_info_t *retired_node; // node removed by the replacing table, freed with this one
+  uint32_t retired_epoch;
+  bool owns_entries; // replaced by an empty table, free every node with this one
+  uint32_t count;
+  sl_mqtt_client_topic_subscription_info_t *entries[];
+} sli_si91x_subscription_table_t;
+
+typedef struct {
+  const sl_si91x_mqtt_client_context_t *sdk_context; // NULL if the slot is free
+  uint32_t submit_ms;
+  sl_mqtt_client_command_priority_t priority;
+} sli_si91x_inflight_command_t;
+
+typedef struct {
+  sl_mqtt_client_connection_state_t from_state;
+  sl_mqtt_client_connection_state_t to_state;
+  sl_mqtt_client_trigger_t trigger;
+} sli_si91x_state_transition_t;
+
+typedef struct {
+  uint32_t connect_start;
+  uint32_t init_done;
+  uint32_t connack;
+  uint32_t first_suback;
+} sli_si91x_connect_timestamps_t;
+
+// The state machine above, one row per legal transition.
+static const sli_si91x_state_transition_t sli_si91x_state_transitions[] = {
+  { SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_TA_INIT, SL_MQTT_CLIENT_TRIGGER_CONNECT },
+  { SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_CONNECT },
+  { SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_TA_INIT, SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT },
+  { SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT },
+  { SL_MQTT_CLIENT_TA_INIT, SL_MQTT_CLIENT_CONNECTED, SL_MQTT_CLIENT_TRIGGER_CONNECT },
+  { SL_MQTT_CLIENT_TA_INIT, SL_MQTT_CLIENT_CONNECTION_FAILED, SL_MQTT_CLIENT_TRIGGER_CONNECT },
+  { SL_MQTT_CLIENT_TA_INIT, SL_MQTT_CLIENT_CONNECTED, SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT },
+  { SL_MQTT_CLIENT_TA_INIT, SL_MQTT_CLIENT_CONNECTION_FAILED, SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT },
+  { SL_MQTT_CLIENT_TA_INIT, SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_DISCONNECT },
+  { SL_MQTT_CLIENT_TA_INIT, SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT },
+  { SL_MQTT_CLIENT_CONNECTED, SL_MQTT_CLIENT_TA_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_DISCONNECT },
+  { SL_MQTT_CLIENT_CONNECTED, SL_MQTT_CLIENT_TA_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT },
+  { SL_MQTT_CLIENT_CONNECTED, SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT },
+  { SL_MQTT_CLIENT_CONNECTION_FAILED, SL_MQTT_CLIENT_TA_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_DISCONNECT },
+  { SL_MQTT_CLIENT_CONNECTION_FAILED, SL_MQTT_CLIENT_TA_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT },
+  { SL_MQTT_CLIENT_CONNECTION_FAILED, SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT },
+  { SL_MQTT_CLIENT_TA_DISCONNECTED, SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_DISCONNECT },
+  { SL_MQTT_CLIENT_TA_DISCONNECTED, SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT },
+};
+
 static sl_mqtt_client_t *mqtt_client;
+static sl_mqtt_client_loopback_policy_t loopback_policy = SL_MQTT_CLIENT_LOOPBACK_DISABLED;
+static sli_si91x_loopback_echo_t loopback_echoes[SL_MQTT_CLIENT_LOOPBACK_ECHO_SLOTS];
+static uint8_t loopback_echo_next;
+static sl_mqtt_client_state_trace_t state_trace[SL_MQTT_CLIENT_STATE_TRACE_SLOTS];
+static uint32_t state_trace_count;
+static sli_si91x_connect_timestamps_t connect_timestamps;
+static sli_si91x_rx_buffer_t rx_buffers[SL_MQTT_CLIENT_RX_BUFFER_COUNT];
+static sli_si91x_subscription_table_t *_Atomic subscription_table;
+static atomic_uint subscription_epoch;
+static atomic_uint subscription_readers[2];
+static sli_si91x_subscription_table_t *subscription_retired;
+static bool is_connect_chain_pending;
+static bool is_disconnect_chain_pending;
+// sdk_data of an async DISCONNECT command, its completion sends DEINIT.
+static uint8_t sli_si91x_pending_deinit;
+static sli_si91x_inflight_command_t inflight_commands[SL_MQTT_CLIENT_INFLIGHT_SLOTS];
+static sl_mqtt_client_command_stats_t command_stats[SL_MQTT_CLIENT_PRIORITY_COUNT];
+static osMutexId_t command_lock;
+static osMutexId_t subscription_write_lock;
+// Transitions come from the API caller's task and from the driver event handler.
+static osMutexId_t state_trace_lock;
+
 static sl_mqtt_client_error_status_t sli_si91x_get_event_error_status(sl_mqtt_client_event_t event);
+static void sli_si91x_lock(osMutexId_t mutex);
+static void sli_si91x_unlock(osMutexId_t mutex);
+static void sli_si91x_command_forget_all(void);
+static void sli_si91x_forget_loopback_echoes(void);
 /**
- * A internal helper function to get node of list which matches the given topic.
- * @param client 		Pointer to client object whose subscription list needs to be searched.
- * @param topic			Topic which needs to be searched in list.
+ * A internal helper function to get the subscription which matches the given topic.
+ * @param table 		Table from sli_si91x_subscription_read_begin() that needs to be searched.
+ * @param topic			Topic which needs to be searched in table.
  * @param topic_length	Length of the topic that needs to be searched.
- * @param required_node	A double pointer to node pointer.
+ * @param required_node	A double pointer to node pointer, valid until sli_si91x_subscription_read_end().
  */
-static void sli_si91x_get_subscription(const sl_mqtt_client_t *client,
+static void sli_si91x_get_subscription(const sli_si91x_subscription_table_t *table,
                                        const uint8_t *topic,
                                        const uint16_t topic_length,
                                        sl_mqtt_client_topic_subscription_info_t **required_subscription)
 {
-  sl_mqtt_client_topic_subscription_info_t *subscription = client->subscription_list_head;
+  uint32_t table_index = 0;
+  sl_mqtt_client_topic_subscription_info_t *subscription =
+    (table != NULL && table->count != 0) ? table->entries[0] : NULL;
 
   uint8_t subscribed_topic[SI91X_MQTT_CLIENT_TOPIC_MAXIMUM_LENGTH] = { 0 };
   uint8_t received_topic[SI91X_MQTT_CLIENT_TOPIC_MAXIMUM_LENGTH]   = { 0 };
@@ -152,20 +273,619 @@ static void sli_si91x_get_subscription(const sl_mqtt_client_t *client,
       }
     }
 
-    subscription = (sl_mqtt_client_topic_subscription_info_t *)subscription->next_subscription.node;
+    table_index++;
+    subscription = (table_index < table->count) ? table->entries[table_index] : NULL;
+  }
+}
+
+static uint32_t sli_si91x_now_ms(void)
+{
+  return (uint32_t)(((uint64_t)osKernelGetTickCount() * 1000U) / osKernelGetTickFreq());
+}
+
+/**
+ * A internal function through which every client state change goes.
+ * Transitions missing from sli_si91x_state_transitions are still applied, but flagged in the trace.
+ * @param client    Pointer to client object.
+ * @param state     New state.
+ * @param trigger   What caused the transition.
+ */
+static void sli_si91x_set_client_state(sl_mqtt_client_t *client,
+                                       sl_mqtt_client_connection_state_t state,
+                                       sl_mqtt_client_trigger_t trigger)
+{
+  uint32_t now     = sli_si91x_now_ms();
+  bool is_expected = false;
+
+  for (uint32_t index = 0; index < sizeof(sli_si91x_state_transitions) / sizeof(sli_si91x_state_transitions[0]);
+       index++) {
+    const sli_si91x_state_transition_t *transition = &sli_si91x_state_transitions[index];
+    if (transition->from_state == client->state && transition->to_state == state && transition->trigger == trigger) {
+      is_expected = true;
+      break;
+    }
+  }
+
+  if (!is_expected) {
+    SL_DEBUG_LOG("Unexpected MQTT client transition %d -> %d (trigger %d)\r\n", client->state, state, trigger);
+  }
+
+  sli_si91x_lock(state_trace_lock);
+  sl_mqtt_client_state_trace_t *record = &state_trace[state_trace_count % SL_MQTT_CLIENT_STATE_TRACE_SLOTS];
+  record->timestamp_ms                 = now;
+  record->from_state                   = (uint8_t)client->state;
+  record->to_state                     = (uint8_t)state;
+  record->trigger                      = (uint8_t)trigger;
+  record->is_expected                  = is_expected;
+  state_trace_count++;
+  sli_si91x_unlock(state_trace_lock);
+
+  if (state == SL_MQTT_CLIENT_TA_INIT) {
+    connect_timestamps.init_done = now;
+  } else if (state == SL_MQTT_CLIENT_CONNECTED && client->state != SL_MQTT_CLIENT_CONNECTED) {
+    connect_timestamps.connack = now;
+  } else if (state == SL_MQTT_CLIENT_DISCONNECTED) {
+    sli_si91x_command_forget_all();
+    sli_si91x_forget_loopback_echoes();
+  }
+
+  client->state = state;
+}
+
+uint32_t sl_mqtt_client_get_state_trace(sl_mqtt_client_state_trace_t *records, uint32_t max_records)
+{
+  sli_si91x_lock(state_trace_lock);
+  uint32_t count = state_trace_count < SL_MQTT_CLIENT_STATE_TRACE_SLOTS ? state_trace_count
+                                                                         : SL_MQTT_CLIENT_STATE_TRACE_SLOTS;
+  count          = count < max_records ? count : max_records;
+
+  for (uint32_t index = 0; index < count; index++) {
+    records[index] = state_trace[(state_trace_count - 1 - index) % SL_MQTT_CLIENT_STATE_TRACE_SLOTS];
+  }
+  sli_si91x_unlock(state_trace_lock);
+
+  return count;
+}
+
+sl_status_t sl_mqtt_client_get_connect_latency(sl_mqtt_client_connect_latency_t *latency)
+{
+  SL_VERIFY_POINTER_OR_RETURN(latency, SL_STATUS_WIFI_NULL_PTR_ARG);
+
+  sli_si91x_connect_timestamps_t timestamps = connect_timestamps;
+  uint32_t last                             = timestamps.connect_start;
+
+  memset(latency, 0, sizeof(*latency));
+  if (timestamps.connect_start == 0) {
+    return SL_STATUS_NOT_READY;
+  }
+
+  if (timestamps.init_done != 0) {
+    latency->firmware_init_ms = timestamps.init_done - timestamps.connect_start;
+    last                      = timestamps.init_done;
+  }
+  if (timestamps.connack != 0) {
+    latency->transport_connack_ms = timestamps.connack - last;
+    last                          = timestamps.connack;
+  }
+  if (timestamps.first_suback != 0) {
+    latency->first_suback_ms = timestamps.first_suback - last;
+    last                     = timestamps.first_suback;
+  }
+  latency->total_ms = last - timestamps.connect_start;
+
+  return SL_STATUS_OK;
+}
+
+/**
+ * A internal helper function to copy a received frame into a free receive buffer.
+ * @return Pool backed message holding one reference, or NULL if the pool is exhausted or the message does not fit.
+ */
+static sl_mqtt_client_message_t *sli_si91x_rx_buffer_fill(const sl_mqtt_client_message_t *source)
+{
+  const uint8_t *topic    = source->topic;
+  uint16_t topic_length   = source->topic_length;
+  const uint8_t *content  = source->content;
+  uint32_t content_length = source->content_length;
+
+  if ((uint32_t)topic_length + content_length > SL_MQTT_CLIENT_RX_BUFFER_SIZE) {
+    return NULL;
+  }
+
+  for (uint8_t index = 0; index < SL_MQTT_CLIENT_RX_BUFFER_COUNT; index++) {
+    sli_si91x_rx_buffer_t *rx_buffer = &rx_buffers[index];
+    unsigned int expected            = 0;
+
+    if (!atomic_compare_exchange_strong(&rx_buffer->reference_count, &expected, 1U)) {
+      continue;
+    }
+
+    memcpy(rx_buffer->data, topic, topic_length);
+    memcpy(&rx_buffer->data[topic_length], content, content_length);
+
+    rx_buffer->message                = *source;
+    rx_buffer->message.topic          = rx_buffer->data;
+    rx_buffer->message.topic_length   = topic_length;
+    rx_buffer->message.content        = &rx_buffer->data[topic_length];
+    rx_buffer->message.content_length = content_length;
+
+    return &rx_buffer->message;
+  }
+
+  return NULL;
+}
+
+// Context given to sl_mqtt_client_subscribe(), stored unaligned right after the topic.
+static void *sli_si91x_subscription_context(const sl_mqtt_client_topic_subscription_info_t *subscription)
+{
+  void *context;
+
+  memcpy(&context, &subscription->topic[subscription->topic_length], sizeof(context));
+  return context;
+}
+
+static sli_si91x_rx_buffer_t *sli_si91x_rx_buffer_from_message(sl_mqtt_client_message_t *message)
+{
+  sli_si91x_rx_buffer_t *rx_buffer = (sli_si91x_rx_buffer_t *)message;
+
+  if (rx_buffer < &rx_buffers[0] || rx_buffer >= &rx_buffers[SL_MQTT_CLIENT_RX_BUFFER_COUNT]) {
+    return NULL;
+  }
+  return rx_buffer;
+}
+
+sl_mqtt_client_message_t *sl_mqtt_client_message_retain(sl_mqtt_client_message_t *message)
+{
+  if (message == NULL) {
+    return NULL;
+  }
+
+  sli_si91x_rx_buffer_t *rx_buffer = sli_si91x_rx_buffer_from_message(message);
+  if (rx_buffer == NULL) {
+    return NULL;
+  }
+
+  // Only legal while a reference is held, so the count can not be 0 here.
+  atomic_fetch_add(&rx_buffer->reference_count, 1U);
+  return message;
+}
+
+void sl_mqtt_client_message_release(sl_mqtt_client_message_t *message)
+{
+  if (message == NULL) {
+    return;
+  }
+
+  sli_si91x_rx_buffer_t *rx_buffer = sli_si91x_rx_buffer_from_message(message);
+  if (rx_buffer == NULL) {
+    return;
+  }
+
+  atomic_fetch_sub(&rx_buffer->reference_count, 1U);
+}
+
+/**
+ * A internal helper function to enter a subscription table read section. Never blocks.
+ * @param epoch  Filled with the epoch to hand to sli_si91x_subscription_read_end().
+ * @return Current table, NULL if there are no subscriptions.
+ */
+static const sli_si91x_subscription_table_t *sli_si91x_subscription_read_begin(uint32_t *epoch)
+{
+  while (1) {
+    *epoch = atomic_load(&subscription_epoch);
+    atomic_fetch_add(&subscription_readers[*epoch & 1U], 1U);
+
+    // If the epoch moved on before we were counted, nobody waits on this counter for us. Count again.
+    if (atomic_load(&subscription_epoch) == *epoch) {
+      return atomic_load(&subscription_table);
+    }
+    atomic_fetch_sub(&subscription_readers[*epoch & 1U], 1U);
+  }
+}
+
+static void sli_si91x_subscription_read_end(uint32_t epoch)
+{
+  atomic_fetch_sub(&subscription_readers[epoch & 1U], 1U);
+}
+
+static void sli_si91x_lock(osMutexId_t mutex)
+{
+  if (mutex != NULL) {
+    osMutexAcquire(mutex, osWaitForever);
+  }
+}
+
+static void sli_si91x_unlock(osMutexId_t mutex)
+{
+  if (mutex != NULL) {
+    osMutexRelease(mutex);
+  }
+}
+
+/**
+ * A internal helper function to advance the epoch when possible and free retired tables no reader can hold.
+ * Called with subscription_write_lock held.
+ */
+static void sli_si91x_subscription_reclaim(void)
+{
+  uint32_t epoch = atomic_load(&subscription_epoch);
+
+  // Readers of the previous epoch share the next epoch's counter, they must be gone before it is reused.
+  if (atomic_load(&subscription_readers[(epoch + 1U) & 1U]) == 0) {
+    epoch++;
+    atomic_store(&subscription_epoch, epoch);
+  }
+
+  sli_si91x_subscription_table_t **link = &subscription_retired;
+  while (*link != NULL) {
+    sli_si91x_subscription_table_t *retired = *link;
+
+    if (retired->retired_epoch == epoch || atomic_load(&subscription_readers[retired->retired_epoch & 1U]) != 0) {
+      link = &retired->next_retired;
+      continue;
+    }
+
+    *link = retired->next_retired;
+    if (retired->owns_entries) {
+      for (uint32_t index = 0; index < retired->count; index++) {
+        free(retired->entries[index]);
+      }
+    }
+    free(retired->retired_node);
+    free(retired);
+  }
+}
+
+/**
+ * A internal helper function to queue a replaced table for freeing. Called with subscription_write_lock held.
+ * @param table         Table that was just replaced in subscription_table.
+ * @param node          Node the replacement dropped, or NULL.
+ * @param owns_entries  true if every node of the table was dropped.
+ */
+static void sli_si91x_subscription_retire(sli_si91x_subscription_table_t *table,
+                                          sl_mqtt_client_topic_subscription_info_t *node,
+                                          bool owns_entries)
+{
+  table->retired_node  = node;
+  table->owns_entries  = owns_entries;
+  table->retired_epoch = atomic_load(&subscription_epoch);
+  table->next_retired  = subscription_retired;
+  subscription_retired = table;
+
+  sli_si91x_subscription_reclaim();
+}
+
+/**
+ * A internal helper function to publish a table with the given subscription added.
+ */
+static sl_status_t sli_si91x_subscription_add(sl_mqtt_client_topic_subscription_info_t *subscription)
+{
+  sli_si91x_lock(subscription_write_lock);
+
+  sli_si91x_subscription_table_t *old_table = atomic_load(&subscription_table);
+  uint32_t count                            = (old_table != NULL) ? old_table->count : 0;
+  sli_si91x_subscription_table_t *new_table =
+    calloc(sizeof(sli_si91x_subscription_table_t) + (count + 1) * sizeof(subscription), 1);
+
+  if (new_table == NULL) {
+    sli_si91x_unlock(subscription_write_lock);
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+
+  // Newest first, the order matching used to see with sl_slist_push().
+  new_table->entries[0] = subscription;
+  if (count != 0) {
+    memcpy(&new_table->entries[1], old_table->entries, count * sizeof(subscription));
+  }
+  new_table->count = count + 1;
+
+  atomic_store(&subscription_table, new_table);
+  if (old_table != NULL) {
+    sli_si91x_subscription_retire(old_table, NULL, false);
+  }
+
+  sli_si91x_unlock(subscription_write_lock);
+  return SL_STATUS_OK;
+}
+
+/**
+ * A internal helper function to publish a table without the given subscription. The node is freed once unreachable.
+ * @return false if the subscription is not in the table or no memory was available, the node is then not freed.
+ */
+static bool sli_si91x_subscription_remove(sl_mqtt_client_topic_subscription_info_t *subscription)
+{
+  sli_si91x_lock(subscription_write_lock);
+
+  sli_si91x_subscription_table_t *old_table = atomic_load(&subscription_table);
+  sli_si91x_subscription_table_t *new_table = NULL;
+  uint32_t position                         = 0;
+
+  while (old_table != NULL && position < old_table->count && old_table->entries[position] != subscription) {
+    position++;
+  }
+  if (old_table == NULL || position == old_table->count) {
+    sli_si91x_unlock(subscription_write_lock);
+    return false;
+  }
+
+  if (old_table->count > 1) {
+    new_table = calloc(sizeof(sli_si91x_subscription_table_t) + (old_table->count - 1) * sizeof(subscription), 1);
+    if (new_table == NULL) {
+      sli_si91x_unlock(subscription_write_lock);
+      return false;
+    }
+
+    memcpy(new_table->entries, old_table->entries, position * sizeof(subscription));
+    memcpy(&new_table->entries[position],
+           &old_table->entries[position + 1],
+           (old_table->count - position - 1) * sizeof(subscription));
+    new_table->count = old_table->count - 1;
+  }
+
+  atomic_store(&subscription_table, new_table);
+  sli_si91x_subscription_retire(old_table, subscription, false);
+
+  sli_si91x_unlock(subscription_write_lock);
+  return true;
+}
+
+static void sli_si91x_record_wait(sl_mqtt_client_command_stats_t *stats, uint32_t wait_ms)
+{
+  stats->completed++;
+  stats->total_wait_ms += wait_ms;
+  if (wait_ms > stats->max_wait_ms) {
+    stats->max_wait_ms = wait_ms;
+  }
+}
+
+/**
+ * A internal helper function through which every firmware MQTT command is sent.
+ * Async commands are tracked from before submission, so a completion racing the return is still matched.
+ * @param priority     Submission class, selects the statistics and the publish gating.
+ * @param sdk_context  Context of an async command, NULL for a blocking one.
+ */
+static sl_status_t sli_si91x_send_command(sl_mqtt_client_command_priority_t priority,
+                                          const void *data,
+                                          uint32_t data_length,
+                                          sl_si91x_wait_period_t wait_period,
+                                          sl_si91x_mqtt_client_context_t *sdk_context)
+{
+  sl_status_t status;
+  uint32_t submit_ms                     = sli_si91x_now_ms();
+  sli_si91x_inflight_command_t *inflight = NULL;
+  sl_mqtt_client_command_stats_t *stats  = &command_stats[priority];
+
+  sli_si91x_lock(command_lock);
+  if (sdk_context != NULL) {
+    for (uint8_t index = 0; index < SL_MQTT_CLIENT_INFLIGHT_SLOTS; index++) {
+      sli_si91x_inflight_command_t *slot = &inflight_commands[index];
+      if (slot->sdk_context == NULL
+          || (uint32_t)(submit_ms - slot->submit_ms) >= SL_MQTT_CLIENT_INFLIGHT_STALE_MS) {
+        if (slot->sdk_context != NULL) {
+          command_stats[slot->priority].in_flight--;
+        }
+        inflight              = slot;
+        inflight->sdk_context = sdk_context;
+        inflight->submit_ms   = submit_ms;
+        inflight->priority    = priority;
+        stats->in_flight++;
+        break;
+      }
+    }
+  }
+  stats->submitted++;
+  sli_si91x_unlock(command_lock);
+
+  status = sl_si91x_driver_send_command(RSI_WLAN_REQ_EMB_MQTT_CLIENT,
+                                        SI91X_NETWORK_CMD_QUEUE,
+                                        data,
+                                        data_length,
+                                        wait_period,
+                                        sdk_context,
+                                        NULL);
+
+  sli_si91x_lock(command_lock);
+  if (status != SL_STATUS_IN_PROGRESS && inflight != NULL && inflight->sdk_context == sdk_context) {
+    inflight->sdk_context = NULL;
+    stats->in_flight--;
+  }
+  if (sdk_context == NULL && status == SL_STATUS_OK) {
+    sli_si91x_record_wait(stats, sli_si91x_now_ms() - submit_ms);
+  }
+  sli_si91x_unlock(command_lock);
+
+  return status;
+}
+
+/**
+ * A internal helper function to match a firmware response to its tracked submission.
+ * Unsolicited events (received messages, broker disconnects) match nothing.
+ */
+static void sli_si91x_command_completed(const sl_si91x_mqtt_client_context_t *sdk_context)
+{
+  sli_si91x_lock(command_lock);
+  for (uint8_t index = 0; index < SL_MQTT_CLIENT_INFLIGHT_SLOTS; index++) {
+    sli_si91x_inflight_command_t *slot = &inflight_commands[index];
+    if (slot->sdk_context == sdk_context) {
+      slot->sdk_context = NULL;
+      command_stats[slot->priority].in_flight--;
+      sli_si91x_record_wait(&command_stats[slot->priority], sli_si91x_now_ms() - slot->submit_ms);
+      break;
+    }
+  }
+  sli_si91x_unlock(command_lock);
+}
+
+/**
+ * A internal helper function to forget every tracked command, their completions will not come once disconnected.
+ */
+static void sli_si91x_command_forget_all(void)
+{
+  sli_si91x_lock(command_lock);
+  for (uint8_t index = 0; index < SL_MQTT_CLIENT_INFLIGHT_SLOTS; index++) {
+    inflight_commands[index].sdk_context = NULL;
+  }
+  for (uint8_t priority = 0; priority < SL_MQTT_CLIENT_PRIORITY_COUNT; priority++) {
+    command_stats[priority].in_flight = 0;
+  }
+  sli_si91x_unlock(command_lock);
+}
+
+/**
+ * A internal helper function deciding whether an async publish may enter the shared driver queue now.
+ * @return false, and counts a deferral, while a control command or a full window of publishes is in flight.
+ */
+static bool sli_si91x_is_publish_window_open(void)
+{
+  uint32_t now                                      = sli_si91x_now_ms();
+  uint32_t in_flight[SL_MQTT_CLIENT_PRIORITY_COUNT] = { 0 };
+  bool is_open;
+
+  sli_si91x_lock(command_lock);
+  for (uint8_t index = 0; index < SL_MQTT_CLIENT_INFLIGHT_SLOTS; index++) {
+    const sli_si91x_inflight_command_t *slot = &inflight_commands[index];
+    if (slot->sdk_context != NULL && (uint32_t)(now - slot->submit_ms) < SL_MQTT_CLIENT_INFLIGHT_STALE_MS) {
+      in_flight[slot->priority]++;
+    }
+  }
+
+  is_open = (in_flight[SL_MQTT_CLIENT_PRIORITY_CONTROL] == 0)
+            && (in_flight[SL_MQTT_CLIENT_PRIORITY_PUBLISH] < SL_MQTT_CLIENT_PUBLISH_WINDOW);
+  if (!is_open) {
+    command_stats[SL_MQTT_CLIENT_PRIORITY_PUBLISH].deferred++;
+  }
+  sli_si91x_unlock(command_lock);
+
+  return is_open;
+}
+
+sl_status_t sl_mqtt_client_get_command_stats(sl_mqtt_client_command_priority_t priority,
+                                             sl_mqtt_client_command_stats_t *stats)
+{
+  SL_VERIFY_POINTER_OR_RETURN(stats, SL_STATUS_WIFI_NULL_PTR_ARG);
+  VERIFY_AND_RETURN_ERROR_IF_FALSE(priority < SL_MQTT_CLIENT_PRIORITY_COUNT, SL_STATUS_INVALID_PARAMETER);
+
+  sli_si91x_lock(command_lock);
+  *stats = command_stats[priority];
+  sli_si91x_unlock(command_lock);
+
+  return SL_STATUS_OK;
+}
+
+static uint32_t sli_si91x_hash(const uint8_t *data, uint32_t length)
+{
+  uint32_t hash = SI91X_MQTT_CLIENT_FNV_OFFSET;
+
+  for (uint32_t index = 0; index < length; index++) {
+    hash ^= data[index];
+    hash *= SI91X_MQTT_CLIENT_FNV_PRIME;
+  }
+  return hash;
+}
+
+/**
+ * A internal helper function to hand a publish straight to the client's own matching subscription.
+ * The message goes through a receive buffer like a received one, so handlers can retain it.
+ * @param client   Pointer to client object.
+ * @param message  Message being published.
+ * @return true if a local subscription received the message, false if there is none or the
+ *         receive pool is exhausted; the publish then only goes upstream.
+ */
+static bool sli_si91x_deliver_locally(sl_mqtt_client_t *client, const sl_mqtt_client_message_t *message)
+{
+  sl_mqtt_client_topic_subscription_info_t *subscription;
+  uint32_t epoch;
+  const sli_si91x_subscription_table_t *table = sli_si91x_subscription_read_begin(&epoch);
+  sl_mqtt_client_message_t *pooled_message    = NULL;
+
+  sli_si91x_get_subscription(table, message->topic, message->topic_length, &subscription);
+  if (subscription != NULL) {
+    pooled_message = sli_si91x_rx_buffer_fill(message);
   }
+  if (pooled_message != NULL) {
+    subscription->topic_message_handler(client, pooled_message, sli_si91x_subscription_context(subscription));
+    sl_mqtt_client_message_release(pooled_message);
+  }
+
+  sli_si91x_subscription_read_end(epoch);
+  return (pooled_message != NULL);
 }
 
-static void sli_si91x_remove_and_free_all_subscriptions(sl_mqtt_client_t *client)
+/**
+ * A internal helper function to remember a looped back message so its echo from the broker can be dropped.
+ * @return The entry, to be cancelled if the publish never reaches the broker.
+ */
+static sli_si91x_loopback_echo_t *sli_si91x_expect_loopback_echo(const sl_mqtt_client_message_t *message)
 {
-  // Free subscription list.
-  sl_mqtt_client_topic_subscription_info_t *node_to_be_freed;
-  while ((node_to_be_freed = (sl_mqtt_client_topic_subscription_info_t *)(sl_slist_pop(
-            (sl_slist_node_t **)&client->subscription_list_head)))
-         != NULL) {
-    free(node_to_be_freed);
+  sli_si91x_loopback_echo_t *echo = &loopback_echoes[loopback_echo_next];
+
+  loopback_echo_next = (loopback_echo_next + 1) % SL_MQTT_CLIENT_LOOPBACK_ECHO_SLOTS;
+
+  echo->is_pending   = false;
+  echo->topic_hash   = sli_si91x_hash(message->topic, message->topic_length);
+  echo->content_hash = sli_si91x_hash(message->content, message->content_length);
+  echo->expected_ms  = sli_si91x_now_ms();
+  echo->is_pending   = true;
+  return echo;
+}
+
+/**
+ * A internal helper function to drop all pending echoes, none can arrive once the session is gone.
+ */
+static void sli_si91x_forget_loopback_echoes(void)
+{
+  for (uint8_t index = 0; index < SL_MQTT_CLIENT_LOOPBACK_ECHO_SLOTS; index++) {
+    loopback_echoes[index].is_pending = false;
   }
 }
+
+/**
+ * A internal helper function to check, and consume, a pending loopback echo for a received message.
+ */
+static bool sli_si91x_is_loopback_echo(const sl_mqtt_client_message_t *message)
+{
+  uint32_t topic_hash   = 0;
+  uint32_t content_hash = 0;
+  bool is_hashed        = false;
+  uint32_t now          = sli_si91x_now_ms();
+
+  for (uint8_t index = 0; index < SL_MQTT_CLIENT_LOOPBACK_ECHO_SLOTS; index++) {
+    sli_si91x_loopback_echo_t *echo = &loopback_echoes[index];
+
+    if (!echo->is_pending) {
+      continue;
+    }
+    // An echo this late is not coming (no broker side subscription, QoS 0 loss), a match now is another publisher.
+    if (now - echo->expected_ms > SL_MQTT_CLIENT_LOOPBACK_ECHO_TTL_MS) {
+      echo->is_pending = false;
+      continue;
+    }
+
+    if (!is_hashed) {
+      topic_hash   = sli_si91x_hash(message->topic, message->topic_length);
+      content_hash = sli_si91x_hash(message->content, message->content_length);
+      is_hashed    = true;
+    }
+
+    if (echo->topic_hash == topic_hash && echo->content_hash == content_hash) {
+      echo->is_pending = false;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void sli_si91x_remove_and_free_all_subscriptions(void)
+{
+  sli_si91x_lock(subscription_write_lock);
+  sli_si91x_subscription_table_t *old_table = atomic_load(&subscription_table);
+
+  if (old_table != NULL) {
+    atomic_store(&subscription_table, NULL);
+    sli_si91x_subscription_retire(old_table, NULL, true);
+  }
+  sli_si91x_unlock(subscription_write_lock);
+}
 static inline bool is_connect_previously_called(sl_mqtt_client_t *client)
 {
   return (NULL != client->client_configuration);
@@ -297,12 +1017,16 @@ static sl_status_t sli_si91x_fetch_mqtt_client_credentials(sl_net_credential_id_
  * 
  * @param client[in]        Pointer to the MQTT client object.
  * @param credentials[out]   Pointer to the MQTT client credentials.
+ * @param timeout[in]        Time to wait for the response in ms, 0 to return immediately.
+ * @param sdk_context[in]    Context for the asynchronous response, NULL when timeout is not 0.
  *
  * @return
  *   sl_status_t. See https://docs.silabs.com/gecko-platform/4.1/common/api/group-status for details.
  */
 static sl_status_t sli_si91x_send_firmware_mqtt_init(sl_mqtt_client_t *client,
-                                                     sl_mqtt_client_credentials_t *credentials)
+                                                     sl_mqtt_client_credentials_t *credentials,
+                                                     uint32_t timeout,
+                                                     sl_si91x_mqtt_client_context_t *sdk_context)
 {
 
   si91x_mqtt_client_init_request_t si91x_init_request = { 0 };
@@ -337,13 +1061,68 @@ static sl_status_t sli_si91x_send_firmware_mqtt_init(sl_mqtt_client_t *client,
     si91x_init_request.password_len = credentials->password_length;
   }
 
-  return sl_si91x_driver_send_command(RSI_WLAN_REQ_EMB_MQTT_CLIENT,
-                                      SI91X_NETWORK_CMD_QUEUE,
-                                      &si91x_init_request,
-                                      sizeof(si91x_init_request),
-                                      SL_SI91X_WAIT_FOR(SI91X_MQTT_CLIENT_INIT_TIMEOUT),
-                                      NULL,
-                                      NULL);
+  return sli_si91x_send_command(SL_MQTT_CLIENT_PRIORITY_CONTROL,
+                                &si91x_init_request,
+                                sizeof(si91x_init_request),
+                                timeout == 0 ? SL_SI91X_RETURN_IMMEDIATELY : SL_SI91X_WAIT_FOR(timeout),
+                                sdk_context);
+}
+
+/**
+ * A internal helper function to send the firmware deinit command, the second half of disconnect().
+ * @param timeout  Time to wait in ms, 0 to complete through SL_MQTT_CLIENT_DISCONNECTED_EVENT.
+ */
+static sl_status_t sli_si91x_send_deinit(sl_mqtt_client_t *client, uint32_t timeout)
+{
+  sl_status_t status;
+  sl_si91x_mqtt_client_context_t *sdk_context              = NULL;
+  si91x_mqtt_client_command_request_t si91x_deinit_request = { .command_type = SI91X_MQTT_CLIENT_DEINIT_COMMAND };
+
+  status = sli_si91x_build_mqtt_sdk_context_if_async(SL_MQTT_CLIENT_DISCONNECTED_EVENT,
+                                                     client,
+                                                     NULL,
+                                                     NULL,
+                                                     timeout,
+                                                     &sdk_context);
+  VERIFY_STATUS_AND_RETURN(status);
+
+  status = sli_si91x_send_command(SL_MQTT_CLIENT_PRIORITY_CONTROL,
+                                  &si91x_deinit_request,
+                                  sizeof(si91x_deinit_request),
+                                  timeout <= 0 ? SL_SI91X_RETURN_IMMEDIATELY : SL_SI91X_WAIT_FOR(timeout),
+                                  sdk_context);
+
+  if (status != SL_STATUS_IN_PROGRESS && status != SL_STATUS_OK) {
+    SL_CLEANUP_MALLOC(sdk_context);
+  }
+  return status;
+}
+
+/**
+ * A internal helper function to send the connect request held back until the async init completed.
+ * @param pending_connect  Connect request built by connect(), freed here.
+ */
+static sl_status_t sli_si91x_send_pending_connect(sl_mqtt_client_t *client,
+                                                  si91x_mqtt_client_connect_request_t *pending_connect)
+{
+  sl_status_t status;
+  sl_si91x_mqtt_client_context_t *sdk_context = NULL;
+
+  status = sli_si91x_build_mqtt_sdk_context_if_async(SL_MQTT_CLIENT_CONNECTED_EVENT, client, NULL, NULL, 0, &sdk_context);
+
+  if (status == SL_STATUS_OK) {
+    status = sli_si91x_send_command(SL_MQTT_CLIENT_PRIORITY_CONTROL,
+                                    pending_connect,
+                                    sizeof(si91x_mqtt_client_connect_request_t),
+                                    SL_SI91X_RETURN_IMMEDIATELY,
+                                    sdk_context);
+    if (status != SL_STATUS_IN_PROGRESS) {
+      SL_CLEANUP_MALLOC(sdk_context);
+    }
+  }
+
+  free(pending_connect);
+  return status;
 }
 
 sl_status_t sl_mqtt_client_init(sl_mqtt_client_t *client, sl_mqtt_client_event_handler_t event_handler)
@@ -351,12 +1130,33 @@ sl_status_t sl_mqtt_client_init(sl_mqtt_client_t *client, sl_mqtt_client_event_h
   SL_VERIFY_POINTER_OR_RETURN(event_handler, SL_STATUS_WIFI_NULL_PTR_ARG);
 
   client->client_event_handler = event_handler;
-  sl_slist_init((sl_slist_node_t **)&client->subscription_list_head);
+
+  if (subscription_write_lock == NULL) {
+    subscription_write_lock = osMutexNew(NULL);
+    VERIFY_AND_RETURN_ERROR_IF_FALSE(subscription_write_lock != NULL, SL_STATUS_ALLOCATION_FAILED);
+  }
+  if (command_lock == NULL) {
+    command_lock = osMutexNew(NULL);
+    VERIFY_AND_RETURN_ERROR_IF_FALSE(command_lock != NULL, SL_STATUS_ALLOCATION_FAILED);
+  }
+  if (state_trace_lock == NULL) {
+    state_trace_lock = osMutexNew(NULL);
+    VERIFY_AND_RETURN_ERROR_IF_FALSE(state_trace_lock != NULL, SL_STATUS_ALLOCATION_FAILED);
+  }
 
   mqtt_client = client;
   return SL_STATUS_OK;
 }
 
+sl_status_t sl_mqtt_client_set_loopback_policy(sl_mqtt_client_t *client, sl_mqtt_client_loopback_policy_t policy)
+{
+  SL_VERIFY_POINTER_OR_RETURN(client, SL_STATUS_WIFI_NULL_PTR_ARG);
+  VERIFY_AND_RETURN_ERROR_IF_FALSE(policy <= SL_MQTT_CLIENT_LOOPBACK_LOCAL_ONLY, SL_STATUS_INVALID_PARAMETER);
+
+  loopback_policy = policy;
+  return SL_STATUS_OK;
+}
+
 sl_status_t sl_mqtt_client_deinit(sl_mqtt_client_t *client)
 {
 
@@ -378,6 +1178,7 @@ sl_status_t sl_mqtt_client_connect(sl_mqtt_client_t *client,
   VERIFY_AND_RETURN_ERROR_IF_FALSE(
     (client->state == SL_MQTT_CLIENT_DISCONNECTED || client->state == SL_MQTT_CLIENT_TA_INIT),
     SL_STATUS_INVALID_STATE);
+  VERIFY_AND_RETURN_ERROR_IF_FALSE(!is_connect_chain_pending && !is_disconnect_chain_pending, SL_STATUS_BUSY);
 
   // check if this the first time connect() call being made,
   // In subsequent calls it not mandatory to pass parameters as we store them in client structure
@@ -410,29 +1211,11 @@ sl_status_t sl_mqtt_client_connect(sl_mqtt_client_t *client,
     return status;
   }
 
-  // Host connect() call maps to two commands in firmware, init() and connect()
-  // since we can't send(At least with current design) two command in aysnc mode,
-  // We send init command in sync mode, whereas, connect will be sent as async
-  if (client->state == SL_MQTT_CLIENT_DISCONNECTED) {
-    status = sli_si91x_send_firmware_mqtt_init(client, credentials);
-
-    if (status != SL_STATUS_OK) {
-      SL_CLEANUP_MALLOC(credentials);
-
-      client->state = SL_MQTT_CLIENT_DISCONNECTED;
-      return status;
-    }
-
-    client->state = SL_MQTT_CLIENT_TA_INIT;
-  }
-
   si91x_connect_request.command_type = SI91X_MQTT_CLIENT_CONNECT_COMMAND;
   // TA takes the username and password from init_request and validation bit from the connect request.
   if (credentials != NULL) {
     si91x_connect_request.is_password_present = 1;
     si91x_connect_request.is_username_present = 1;
-
-    SL_CLEANUP_MALLOC(credentials);
   }
 
   if (client->last_will_message != NULL) {
@@ -451,6 +1234,61 @@ sl_status_t sl_mqtt_client_connect(sl_mqtt_client_t *client,
     si91x_connect_request.will_flag = 1;
   }
 
+  // Host connect() call maps to two commands in firmware, init() and connect().
+  // Blocking calls send init in sync mode. Non blocking calls send init async and carry the
+  // connect request in sdk_data, the init completion sends it (see sli_si91x_send_pending_connect()).
+  if (client->state == SL_MQTT_CLIENT_DISCONNECTED) {
+    memset(&connect_timestamps, 0, sizeof(connect_timestamps));
+    connect_timestamps.connect_start = sli_si91x_now_ms();
+
+    if (connect_timeout == 0) {
+      si91x_mqtt_client_connect_request_t *pending_connect = malloc(sizeof(si91x_mqtt_client_connect_request_t));
+      if (pending_connect == NULL) {
+        SL_CLEANUP_MALLOC(credentials);
+        return SL_STATUS_ALLOCATION_FAILED;
+      }
+      memcpy(pending_connect, &si91x_connect_request, sizeof(si91x_connect_request));
+
+      status = sli_si91x_build_mqtt_sdk_context_if_async(SL_MQTT_CLIENT_CONNECTED_EVENT,
+                                                         client,
+                                                         NULL,
+                                                         pending_connect,
+                                                         connect_timeout,
+                                                         &sdk_context);
+      if (status != SL_STATUS_OK) {
+        SL_CLEANUP_MALLOC(credentials);
+        free(pending_connect);
+        return status;
+      }
+
+      // Set before sending, the completion on the event thread may clear it before the send returns.
+      is_connect_chain_pending = true;
+      status = sli_si91x_send_firmware_mqtt_init(client, credentials, 0, sdk_context);
+      SL_CLEANUP_MALLOC(credentials);
+
+      if (status != SL_STATUS_IN_PROGRESS) {
+        is_connect_chain_pending = false;
+        SL_CLEANUP_MALLOC(sdk_context);
+        free(pending_connect);
+        return (status == SL_STATUS_OK) ? SL_STATUS_FAIL : status;
+      }
+      return status;
+    }
+
+    status = sli_si91x_send_firmware_mqtt_init(client, credentials, SI91X_MQTT_CLIENT_INIT_TIMEOUT, NULL);
+
+    if (status != SL_STATUS_OK) {
+      SL_CLEANUP_MALLOC(credentials);
+
+      sli_si91x_set_client_state(client, SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_CONNECT);
+      return status;
+    }
+
+    sli_si91x_set_client_state(client, SL_MQTT_CLIENT_TA_INIT, SL_MQTT_CLIENT_TRIGGER_CONNECT);
+  }
+
+  SL_CLEANUP_MALLOC(credentials);
+
   status = sli_si91x_build_mqtt_sdk_context_if_async(SL_MQTT_CLIENT_CONNECTED_EVENT,
                                                      client,
                                                      NULL,
@@ -459,24 +1297,21 @@ sl_status_t sl_mqtt_client_connect(sl_mqtt_client_t *client,
                                                      &sdk_context);
   VERIFY_STATUS_AND_RETURN(status);
 
-  status = sl_si91x_driver_send_command(
-    RSI_WLAN_REQ_EMB_MQTT_CLIENT,
-    SI91X_NETWORK_CMD_QUEUE,
-    &si91x_connect_request,
-    sizeof(si91x_connect_request),
-    connect_timeout == 0 ? SL_SI91X_RETURN_IMMEDIATELY : SL_SI91X_WAIT_FOR(connect_timeout),
-    sdk_context,
-    NULL);
+  status = sli_si91x_send_command(SL_MQTT_CLIENT_PRIORITY_CONTROL,
+                                  &si91x_connect_request,
+                                  sizeof(si91x_connect_request),
+                                  connect_timeout == 0 ? SL_SI91X_RETURN_IMMEDIATELY : SL_SI91X_WAIT_FOR(connect_timeout),
+                                  sdk_context);
 
   if (status == SL_STATUS_IN_PROGRESS) {
     return status;
   } else if (status != SL_STATUS_OK) {
-    client->state = SL_MQTT_CLIENT_CONNECTION_FAILED;
+    sli_si91x_set_client_state(client, SL_MQTT_CLIENT_CONNECTION_FAILED, SL_MQTT_CLIENT_TRIGGER_CONNECT);
     SL_CLEANUP_MALLOC(sdk_context);
     return status;
   }
 
-  client->state = SL_MQTT_CLIENT_CONNECTED;
+  sli_si91x_set_client_state(client, SL_MQTT_CLIENT_CONNECTED, SL_MQTT_CLIENT_TRIGGER_CONNECT);
   return SL_STATUS_OK;
 }
 
@@ -486,56 +1321,55 @@ sl_status_t sl_mqtt_client_disconnect(sl_mqtt_client_t *client, uint32_t timeout
   VERIFY_AND_RETURN_ERROR_IF_FALSE((client->state != SL_MQTT_CLIENT_DISCONNECTED), SL_STATUS_INVALID_STATE);
 
   SL_VERIFY_POINTER_OR_RETURN(client, SL_STATUS_WIFI_NULL_PTR_ARG);
+  VERIFY_AND_RETURN_ERROR_IF_FALSE(!is_connect_chain_pending && !is_disconnect_chain_pending, SL_STATUS_BUSY);
 
   sl_status_t status                          = SL_STATUS_OK;
   sl_si91x_mqtt_client_context_t *sdk_context = NULL;
 
   // As in connect, disconnect() call maps to disconnect and deinit in firmware
   // We need to call disconnect even if the previous connect call was failed.
+  // Non blocking calls send disconnect async, its completion sends deinit (see sli_si91x_send_deinit()).
   if (client->state == SL_MQTT_CLIENT_CONNECTION_FAILED || client->state == SL_MQTT_CLIENT_CONNECTED) {
     si91x_mqtt_client_command_request_t si91x_disconnect_request = { .command_type =
                                                                        SI91X_MQTT_CLIENT_DISCONNECT_COMMAND };
 
-    status = sl_si91x_driver_send_command(RSI_WLAN_REQ_EMB_MQTT_CLIENT,
-                                          SI91X_NETWORK_CMD_QUEUE,
-                                          &si91x_disconnect_request,
-                                          sizeof(si91x_disconnect_request),
-                                          SL_SI91X_WAIT_FOR(SI91X_MQTT_CLIENT_DISCONNECT_TIMEOUT),
-                                          sdk_context,
-                                          NULL);
-
+    status = sli_si91x_build_mqtt_sdk_context_if_async(SL_MQTT_CLIENT_DISCONNECTED_EVENT,
+                                                       client,
+                                                       NULL,
+                                                       &sli_si91x_pending_deinit,
+                                                       timeout,
+                                                       &sdk_context);
     VERIFY_STATUS_AND_RETURN(status);
 
-    client->state = SL_MQTT_CLIENT_TA_DISCONNECTED;
-  }
+    // Set before sending, the completion on the event thread may clear it before the send returns.
+    is_disconnect_chain_pending = true;
+    status = sli_si91x_send_command(SL_MQTT_CLIENT_PRIORITY_CONTROL,
+                                    &si91x_disconnect_request,
+                                    sizeof(si91x_disconnect_request),
+                                    timeout == 0 ? SL_SI91X_RETURN_IMMEDIATELY
+                                                 : SL_SI91X_WAIT_FOR(SI91X_MQTT_CLIENT_DISCONNECT_TIMEOUT),
+                                    sdk_context);
 
-  si91x_mqtt_client_command_request_t si91x_deinit_request = { .command_type = SI91X_MQTT_CLIENT_DEINIT_COMMAND };
+    if (status == SL_STATUS_IN_PROGRESS) {
+      return status;
+    }
+    is_disconnect_chain_pending = false;
+    if (status != SL_STATUS_OK) {
+      SL_CLEANUP_MALLOC(sdk_context);
+      return status;
+    }
 
-  status = sli_si91x_build_mqtt_sdk_context_if_async(SL_MQTT_CLIENT_DISCONNECTED_EVENT,
-                                                     client,
-                                                     NULL,
-                                                     NULL,
-                                                     timeout,
-                                                     &sdk_context);
-  VERIFY_STATUS_AND_RETURN(status);
+    sli_si91x_set_client_state(client, SL_MQTT_CLIENT_TA_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_DISCONNECT);
+  }
 
-  status = sl_si91x_driver_send_command(RSI_WLAN_REQ_EMB_MQTT_CLIENT,
-                                        SI91X_NETWORK_CMD_QUEUE,
-                                        &si91x_deinit_request,
-                                        sizeof(si91x_deinit_request),
-                                        timeout <= 0 ? SL_SI91X_RETURN_IMMEDIATELY : SL_SI91X_WAIT_FOR(timeout),
-                                        sdk_context,
-                                        NULL);
+  status = sli_si91x_send_deinit(client, timeout);
 
-  if (status == SL_STATUS_IN_PROGRESS) {
-    return status;
-  } else if (status != SL_STATUS_OK) {
-    SL_CLEANUP_MALLOC(sdk_context);
+  if (status != SL_STATUS_OK) {
     return status;
   }
 
-  client->state = SL_MQTT_CLIENT_DISCONNECTED;
-  sli_si91x_remove_and_free_all_subscriptions(client);
+  sli_si91x_set_client_state(client, SL_MQTT_CLIENT_DISCONNECTED, SL_MQTT_CLIENT_TRIGGER_DISCONNECT);
+  sli_si91x_remove_and_free_all_subscriptions();
 
   return SL_STATUS_OK;
 }
@@ -553,12 +1387,35 @@ sl_status_t sl_mqtt_client_publish(sl_mqtt_client_t *client,
     return SL_STATUS_INVALID_PARAMETER;
   }
 
+  // Checked before any local delivery, so a deferred publish retried later is not delivered twice.
+  if (timeout == 0 && !sli_si91x_is_publish_window_open()) {
+    return SL_STATUS_BUSY;
+  }
+
   sl_status_t status;
   sl_si91x_mqtt_client_context_t *sdk_context = NULL;
+  sli_si91x_loopback_echo_t *echo             = NULL;
   uint32_t publish_request_size               = sizeof(si91x_mqtt_client_publish_request_t) + message->content_length;
 
+  if (loopback_policy != SL_MQTT_CLIENT_LOOPBACK_DISABLED && sli_si91x_deliver_locally(client, message)) {
+    if (loopback_policy == SL_MQTT_CLIENT_LOOPBACK_LOCAL_ONLY) {
+      // Nothing goes on air, complete the publish the same way the firmware would.
+      if (timeout > 0) {
+        return SL_STATUS_OK;
+      }
+      client->client_event_handler(client, SL_MQTT_CLIENT_MESSAGE_PUBLISHED_EVENT, NULL, context);
+      return SL_STATUS_IN_PROGRESS;
+    }
+
+    // The broker will send it back to us as well, that copy was already delivered.
+    echo = sli_si91x_expect_loopback_echo(message);
+  }
+
   si91x_mqtt_client_publish_request_t *si91x_publish_request = calloc(publish_request_size, 1);
   if (si91x_publish_request == NULL) {
+    if (echo != NULL) {
+      echo->is_pending = false;
+    }
     return SL_STATUS_ALLOCATION_FAILED;
   }
   status = sli_si91x_build_mqtt_sdk_context_if_async(SL_MQTT_CLIENT_MESSAGE_PUBLISHED_EVENT,
@@ -570,6 +1427,9 @@ sl_status_t sl_mqtt_client_publish(sl_mqtt_client_t *client,
 
   if (status != SL_STATUS_OK) {
     SL_CLEANUP_MALLOC(si91x_publish_request);
+    if (echo != NULL) {
+      echo->is_pending = false;
+    }
     return SL_STATUS_ALLOCATION_FAILED;
   }
 
@@ -586,13 +1446,11 @@ sl_status_t sl_mqtt_client_publish(sl_mqtt_client_t *client,
   memcpy(si91x_publish_request->topic, message->topic, message->topic_length);
   memcpy(si91x_publish_request->msg, message->content, message->content_length);
 
-  status = sl_si91x_driver_send_command(RSI_WLAN_REQ_EMB_MQTT_CLIENT,
-                                        SI91X_NETWORK_CMD_QUEUE,
-                                        si91x_publish_request,
-                                        publish_request_size,
-                                        timeout <= 0 ? SL_SI91X_RETURN_IMMEDIATELY : SL_SI91X_WAIT_FOR(timeout),
-                                        sdk_context,
-                                        NULL);
+  status = sli_si91x_send_command(SL_MQTT_CLIENT_PRIORITY_PUBLISH,
+                                  si91x_publish_request,
+                                  publish_request_size,
+                                  timeout <= 0 ? SL_SI91X_RETURN_IMMEDIATELY : SL_SI91X_WAIT_FOR(timeout),
+                                  sdk_context);
   free(si91x_publish_request);
 
   if (status == SL_STATUS_IN_PROGRESS) {
@@ -600,6 +1458,9 @@ sl_status_t sl_mqtt_client_publish(sl_mqtt_client_t *client,
   }
 
   SL_CLEANUP_MALLOC(sdk_context);
+  if (status != SL_STATUS_OK && echo != NULL) {
+    echo->is_pending = false; // never reached the broker, nothing will come back
+  }
   VERIFY_STATUS_AND_RETURN(status);
 
   return status;
@@ -627,8 +1488,9 @@ sl_status_t sl_mqtt_client_subscribe(sl_mqtt_client_t *client,
   si91x_mqtt_client_subscribe_t si91x_subscribe_request = { 0 };
   sl_si91x_mqtt_client_context_t *sdk_context           = NULL;
 
+  // The subscribe context is kept behind the topic bytes, local delivery hands it to the handler.
   sl_mqtt_client_topic_subscription_info_t *subscription =
-    calloc(sizeof(sl_mqtt_client_topic_subscription_info_t) + topic_length, 1);
+    calloc(sizeof(sl_mqtt_client_topic_subscription_info_t) + topic_length + sizeof(context), 1);
 
   status = sli_si91x_build_mqtt_sdk_context_if_async(SL_MQTT_CLIENT_SUBSCRIBED_EVENT,
                                                      client,
@@ -654,14 +1516,13 @@ sl_status_t sl_mqtt_client_subscribe(sl_mqtt_client_t *client,
 
   memcpy(si91x_subscribe_request.topic, topic, topic_length);
   memcpy(subscription->topic, topic, topic_length);
+  memcpy(&subscription->topic[topic_length], &context, sizeof(context));
 
-  status = sl_si91x_driver_send_command(RSI_WLAN_REQ_EMB_MQTT_CLIENT,
-                                        SI91X_NETWORK_CMD_QUEUE,
-                                        &si91x_subscribe_request,
-                                        sizeof(si91x_subscribe_request),
-                                        timeout <= 0 ? SL_SI91X_RETURN_IMMEDIATELY : SL_SI91X_WAIT_FOR(timeout),
-                                        sdk_context,
-                                        NULL);
+  status = sli_si91x_send_command(SL_MQTT_CLIENT_PRIORITY_CONTROL,
+                                  &si91x_subscribe_request,
+                                  sizeof(si91x_subscribe_request),
+                                  timeout <= 0 ? SL_SI91X_RETURN_IMMEDIATELY : SL_SI91X_WAIT_FOR(timeout),
+                                  sdk_context);
 
   if (status == SL_STATUS_IN_PROGRESS) {
     return status;
@@ -672,7 +1533,10 @@ sl_status_t sl_mqtt_client_subscribe(sl_mqtt_client_t *client,
     return status;
   }
 
-  sl_slist_push((sl_slist_node_t **)&client->subscription_list_head, (sl_slist_node_t *)subscription);
+  status = sli_si91x_subscription_add(subscription);
+  if (status != SL_STATUS_OK) {
+    free(subscription);
+  }
   return status;
 }
 
@@ -695,8 +1559,11 @@ sl_status_t sl_mqtt_client_unsubscribe(sl_mqtt_client_t *client,
   sl_si91x_mqtt_client_context_t *sdk_context                       = NULL;
   si91x_mqtt_client_unsubscribe_request_t si91x_unsubscribe_request = { 0 };
   sl_mqtt_client_topic_subscription_info_t *subscription;
+  uint32_t epoch;
 
-  sli_si91x_get_subscription(client, topic, topic_length, &subscription);
+  // Only the pointer is kept past the read section, as the identity of the node to remove later.
+  sli_si91x_get_subscription(sli_si91x_subscription_read_begin(&epoch), topic, topic_length, &subscription);
+  sli_si91x_subscription_read_end(epoch);
 
   status = sli_si91x_build_mqtt_sdk_context_if_async(SL_MQTT_CLIENT_UNSUBSCRIBED_EVENT,
                                                      client,
@@ -710,13 +1577,11 @@ sl_status_t sl_mqtt_client_unsubscribe(sl_mqtt_client_t *client,
   si91x_unsubscribe_request.topic_len    = topic_length;
   memcpy(si91x_unsubscribe_request.topic, topic, topic_length);
 
-  status = sl_si91x_driver_send_command(RSI_WLAN_REQ_EMB_MQTT_CLIENT,
-                                        SI91X_NETWORK_CMD_QUEUE,
-                                        &si91x_unsubscribe_request,
-                                        sizeof(si91x_unsubscribe_request),
-                                        timeout <= 0 ? SL_SI91X_RETURN_IMMEDIATELY : SL_SI91X_WAIT_FOR(timeout),
-                                        sdk_context,
-                                        NULL);
+  status = sli_si91x_send_command(SL_MQTT_CLIENT_PRIORITY_CONTROL,
+                                  &si91x_unsubscribe_request,
+                                  sizeof(si91x_unsubscribe_request),
+                                  timeout <= 0 ? SL_SI91X_RETURN_IMMEDIATELY : SL_SI91X_WAIT_FOR(timeout),
+                                  sdk_context);
 
   if (status == SL_STATUS_IN_PROGRESS) {
     return status;
@@ -727,8 +1592,7 @@ sl_status_t sl_mqtt_client_unsubscribe(sl_mqtt_client_t *client,
   }
 
   if (subscription != NULL) {
-    sl_slist_remove((sl_slist_node_t **)&client->subscription_list_head, (sl_slist_node_t *)subscription);
-    free(subscription);
+    sli_si91x_subscription_remove(subscription);
   }
 
   return status;
@@ -740,10 +1604,38 @@ sl_status_t sli_si91x_mqtt_event_handler(sl_status_t status,
 {
   sl_mqtt_client_error_status_t error_status = sli_si91x_get_event_error_status(sdk_context->event);
 
+  sli_si91x_command_completed(sdk_context);
+
   switch (sdk_context->event) {
     case SL_MQTT_CLIENT_CONNECTED_EVENT: {
-      sdk_context->client->state = (status == SL_STATUS_OK) ? SL_MQTT_CLIENT_CONNECTED
-                                                            : SL_MQTT_CLIENT_CONNECTION_FAILED;
+      if (sdk_context->sdk_data != NULL) {
+        // Completion of the async init, chain the connect. Only its completion is reported.
+        is_connect_chain_pending = false;
+
+        if (status == SL_STATUS_OK) {
+          sli_si91x_set_client_state(sdk_context->client, SL_MQTT_CLIENT_TA_INIT, SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT);
+          status = sli_si91x_send_pending_connect(sdk_context->client, sdk_context->sdk_data);
+          if (status == SL_STATUS_IN_PROGRESS) {
+            free(sdk_context);
+            return SL_STATUS_OK;
+          }
+          sli_si91x_set_client_state(sdk_context->client,
+                                     SL_MQTT_CLIENT_CONNECTION_FAILED,
+                                     SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT);
+        } else {
+          free(sdk_context->sdk_data);
+          sli_si91x_set_client_state(sdk_context->client,
+                                     SL_MQTT_CLIENT_DISCONNECTED,
+                                     SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT);
+        }
+
+        status = (status == SL_STATUS_OK) ? SL_STATUS_FAIL : status;
+        break;
+      }
+
+      sli_si91x_set_client_state(sdk_context->client,
+                                 (status == SL_STATUS_OK) ? SL_MQTT_CLIENT_CONNECTED : SL_MQTT_CLIENT_CONNECTION_FAILED,
+                                 SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT);
       break;
     }
 
@@ -754,9 +1646,15 @@ sl_status_t sli_si91x_mqtt_event_handler(sl_status_t status,
         break;
       }
 
-      // As subscription is success, add the subscription to list.
-      sl_slist_push((sl_slist_node_t **)&sdk_context->client->subscription_list_head,
-                    (sl_slist_node_t *)sdk_context->sdk_data);
+      if (connect_timestamps.connack != 0 && connect_timestamps.first_suback == 0) {
+        connect_timestamps.first_suback = sli_si91x_now_ms();
+      }
+
+      // As subscription is success, add the subscription to the table.
+      status = sli_si91x_subscription_add(sdk_context->sdk_data);
+      if (status != SL_STATUS_OK) {
+        free(sdk_context->sdk_data);
+      }
       break;
     }
 
@@ -765,17 +1663,18 @@ sl_status_t sli_si91x_mqtt_event_handler(sl_status_t status,
         break;
       }
 
-      // Free subscription if the unsubscription API call is successful.
-      sl_slist_remove((sl_slist_node_t **)&sdk_context->client->subscription_list_head,
-                      (sl_slist_node_t *)sdk_context->sdk_data);
-      free(sdk_context->sdk_data);
+      // Drop the subscription if the unsubscription API call is successful, it is freed once no reader holds it.
+      if (sdk_context->sdk_data != NULL) {
+        sli_si91x_subscription_remove(sdk_context->sdk_data);
+      }
       break;
     }
 
     case SL_MQTT_CLIENT_MESSAGED_RECEIVED_EVENT: {
       // Extract the MQTT message from payload and create sl_mqtt_message
-      sl_mqtt_client_message_t received_message;
+      sl_mqtt_client_message_t received_message = { 0 };
       sl_mqtt_client_topic_subscription_info_t *subscription;
+      uint32_t epoch;
 
       si91x_mqtt_client_received_message *si91x_message = (si91x_mqtt_client_received_message *)rx_packet->data;
 
@@ -785,7 +1684,18 @@ sl_status_t sli_si91x_mqtt_event_handler(sl_status_t status,
       received_message.content_length = si91x_message->current_chunk_length;
       received_message.content        = (uint8_t *)&si91x_message->data[si91x_message->topic_length];
 
-      sli_si91x_get_subscription(sdk_context->client,
+      // Flags of the PUBLISH as received, the duplicate filter needs QoS and DUP
+      received_message.qos_level            = (sl_mqtt_qos_t)si91x_message->qos;
+      received_message.is_retained          = si91x_message->retained;
+      received_message.is_duplicate_message = si91x_message->duplicate_message;
+
+      if (sli_si91x_is_loopback_echo(&received_message)) {
+        free(sdk_context);
+        return SL_STATUS_OK;
+      }
+
+      // The handler runs inside the read section, so an unsubscribe completing meanwhile can not free it.
+      sli_si91x_get_subscription(sli_si91x_subscription_read_begin(&epoch),
                                  received_message.topic,
                                  received_message.topic_length,
                                  &subscription);
@@ -793,19 +1703,47 @@ sl_status_t sli_si91x_mqtt_event_handler(sl_status_t status,
       if (subscription == NULL) {
         SL_DEBUG_LOG("Unable to find subscription: Dropping MQTT message handling");
       } else {
-        subscription->topic_message_handler(sdk_context->client, &received_message, sdk_context->user_context);
+        // The rx packet is freed by the driver once we return. Copy once into a pool buffer so handlers
+        // can retain the message instead of each making their own copy.
+        sl_mqtt_client_message_t *pooled_message = sli_si91x_rx_buffer_fill(&received_message);
+        if (pooled_message == NULL) {
+          subscription->topic_message_handler(sdk_context->client, &received_message, sdk_context->user_context);
+        } else {
+          subscription->topic_message_handler(sdk_context->client, pooled_message, sdk_context->user_context);
+          sl_mqtt_client_message_release(pooled_message);
+        }
       }
+      sli_si91x_subscription_read_end(epoch);
 
       free(sdk_context);
       return SL_STATUS_OK;
     }
 
     case SL_MQTT_CLIENT_DISCONNECTED_EVENT: {
-      sdk_context->client->state = (status == SL_STATUS_OK) ? SL_MQTT_CLIENT_DISCONNECTED : sdk_context->client->state;
+      if (sdk_context->sdk_data == &sli_si91x_pending_deinit) {
+        // Completion of the async disconnect, chain the deinit. Only its completion is reported.
+        is_disconnect_chain_pending = false;
+
+        if (status == SL_STATUS_OK) {
+          sli_si91x_set_client_state(sdk_context->client,
+                                     SL_MQTT_CLIENT_TA_DISCONNECTED,
+                                     SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT);
+          status = sli_si91x_send_deinit(sdk_context->client, 0);
+          if (status == SL_STATUS_IN_PROGRESS) {
+            free(sdk_context);
+            return SL_STATUS_OK;
+          }
+          status = (status == SL_STATUS_OK) ? SL_STATUS_FAIL : status;
+        }
+        break;
+      }
 
       // Free all subscriptions as we have disconnected from mqtt broker
       if (status == SL_STATUS_OK) {
-        sli_si91x_remove_and_free_all_subscriptions(sdk_context->client);
+        sli_si91x_set_client_state(sdk_context->client,
+                                   SL_MQTT_CLIENT_DISCONNECTED,
+                                   SL_MQTT_CLIENT_TRIGGER_FIRMWARE_EVENT);
+        sli_si91x_remove_and_free_all_subscriptions();
       }
 
       break;